@@ -0,0 +1,128 @@
+/*
+ * Sampling interval of a process monitor that follows how busy the process is
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "adaptiveInterval.h"
+#include "fieldPlan.h"
+
+#define FIELD_CPU (FIELD_BIT(FIELD_UTIME) | FIELD_BIT(FIELD_STIME))
+
+long long adaptiveResident(const ProcessSample *sample);
+
+
+/*
+ * Parses the "min,max" of 'add ... -a', both in usec
+ *
+ * Return: 0 on success, -1 if the spec is malformed or min > max
+ */
+int adaptiveParse(const char *spec, unsigned long *minInterval, unsigned long *maxInterval) {
+   char *end = NULL;
+   long minTemp = -1, maxTemp = -1;
+
+   errno = 0;
+   minTemp = strtol(spec, &end, 10);
+   if (errno != 0 || end == spec || *end != ',' || minTemp <= 0) {
+      return -1;
+   }
+
+   spec = end + 1;
+   maxTemp = strtol(spec, &end, 10);
+   if (errno != 0 || end == spec || *end != '\0' || maxTemp < minTemp) {
+      return -1;
+   }
+
+   *minInterval = (unsigned long)minTemp;
+   *maxInterval = (unsigned long)maxTemp;
+
+   return 0;
+}
+
+/*
+ * Starts at interval (the -i of the monitor), clamped to [min, max]
+ */
+void adaptiveInit(AdaptiveInterval *adaptive, unsigned long minInterval, unsigned long maxInterval,
+      unsigned long interval) {
+   memset(adaptive, 0, sizeof (AdaptiveInterval));
+   adaptive->minInterval = minInterval;
+   adaptive->maxInterval = maxInterval;
+   adaptive->interval = (interval < minInterval) ? minInterval :
+      (interval > maxInterval) ? maxInterval : interval;
+   adaptive->lastCpu = -1.0;
+
+   return;
+}
+
+/*
+ * Folds in the newest sample.  Only the columns the field plan collected
+ * count: a monitor without utime and stime reacts to its resident set
+ * alone and one without either backs off to max.
+ *
+ * Return: the interval to sleep before the next tick
+ */
+unsigned long adaptiveUpdate(AdaptiveInterval *adaptive, const ProcessSample *sample) {
+   unsigned long long ticks = sample->userTime + sample->kernelTime;
+   long long resident = adaptiveResident(sample);
+   long long elapsed = sample->timeUsec - adaptive->lastTimeUsec;
+   double cpu = -1.0, quantum = 0.0, change = 0.0;
+   int moved = 0;
+
+   if (adaptive->primed != 0 && elapsed > 0 && (sample->fields & FIELD_CPU) == FIELD_CPU) {
+      quantum = 100.0 * 1000000.0 / ((double)sysconf(_SC_CLK_TCK) * elapsed);
+      cpu = (ticks - adaptive->lastTicks) * quantum;
+      change = (cpu > adaptive->lastCpu) ? cpu - adaptive->lastCpu : adaptive->lastCpu - cpu;
+
+      // one tick more or less than last time says nothing about the process
+      if (adaptive->lastCpu >= 0.0 && change > quantum && change > adaptive->lastQuantum &&
+            (change >= ADAPTIVE_CPU_STEP ||
+             (int)(cpu / ADAPTIVE_CPU_BAND) != (int)(adaptive->lastCpu / ADAPTIVE_CPU_BAND))) {
+         moved = 1;
+      }
+   }
+
+   if (adaptive->primed != 0 && resident >= 0 && adaptive->lastResident >= 0) {
+      if ((resident - adaptive->lastResident) * ADAPTIVE_RSS_STEP >= adaptive->lastResident ||
+            (adaptive->lastResident - resident) * ADAPTIVE_RSS_STEP >= adaptive->lastResident) {
+         moved = 1;
+      }
+   }
+
+   if (moved != 0) {
+      adaptive->interval = adaptive->minInterval;
+      adaptive->calm = 0;
+   } else if (adaptive->primed != 0 && ++adaptive->calm >= ADAPTIVE_CALM_TICKS) {
+      adaptive->interval = (adaptive->interval > adaptive->maxInterval / 2) ?
+         adaptive->maxInterval : adaptive->interval * 2;
+      adaptive->calm = 0;
+   }
+
+   adaptive->primed = 1;
+   adaptive->lastTimeUsec = sample->timeUsec;
+   adaptive->lastTicks = ticks;
+   adaptive->lastCpu = cpu;
+   adaptive->lastQuantum = quantum;
+   adaptive->lastResident = resident;
+
+   return adaptive->interval;
+}
+
+/*
+ * Return: the resident set in pages, -1 if neither stat.rss nor
+ * statm.resident was collected
+ */
+long long adaptiveResident(const ProcessSample *sample) {
+   if ((sample->fields & FIELD_BIT(FIELD_RSS)) != 0) {
+      return sample->rss;
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_RESIDENT)) != 0) {
+      return (long long)sample->residentSet;
+   }
+
+   return -1;
+}
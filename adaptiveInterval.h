@@ -0,0 +1,38 @@
+#ifndef __ADAPTIVE_INTERVAL_H_
+#define __ADAPTIVE_INTERVAL_H_
+
+#include "samples.h"
+
+#define ADAPTIVE_CPU_STEP 10.0      // percentage points between two ticks
+#define ADAPTIVE_CPU_BAND 25.0      // percent, width of the CPU use bands
+#define ADAPTIVE_RSS_STEP 20        // 1/20th, ie. 5% of the resident set
+#define ADAPTIVE_CALM_TICKS 3       // quiet ticks before each back off
+
+/*
+ * The interval of a process monitor added with 'add ... -a min,max'.  A tick
+ * whose CPU use moved by ADAPTIVE_CPU_STEP, whose resident set moved by
+ * 1/ADAPTIVE_RSS_STEP or whose CPU use crossed into another band drops the
+ * interval straight to min; every ADAPTIVE_CALM_TICKS quiet ticks in a row
+ * double it, up to max.  CPU use comes from clock ticks, so a move of no
+ * more than one tick over the interval (10 points at 100 ms and 100 Hz) is
+ * quantization and does not count.
+ */
+typedef struct {
+   unsigned long minInterval;
+   unsigned long maxInterval;
+   unsigned long interval;    // effective, what the monitor sleeps next
+   int primed;                // a previous sample is kept below
+   int calm;
+   long long lastTimeUsec;
+   unsigned long long lastTicks;
+   double lastCpu;            // percent, -1 before the second sample
+   double lastQuantum;        // percentage points of one tick for lastCpu
+   long long lastResident;    // pages, -1 if no column gives it
+} AdaptiveInterval;
+
+int adaptiveParse(const char *spec, unsigned long *minInterval, unsigned long *maxInterval);
+void adaptiveInit(AdaptiveInterval *adaptive, unsigned long minInterval, unsigned long maxInterval,
+      unsigned long interval);
+unsigned long adaptiveUpdate(AdaptiveInterval *adaptive, const ProcessSample *sample);
+
+#endif // __ADAPTIVE_INTERVAL_H_
@@ -0,0 +1,785 @@
+/*
+ * Threshold rules ('alert') evaluated by every monitor against each sample
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "alerts.h"
+#include "fieldPlan.h"
+#include "processProviders.h"
+#include "commands.h"
+#include "logLibrary.h"
+
+typedef struct {
+   const char *name;
+   AlertKind kind;
+   int (*value)(const Sample *now, const Sample *prev, double *value);
+} AlertMetric;
+
+int alertProcRss(const Sample *now, const Sample *prev, double *value);
+int alertProcVsize(const Sample *now, const Sample *prev, double *value);
+int alertProcCpu(const Sample *now, const Sample *prev, double *value);
+int alertProcThreads(const Sample *now, const Sample *prev, double *value);
+int alertProcFds(const Sample *now, const Sample *prev, double *value);
+int alertProcPss(const Sample *now, const Sample *prev, double *value);
+int alertProcFaults(const Sample *now, const Sample *prev, double *value);
+int alertSysCpu(const Sample *now, const Sample *prev, double *value);
+int alertSysMem(const Sample *now, const Sample *prev, double *value);
+int alertSysDisk(const Sample *now, const Sample *prev, double *value);
+int alertSysLoad(const Sample *now, const Sample *prev, double *value);
+int alertCgroupCpu(const Sample *now, const Sample *prev, double *value);
+int alertCgroupMem(const Sample *now, const Sample *prev, double *value);
+int alertCgroupPids(const Sample *now, const Sample *prev, double *value);
+int alertCgroupFaults(const Sample *now, const Sample *prev, double *value);
+int alertParseNumber(const char *token, double *value);
+double alertWindow(AlertState *alert, long long timeUsec, double value);
+void alertRecord(FILE *fLogFile, pid_t pid, const char *cgroup, AlertState *alert, const char *what);
+void alertExec(AlertState *alert, pid_t pid);
+void alertReap();
+
+/*
+ * cpu% is percent of one cpu for a process or cgroup and of the whole host
+ * for the system; sizes are bytes and faults per second
+ */
+static const AlertMetric alertMetrics[] = {
+   { "rss", ALERT_PROCESS, alertProcRss },
+   { "vsize", ALERT_PROCESS, alertProcVsize },
+   { "cpu%", ALERT_PROCESS, alertProcCpu },
+   { "threads", ALERT_PROCESS, alertProcThreads },
+   { "fds", ALERT_PROCESS, alertProcFds },
+   { "pss", ALERT_PROCESS, alertProcPss },
+   { "faults", ALERT_PROCESS, alertProcFaults },
+   { "cpu%", ALERT_SYSTEM, alertSysCpu },
+   { "mem%", ALERT_SYSTEM, alertSysMem },
+   { "disk%", ALERT_SYSTEM, alertSysDisk },
+   { "load", ALERT_SYSTEM, alertSysLoad },
+   { "cpu%", ALERT_CGROUP, alertCgroupCpu },
+   { "mem", ALERT_CGROUP, alertCgroupMem },
+   { "pids", ALERT_CGROUP, alertCgroupPids },
+   { "faults", ALERT_CGROUP, alertCgroupFaults },
+};
+
+#define ALERT_METRICS ((int)(sizeof (alertMetrics) / sizeof (alertMetrics[0])))
+
+static const char *alertOps[] = { ">", ">=", "<", "<=" };
+
+// only the command thread touches the rules, monitors get copies
+AlertRule alertRules[ALERT_MAX_RULES];
+int alertRuleCount = 0;
+
+// exec commands still running, reaped by whichever monitor acts next
+pthread_mutex_t alertChildMutex;
+pid_t alertChildren[ALERT_MAX_CHILDREN];
+
+extern char **environ;
+
+
+void initAlerts() {
+   if (pthread_mutex_init(&alertChildMutex, NULL) != 0) {
+      perror("pthread_mutex_init failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+
+/*
+ * Parses "<metric> <op> <value> [for|avg <duration>] [log|kill|exec
+ * <command>]" and adds it for the monitors added from now on
+ *
+ * Return: 0 on success, -1 if the rule is malformed or there are too many
+ */
+int alertAdd(const char *spec) {
+   char copy[ALERT_TEXT_LEN] = "";
+   char *token = NULL, *save = NULL;
+   AlertRule rule;
+   int i = 0;
+
+   if (alertRuleCount == ALERT_MAX_RULES || snprintf(copy, ALERT_TEXT_LEN, "%s", spec) >= ALERT_TEXT_LEN) {
+      return -1;
+   }
+
+   memset(&rule, 0, sizeof (AlertRule));
+   snprintf(rule.text, ALERT_TEXT_LEN, "%s", spec);
+
+   // metric
+   if ((token = strtok_r(copy, " ", &save)) == NULL || alertMetric(token, ALERT_KINDS) == -1 ||
+         strlen(token) >= sizeof (rule.metric)) {
+      return -1;
+   }
+   snprintf(rule.metric, sizeof (rule.metric), "%s", token);
+
+   // op
+   if ((token = strtok_r(NULL, " ", &save)) == NULL) {
+      return -1;
+   }
+   for (i = 0; i < 4 && strcmp(token, alertOps[i]) != 0; i++) {
+   }
+   if (i == 4) {
+      return -1;
+   }
+   rule.op = (AlertOp)i;
+
+   // threshold
+   if ((token = strtok_r(NULL, " ", &save)) == NULL || alertParseNumber(token, &(rule.threshold)) == -1) {
+      return -1;
+   }
+
+   // optional window, then optional action
+   token = strtok_r(NULL, " ", &save);
+   if (token != NULL && (strcmp(token, "for") == 0 || strcmp(token, "avg") == 0)) {
+      rule.mode = (token[0] == 'f') ? ALERT_FOR : ALERT_AVG;
+      if ((token = strtok_r(NULL, " ", &save)) == NULL || alertParseDuration(token, &(rule.windowUsec)) == -1) {
+         return -1;
+      }
+      token = strtok_r(NULL, " ", &save);
+   }
+
+   if (token == NULL || strcmp(token, "log") == 0) {
+      rule.action = ALERT_LOG;
+   } else if (strcmp(token, "kill") == 0) {
+      rule.action = ALERT_KILL;
+   } else if (strcmp(token, "exec") == 0) {
+      rule.action = ALERT_EXEC;
+      // the rest of the line is the command
+      if ((token = strtok_r(NULL, "", &save)) == NULL) {
+         return -1;
+      }
+      snprintf(rule.command, ALERT_TEXT_LEN, "%s", token);
+      save = NULL;
+   } else {
+      return -1;
+   }
+
+   if (save != NULL && strtok_r(NULL, " ", &save) != NULL) {
+      return -1;
+   }
+
+   alertRules[alertRuleCount++] = rule;
+
+   return 0;
+}
+
+void alertClear() {
+   alertRuleCount = 0;
+
+   return;
+}
+
+void alertList() {
+   int i = 0;
+
+   for (i = 0; i < alertRuleCount; i++) {
+      printf("%2d: %s\n", i + 1, alertRules[i].text);
+   }
+
+   return;
+}
+
+/*
+ * Copies the current rules that apply to kind (kill only applies to
+ * processes)
+ *
+ * Return: NULL if no rule applies
+ */
+AlertSet *alertSetCreate(AlertKind kind) {
+   AlertSet *set = NULL;
+   AlertState *alert = NULL;
+   int i = 0, metric = -1;
+
+   for (i = 0; i < alertRuleCount; i++) {
+      if ((metric = alertMetric(alertRules[i].metric, kind)) == -1 ||
+            (alertRules[i].action == ALERT_KILL && kind != ALERT_PROCESS)) {
+         continue;
+      }
+
+      if (set == NULL && (set = (AlertSet *)calloc(1, sizeof (AlertSet))) == NULL) {
+         perror("calloc failed");
+         exit(-1);
+      }
+
+      alert = &(set->alerts[set->count++]);
+      alert->rule = alertRules[i];
+      alert->metric = metric;
+   }
+
+   if (set != NULL) {
+      set->kind = kind;
+   }
+
+   return set;
+}
+
+void alertSetDestroy(AlertSet **set) {
+   free(*set);
+   *set = NULL;
+
+   return;
+}
+
+/*
+ * Runs every rule against the newest sample of history and logs a record
+ * when one starts or stops firing.  The caller holds the monitor's log
+ * file; actions other than the record run later in alertActions.
+ */
+void alertEvaluate(AlertSet *set, FILE *fLogFile, pid_t pid, const char *cgroup, SampleHistory *history) {
+   AlertState *alert = NULL;
+   const Sample *now = NULL, *prev = NULL;
+   double value = 0.0, compared = 0.0;
+   long long timeUsec = 0;
+   int holds = 0, i = 0;
+
+   if (set == NULL || history == NULL || history->count == 0) {
+      return;
+   }
+
+   now = historyLatest(history);
+   prev = (history->count >= 2) ? historyGet(history, history->count - 2) : NULL;
+   timeUsec = alertSampleTime(set->kind, now);
+
+   for (i = 0; i < set->count; i++) {
+      alert = &(set->alerts[i]);
+      if (alertMetricValue(alert->metric, now, prev, &value) == -1) {
+         continue;
+      }
+
+      alert->value = value;
+      compared = (alert->rule.mode == ALERT_AVG) ? alertWindow(alert, timeUsec, value) : value;
+
+      switch (alert->rule.op) {
+         case ALERT_GT: holds = (compared > alert->rule.threshold); break;
+         case ALERT_GE: holds = (compared >= alert->rule.threshold); break;
+         case ALERT_LT: holds = (compared < alert->rule.threshold); break;
+         case ALERT_LE: holds = (compared <= alert->rule.threshold); break;
+      }
+
+      if (alert->rule.mode == ALERT_FOR) {
+         if (holds == 0) {
+            alert->sinceUsec = 0;
+         } else if (alert->sinceUsec == 0) {
+            alert->sinceUsec = timeUsec;
+         }
+         holds = (holds != 0 && timeUsec - alert->sinceUsec >= alert->rule.windowUsec);
+      } else if (alert->rule.mode == ALERT_AVG) {
+         // a mean over less than the window is not the rule yet
+         holds = (holds != 0 && timeUsec - alert->firstUsec >= alert->rule.windowUsec);
+         alert->value = compared;
+      }
+
+      if (holds != 0 && alert->firing == 0) {
+         alert->firing = 1;
+         alert->pending = (alert->rule.action != ALERT_LOG);
+         alertRecord(fLogFile, pid, cgroup, alert, "firing");
+      } else if (holds == 0 && alert->firing != 0) {
+         alert->firing = 0;
+         alertRecord(fLogFile, pid, cgroup, alert, "resolved");
+      }
+   }
+
+   return;
+}
+
+/*
+ * Runs the exec and kill actions of the rules that just fired.  Must be
+ * called without any table or file lock held: kill goes through
+ * killMonitored, which locks the table rows.
+ */
+void alertActions(AlertSet *set, pid_t pid) {
+   AlertState *alert = NULL;
+   int i = 0;
+
+   if (set == NULL) {
+      return;
+   }
+
+   alertReap();
+
+   for (i = 0; i < set->count; i++) {
+      alert = &(set->alerts[i]);
+      if (alert->pending == 0) {
+         continue;
+      }
+      alert->pending = 0;
+
+      if (alert->rule.action == ALERT_KILL) {
+         killMonitored(pid);
+      } else if (alert->rule.action == ALERT_EXEC) {
+         alertExec(alert, pid);
+      }
+   }
+
+   return;
+}
+
+/*
+ * Logs an "ended" record for every rule still firing when the monitor
+ * stops: the condition did not clear, the monitored thing went away.  The
+ * caller holds the monitor's log file.
+ */
+void alertEnd(AlertSet *set, FILE *fLogFile, pid_t pid, const char *cgroup) {
+   AlertState *alert = NULL;
+   int i = 0;
+
+   if (set == NULL) {
+      return;
+   }
+
+   for (i = 0; i < set->count; i++) {
+      alert = &(set->alerts[i]);
+      if (alert->firing != 0) {
+         alert->firing = 0;
+         alertRecord(fLogFile, pid, cgroup, alert, "ended");
+      }
+   }
+
+   return;
+}
+
+/*
+ * Return: the index of the metric called name for kind (any kind for
+ * ALERT_KINDS), -1 if there is none
+ */
+int alertMetric(const char *name, AlertKind kind) {
+   int i = 0;
+
+   for (i = 0; i < ALERT_METRICS; i++) {
+      if ((kind == ALERT_KINDS || alertMetrics[i].kind == kind) && strcmp(alertMetrics[i].name, name) == 0) {
+         return i;
+      }
+   }
+
+   return -1;
+}
+
+const char *alertMetricName(int metric) {
+   return alertMetrics[metric].name;
+}
+
+/*
+ * Return: 0 with value set, -1 if the sample (or the pair for a rate) does
+ * not hold the metric
+ */
+int alertMetricValue(int metric, const Sample *now, const Sample *prev, double *value) {
+   return alertMetrics[metric].value(now, prev, value);
+}
+
+long long alertSampleTime(AlertKind kind, const Sample *sample) {
+   switch (kind) {
+      case ALERT_SYSTEM: return sample->sys.timeUsec;
+      case ALERT_CGROUP: return sample->cgroup.timeUsec;
+      default: return sample->proc.timeUsec;
+   }
+}
+
+/*
+ * Parses a number with an optional K, M, G or T (powers of 1024) or %
+ *
+ * Return: 0 on success, -1 otherwise
+ */
+int alertParseNumber(const char *token, double *value) {
+   char *end = NULL;
+   double scale = 1.0;
+
+   errno = 0;
+   *value = strtod(token, &end);
+   if (errno != 0 || end == token) {
+      return -1;
+   }
+
+   switch (*end) {
+      case 'T': case 't': scale *= 1024.0;
+      // fall through
+      case 'G': case 'g': scale *= 1024.0;
+      // fall through
+      case 'M': case 'm': scale *= 1024.0;
+      // fall through
+      case 'K': case 'k': scale *= 1024.0;
+      // fall through
+      case '%': end++; break;
+   }
+
+   *value *= scale;
+
+   return (*end == '\0') ? 0 : -1;
+}
+
+/*
+ * Parses a duration in ms, s (the default), m or h
+ *
+ * Return: 0 on success, -1 otherwise
+ */
+int alertParseDuration(const char *token, long long *usec) {
+   char *end = NULL;
+   double value = 0.0, scale = 1000000.0;
+
+   errno = 0;
+   value = strtod(token, &end);
+   if (errno != 0 || end == token || value <= 0.0) {
+      return -1;
+   }
+
+   if (strcmp(end, "ms") == 0) {
+      scale = 1000.0;
+   } else if (strcmp(end, "m") == 0) {
+      scale = 60000000.0;
+   } else if (strcmp(end, "h") == 0) {
+      scale = 3600000000.0;
+   } else if (strcmp(end, "s") != 0 && *end != '\0') {
+      return -1;
+   }
+
+   *usec = (long long)(value * scale);
+
+   return 0;
+}
+
+/*
+ * Adds value to the avg window, dropping the buckets that fell out of it
+ *
+ * Return: the mean over the window
+ */
+double alertWindow(AlertState *alert, long long timeUsec, double value) {
+   long long width = alert->rule.windowUsec / ALERT_BUCKETS;
+   long long bucket = timeUsec / ((width > 0) ? width : 1);
+   int i = 0;
+
+   if (alert->firstUsec == 0 || bucket - alert->bucket >= ALERT_BUCKETS) {
+      memset(alert->sum, 0, sizeof (alert->sum));
+      memset(alert->count, 0, sizeof (alert->count));
+      alert->windowSum = 0.0;
+      alert->windowCount = 0;
+      if (alert->firstUsec == 0) {
+         alert->firstUsec = timeUsec;
+      }
+      alert->bucket = bucket;
+   }
+
+   while (alert->bucket < bucket) {
+      i = (int)(++alert->bucket % ALERT_BUCKETS);
+      alert->windowSum -= alert->sum[i];
+      alert->windowCount -= alert->count[i];
+      alert->sum[i] = 0.0;
+      alert->count[i] = 0;
+   }
+
+   i = (int)(bucket % ALERT_BUCKETS);
+   alert->sum[i] += value;
+   alert->count[i]++;
+   alert->windowSum += value;
+   alert->windowCount++;
+
+   return alert->windowSum / alert->windowCount;
+}
+
+void alertRecord(FILE *fLogFile, pid_t pid, const char *cgroup, AlertState *alert, const char *what) {
+   char timeStr[MAX_TIME_LEN] = "";
+
+   fprintf(fLogFile, "[%s] ", generateLogTime(timeStr));
+   if (cgroup != NULL && cgroup[0] != '\0') {
+      fprintf(fLogFile, "Cgroup(%s) ", cgroup);
+   } else if (pid < 0) {
+      fprintf(fLogFile, "System ");
+   } else {
+      fprintf(fLogFile, "Process(%d) ", pid);
+   }
+   fprintf(fLogFile, " [ALERT] %s %s value %.2f\n", what, alert->rule.text, alert->value);
+   fflush(fLogFile);
+
+   return;
+}
+
+/*
+ * Spawns the command through sh with MOND_PID, MOND_RULE and MOND_VALUE
+ * added to mond's environment.  Everything the child needs is built before
+ * posix_spawn, so nothing runs between fork and exec in this threaded
+ * process, and the monitor does not wait for the command: alertReap picks
+ * it up once it is done.
+ */
+void alertExec(AlertState *alert, pid_t pid) {
+   char envPid[32] = "", envValue[64] = "", envRule[ALERT_TEXT_LEN + 16] = "";
+   char *argv[] = { "sh", "-c", alert->rule.command, NULL };
+   char **envp = NULL;
+   pid_t child = -1;
+   int count = 0, i = 0, slot = -1, error = 0;
+
+   snprintf(envPid, sizeof (envPid), "MOND_PID=%d", pid);
+   snprintf(envValue, sizeof (envValue), "MOND_VALUE=%.2f", alert->value);
+   snprintf(envRule, sizeof (envRule), "MOND_RULE=%s", alert->rule.text);
+
+   for (i = 0; environ[i] != NULL; i++);
+   if ((envp = (char **)calloc(i + 4, sizeof (char *))) == NULL) {
+      perror("calloc failed");
+      exit(-1);
+   }
+   for (i = 0; environ[i] != NULL; i++) {
+      if (strncmp(environ[i], "MOND_PID=", 9) != 0 && strncmp(environ[i], "MOND_VALUE=", 11) != 0 &&
+            strncmp(environ[i], "MOND_RULE=", 10) != 0) {
+         envp[count++] = environ[i];
+      }
+   }
+   envp[count++] = envPid;
+   envp[count++] = envValue;
+   envp[count++] = envRule;
+
+   /*
+    *  What threads use this critical section:
+    *    Monitor threads running an exec alert or reaping the commands of
+    *    earlier ones use this critical section.
+    *
+    *  What shared resources are being protected:
+    *    The table of exec commands still running.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling) must
+    *    use the shared resources and therefore, must be locked.  The spawn
+    *    is inside so a free slot cannot be taken twice; it returns as soon
+    *    as the child exists, without waiting for the command.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&alertChildMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   for (i = 0; i < ALERT_MAX_CHILDREN && slot == -1; i++) {
+      if (alertChildren[i] == 0) {
+         slot = i;
+      }
+   }
+
+   if (slot == -1) {
+      fprintf(stderr, "alert exec skipped: %d commands still running\n", ALERT_MAX_CHILDREN);
+   } else if ((error = posix_spawn(&child, "/bin/sh", NULL, NULL, argv, envp)) != 0) {
+      errno = error;
+      perror("posix_spawn failed");
+   } else {
+      alertChildren[slot] = child;
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&alertChildMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   free(envp);
+
+   return;
+}
+
+/*
+ * Reaps the exec commands that finished, without waiting for the others
+ */
+void alertReap() {
+   int i = 0, status = 0;
+
+   /*
+    *  What threads use this critical section:
+    *    Monitor threads with alert rules use this critical section on
+    *    every tick.
+    *
+    *  What shared resources are being protected:
+    *    The table of exec commands still running.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section must use the shared resources
+    *    and therefore, must be locked.  waitpid does not block (WNOHANG)
+    *    and the table is small.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&alertChildMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   for (i = 0; i < ALERT_MAX_CHILDREN; i++) {
+      if (alertChildren[i] != 0 && waitpid(alertChildren[i], &status, WNOHANG) != 0) {
+         alertChildren[i] = 0;
+      }
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&alertChildMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+int alertProcRss(const Sample *now, const Sample *prev, double *value) {
+   if ((now->proc.fields & FIELD_BIT(FIELD_RSS)) != 0) {
+      *value = (double)now->proc.rss * sysconf(_SC_PAGESIZE);
+   } else if ((now->proc.fields & FIELD_BIT(FIELD_RESIDENT)) != 0) {
+      *value = (double)now->proc.residentSet * sysconf(_SC_PAGESIZE);
+   } else {
+      return -1;
+   }
+
+   return 0;
+}
+
+int alertProcVsize(const Sample *now, const Sample *prev, double *value) {
+   if ((now->proc.fields & FIELD_BIT(FIELD_VSIZE)) == 0) {
+      return -1;
+   }
+   *value = (double)now->proc.vsize;
+
+   return 0;
+}
+
+int alertProcCpu(const Sample *now, const Sample *prev, double *value) {
+   unsigned int cpu = FIELD_BIT(FIELD_UTIME) | FIELD_BIT(FIELD_STIME);
+   double elapsed = 0.0;
+
+   if (prev == NULL || (now->proc.fields & cpu) != cpu ||
+         (elapsed = (now->proc.timeUsec - prev->proc.timeUsec) / 1000000.0) <= 0.0) {
+      return -1;
+   }
+   *value = 100.0 * ((now->proc.userTime + now->proc.kernelTime) - (prev->proc.userTime + prev->proc.kernelTime)) /
+      (sysconf(_SC_CLK_TCK) * elapsed);
+
+   return 0;
+}
+
+int alertProcThreads(const Sample *now, const Sample *prev, double *value) {
+   if ((now->proc.fields & FIELD_BIT(FIELD_THREADS)) == 0) {
+      return -1;
+   }
+   *value = (double)now->proc.numThreads;
+
+   return 0;
+}
+
+int alertProcFds(const Sample *now, const Sample *prev, double *value) {
+   if ((now->proc.providers & PROVIDER_BIT(PROVIDER_FDS)) == 0) {
+      return -1;
+   }
+   *value = (double)now->proc.openFds;
+
+   return 0;
+}
+
+int alertProcPss(const Sample *now, const Sample *prev, double *value) {
+   if ((now->proc.providers & PROVIDER_BIT(PROVIDER_SMAPS)) == 0) {
+      return -1;
+   }
+   *value = (double)now->proc.pss * 1024.0;
+
+   return 0;
+}
+
+int alertProcFaults(const Sample *now, const Sample *prev, double *value) {
+   unsigned int faults = FIELD_BIT(FIELD_MINFLT) | FIELD_BIT(FIELD_MAJFLT);
+   double elapsed = 0.0;
+
+   if (prev == NULL || (now->proc.fields & faults) != faults ||
+         (elapsed = (now->proc.timeUsec - prev->proc.timeUsec) / 1000000.0) <= 0.0) {
+      return -1;
+   }
+   *value = counterDelta(now->proc.minorFaults + now->proc.majorFaults,
+         prev->proc.minorFaults + prev->proc.majorFaults) / elapsed;
+
+   return 0;
+}
+
+int alertSysCpu(const Sample *now, const Sample *prev, double *value) {
+   unsigned long long busy = 0, total = 0;
+
+   if (prev == NULL) {
+      return -1;
+   }
+
+   busy = counterDelta(now->sys.cpuUser + now->sys.cpuSystem + now->sys.cpuIrq + now->sys.cpuSoftirq,
+         prev->sys.cpuUser + prev->sys.cpuSystem + prev->sys.cpuIrq + prev->sys.cpuSoftirq);
+   total = busy + counterDelta(now->sys.cpuIdle + now->sys.cpuIowait, prev->sys.cpuIdle + prev->sys.cpuIowait);
+   if (total == 0) {
+      return -1;
+   }
+   *value = 100.0 * busy / total;
+
+   return 0;
+}
+
+int alertSysMem(const Sample *now, const Sample *prev, double *value) {
+   if (now->sys.memTotal == 0) {
+      return -1;
+   }
+   *value = 100.0 * (double)(now->sys.memTotal - now->sys.memFree - now->sys.cached) / now->sys.memTotal;
+
+   return 0;
+}
+
+int alertSysDisk(const Sample *now, const Sample *prev, double *value) {
+   if (prev == NULL) {
+      return -1;
+   }
+   *value = now->sys.diskBusy;
+
+   return 0;
+}
+
+int alertSysLoad(const Sample *now, const Sample *prev, double *value) {
+   *value = now->sys.load1;
+
+   return 0;
+}
+
+int alertCgroupCpu(const Sample *now, const Sample *prev, double *value) {
+   long long elapsed = 0;
+
+   if (prev == NULL || (elapsed = now->cgroup.timeUsec - prev->cgroup.timeUsec) <= 0) {
+      return -1;
+   }
+   *value = 100.0 * counterDelta(now->cgroup.usageUsec, prev->cgroup.usageUsec) / elapsed;
+
+   return 0;
+}
+
+int alertCgroupMem(const Sample *now, const Sample *prev, double *value) {
+   *value = (double)now->cgroup.memoryCurrent;
+
+   return 0;
+}
+
+int alertCgroupPids(const Sample *now, const Sample *prev, double *value) {
+   *value = (double)now->cgroup.pidsCurrent;
+
+   return 0;
+}
+
+int alertCgroupFaults(const Sample *now, const Sample *prev, double *value) {
+   double elapsed = 0.0;
+
+   if (prev == NULL || (elapsed = (now->cgroup.timeUsec - prev->cgroup.timeUsec) / 1000000.0) <= 0.0) {
+      return -1;
+   }
+   *value = counterDelta(now->cgroup.pgfault, prev->cgroup.pgfault) / elapsed;
+
+   return 0;
+}
@@ -0,0 +1,99 @@
+#ifndef __ALERTS_H_
+#define __ALERTS_H_
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "samples.h"
+
+#define ALERT_MAX_RULES 16
+#define ALERT_TEXT_LEN 256
+#define ALERT_BUCKETS 12            // of an avg window
+#define ALERT_MAX_CHILDREN 32       // exec commands running at once
+
+typedef enum {
+   ALERT_PROCESS = 0,
+   ALERT_SYSTEM = 1,
+   ALERT_CGROUP = 2,
+   ALERT_KINDS = 3
+} AlertKind;
+
+typedef enum {
+   ALERT_GT = 0,
+   ALERT_GE = 1,
+   ALERT_LT = 2,
+   ALERT_LE = 3
+} AlertOp;
+
+typedef enum {
+   ALERT_NOW = 0,             // the newest sample alone
+   ALERT_FOR = 1,             // every sample for the window
+   ALERT_AVG = 2              // the mean over the window
+} AlertMode;
+
+typedef enum {
+   ALERT_LOG = 0,
+   ALERT_EXEC = 1,
+   ALERT_KILL = 2
+} AlertAction;
+
+/*
+ * One 'alert' rule, eg. "rss > 8G for 30s" or "cpu% > 90 avg 1m exec
+ * notify.sh"
+ */
+typedef struct {
+   char metric[32];
+   AlertOp op;
+   double threshold;
+   AlertMode mode;
+   long long windowUsec;
+   AlertAction action;
+   char command[ALERT_TEXT_LEN];
+   char text[ALERT_TEXT_LEN];     // the rule as entered, for the records
+} AlertRule;
+
+/*
+ * A rule as one monitor evaluates it.  An avg window is ALERT_BUCKETS time
+ * buckets with a running sum, so each sample costs the same however long
+ * the window is.
+ */
+typedef struct {
+   AlertRule rule;
+   int metric;                    // in the metric table of the monitor's kind
+   int firing;
+   int pending;                   // the action waits for the monitor's locks
+   double value;
+   long long sinceUsec;           // for: when the condition started holding
+   long long firstUsec;           // avg: the first sample in the window
+   long long bucket;              // avg: index of the newest bucket
+   double sum[ALERT_BUCKETS];
+   unsigned long count[ALERT_BUCKETS];
+   double windowSum;
+   unsigned long windowCount;
+} AlertState;
+
+/*
+ * The rules a monitor took when it was added
+ */
+typedef struct {
+   AlertKind kind;
+   int count;
+   AlertState alerts[ALERT_MAX_RULES];
+} AlertSet;
+
+void initAlerts();
+int alertAdd(const char *spec);
+void alertClear();
+void alertList();
+AlertSet *alertSetCreate(AlertKind kind);
+void alertSetDestroy(AlertSet **set);
+void alertEvaluate(AlertSet *set, FILE *fLogFile, pid_t pid, const char *cgroup, SampleHistory *history);
+void alertActions(AlertSet *set, pid_t pid);
+void alertEnd(AlertSet *set, FILE *fLogFile, pid_t pid, const char *cgroup);
+int alertMetric(const char *name, AlertKind kind);
+const char *alertMetricName(int metric);
+int alertMetricValue(int metric, const Sample *now, const Sample *prev, double *value);
+long long alertSampleTime(AlertKind kind, const Sample *sample);
+int alertParseDuration(const char *token, long long *usec);
+
+#endif // __ALERTS_H_
@@ -0,0 +1,191 @@
+/*
+ * Flags samples that stray from a metric's own baseline ('add ... -d')
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "anomaly.h"
+#include "logLibrary.h"
+
+void anomalyRecord(FILE *fLogFile, pid_t pid, const char *cgroup, AnomalyState *state, double value,
+      double deviation, double z);
+
+typedef struct {
+   const char *name;
+   double floor;
+} AnomalyFloor;
+
+/*
+ * The smallest move worth a deviation for each metric name, so a baseline
+ * that sat at exactly 0 (an idle process at 0% cpu) still flags its first
+ * spike without flagging every 1 byte change
+ */
+static const AnomalyFloor anomalyFloors[] = {
+   { "rss", 1048576.0 },
+   { "vsize", 1048576.0 },
+   { "pss", 1048576.0 },
+   { "mem", 1048576.0 },
+   { "cpu%", 2.5 },                // one clock tick in 100 ms (10 points) stays under ANOMALY_Z
+   { "mem%", 1.0 },
+   { "disk%", 1.0 },
+   { "load", 0.1 },
+   { "faults", 1.0 },
+   { "threads", 1.0 },
+   { "fds", 1.0 },
+   { "pids", 1.0 },
+};
+
+#define ANOMALY_FLOORS ((int)(sizeof (anomalyFloors) / sizeof (anomalyFloors[0])))
+
+
+/*
+ * Parses "metric,metric,..." into indices of the alert metric table of kind
+ *
+ * Return: the number of metrics, -1 if one is unknown or there are too many
+ */
+int anomalyParse(const char *spec, AlertKind kind, int *metrics) {
+   char copy[ALERT_TEXT_LEN] = "";
+   char *token = NULL, *save = NULL;
+   int count = 0;
+
+   if (snprintf(copy, ALERT_TEXT_LEN, "%s", spec) >= ALERT_TEXT_LEN) {
+      return -1;
+   }
+
+   for (token = strtok_r(copy, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+      if (count == ANOMALY_MAX_METRICS || (metrics[count] = alertMetric(token, kind)) == -1) {
+         return -1;
+      }
+      count++;
+   }
+
+   return (count == 0) ? -1 : count;
+}
+
+/*
+ * Return: NULL if there are no metrics to watch
+ */
+AnomalySet *anomalySetCreate(const int *metrics, int count) {
+   AnomalySet *set = NULL;
+   int i = 0, j = 0;
+
+   if (count <= 0) {
+      return NULL;
+   }
+
+   if ((set = (AnomalySet *)calloc(1, sizeof (AnomalySet))) == NULL) {
+      perror("calloc failed");
+      exit(-1);
+   }
+
+   set->count = count;
+   for (i = 0; i < count; i++) {
+      set->states[i].metric = metrics[i];
+      for (j = 0; j < ANOMALY_FLOORS; j++) {
+         if (strcmp(anomalyFloors[j].name, alertMetricName(metrics[i])) == 0) {
+            set->states[i].floor = anomalyFloors[j].floor;
+         }
+      }
+   }
+
+   return set;
+}
+
+void anomalySetDestroy(AnomalySet **set) {
+   free(*set);
+   *set = NULL;
+
+   return;
+}
+
+/*
+ * Scores the newest sample of history against each baseline and logs an
+ * [ANOMALY] record for every metric more than ANOMALY_Z deviations away.
+ * The deviation never counts as less than ANOMALY_FLOOR of the mean or the
+ * metric's own floor, so a metric that held perfectly still is not flagged
+ * for the first small move.  Flagged samples stay out of the baseline so
+ * one anomaly does not widen the band around the next; ANOMALY_SHIFT of
+ * them in a row are a new level and restart the baseline from there.  The
+ * caller holds the monitor's log file.
+ */
+void anomalyEvaluate(AnomalySet *set, FILE *fLogFile, pid_t pid, const char *cgroup, SampleHistory *history) {
+   AnomalyState *state = NULL;
+   const Sample *now = NULL, *prev = NULL;
+   double value = 0.0, diff = 0.0, deviation = 0.0, z = 0.0;
+   int i = 0;
+
+   if (set == NULL || history == NULL || history->count == 0) {
+      return;
+   }
+
+   now = historyLatest(history);
+   prev = (history->count >= 2) ? historyGet(history, history->count - 2) : NULL;
+
+   for (i = 0; i < set->count; i++) {
+      state = &(set->states[i]);
+      if (alertMetricValue(state->metric, now, prev, &value) == -1) {
+         continue;
+      }
+
+      if (state->samples == 0) {
+         state->mean = value;
+         state->variance = 0.0;
+         state->samples++;
+         continue;
+      }
+
+      diff = value - state->mean;
+
+      if (state->samples >= ANOMALY_WARMUP) {
+         deviation = sqrt(state->variance);
+         if (deviation < ANOMALY_FLOOR * fabs(state->mean)) {
+            deviation = ANOMALY_FLOOR * fabs(state->mean);
+         }
+         if (deviation < state->floor) {
+            deviation = state->floor;
+         }
+         if (deviation > 0.0 && fabs(z = diff / deviation) > ANOMALY_Z) {
+            state->flagged++;
+            anomalyRecord(fLogFile, pid, cgroup, state, value, deviation, z);
+            if (++(state->run) >= ANOMALY_SHIFT) {
+               state->mean = value;
+               state->variance = 0.0;
+               state->samples = 1;
+               state->run = 0;
+            }
+            continue;
+         }
+         state->run = 0;
+      }
+
+      // exponentially weighted mean and variance (Finch, 2009)
+      state->mean += ANOMALY_ALPHA * diff;
+      state->variance = (1.0 - ANOMALY_ALPHA) * (state->variance + ANOMALY_ALPHA * diff * diff);
+      state->samples++;
+   }
+
+   return;
+}
+
+void anomalyRecord(FILE *fLogFile, pid_t pid, const char *cgroup, AnomalyState *state, double value,
+      double deviation, double z) {
+   char timeStr[MAX_TIME_LEN] = "";
+
+   fprintf(fLogFile, "[%s] ", generateLogTime(timeStr));
+   if (cgroup != NULL && cgroup[0] != '\0') {
+      fprintf(fLogFile, "Cgroup(%s) ", cgroup);
+   } else if (pid < 0) {
+      fprintf(fLogFile, "System ");
+   } else {
+      fprintf(fLogFile, "Process(%d) ", pid);
+   }
+   fprintf(fLogFile, " [ANOMALY] %s value %.2f baseline %.2f deviation %.2f z %.1f flagged %lu\n",
+         alertMetricName(state->metric), value, state->mean, deviation, z, state->flagged);
+   fflush(fLogFile);
+
+   return;
+}
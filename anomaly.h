@@ -0,0 +1,44 @@
+#ifndef __ANOMALY_H_
+#define __ANOMALY_H_
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "samples.h"
+#include "alerts.h"
+
+#define ANOMALY_MAX_METRICS 8
+#define ANOMALY_ALPHA 0.05          // weight of the newest sample in the baseline
+#define ANOMALY_WARMUP 20           // samples before anything is flagged
+#define ANOMALY_Z 4.0               // flag beyond this many deviations
+#define ANOMALY_FLOOR 0.01          // deviation of at least this fraction of the mean
+#define ANOMALY_SHIFT 20            // flagged samples in a row that become the new baseline
+
+/*
+ * The baseline of one metric of one monitor: an exponentially weighted
+ * mean and variance, so a sample costs the same however long it has run
+ */
+typedef struct {
+   int metric;                      // in the alert metric table
+   unsigned long samples;
+   double mean;
+   double variance;
+   double floor;                    // smallest deviation, in the metric's unit
+   unsigned long flagged;
+   unsigned long run;               // flagged samples in a row
+} AnomalyState;
+
+/*
+ * The metrics of 'add ... -d <metric,...>'
+ */
+typedef struct {
+   int count;
+   AnomalyState states[ANOMALY_MAX_METRICS];
+} AnomalySet;
+
+int anomalyParse(const char *spec, AlertKind kind, int *metrics);
+AnomalySet *anomalySetCreate(const int *metrics, int count);
+void anomalySetDestroy(AnomalySet **set);
+void anomalyEvaluate(AnomalySet *set, FILE *fLogFile, pid_t pid, const char *cgroup, SampleHistory *history);
+
+#endif // __ANOMALY_H_
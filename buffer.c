@@ -0,0 +1,141 @@
+/*
+ * Growable byte buffer used to build responses and pages in memory.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "buffer.h"
+
+void bufferInit(Buffer *buf) {
+   buf->data = NULL;
+   buf->len = 0;
+   buf->cap = 0;
+
+   return;
+}
+
+void bufferFree(Buffer *buf) {
+   free(buf->data);
+   bufferInit(buf);
+
+   return;
+}
+
+void bufferReserve(Buffer *buf, size_t extra) {
+   size_t newCap = (buf->cap == 0) ? BUFFER_INITIAL_SIZE : buf->cap;
+   char *newData = NULL;
+
+   if (buf->len + extra <= buf->cap) {
+      return;
+   }
+
+   while (newCap < buf->len + extra) {
+      newCap *= 2;
+   }
+
+   if ((newData = realloc(buf->data, newCap)) == NULL) {
+      perror("realloc failed");
+      exit(-1);
+   }
+
+   buf->data = newData;
+   buf->cap = newCap;
+
+   return;
+}
+
+void bufferAppend(Buffer *buf, const void *data, size_t len) {
+   if (len == 0) {
+      return;
+   }
+
+   bufferReserve(buf, len);
+   memcpy(buf->data + buf->len, data, len);
+   buf->len += len;
+
+   return;
+}
+
+void bufferAppendStr(Buffer *buf, const char *str) {
+   bufferAppend(buf, str, strlen(str));
+
+   return;
+}
+
+void bufferAppendUnsigned(Buffer *buf, unsigned long long value) {
+   char digits[24];
+   int i = sizeof (digits);
+
+   do {
+      digits[--i] = '0' + (value % 10);
+      value /= 10;
+   } while (value != 0);
+
+   bufferAppend(buf, digits + i, sizeof (digits) - i);
+
+   return;
+}
+
+void bufferAppendSigned(Buffer *buf, long long value) {
+   if (value < 0) {
+      bufferAppend(buf, "-", 1);
+      bufferAppendUnsigned(buf, -(unsigned long long)value);
+      return;
+   }
+
+   bufferAppendUnsigned(buf, value);
+
+   return;
+}
+
+void bufferPrintf(Buffer *buf, const char *fmt, ...) {
+   va_list ap;
+   int needed = 0;
+
+   bufferReserve(buf, 256);
+
+   va_start(ap, fmt);
+   needed = vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, ap);
+   va_end(ap);
+
+   if (needed < 0) {
+      perror("vsnprintf failed");
+      exit(-1);
+   }
+
+   if ((size_t)needed >= buf->cap - buf->len) {
+      bufferReserve(buf, needed + 1);
+      va_start(ap, fmt);
+      vsnprintf(buf->data + buf->len, buf->cap - buf->len, fmt, ap);
+      va_end(ap);
+   }
+
+   buf->len += needed;
+
+   return;
+}
+
+/*
+ * Drops len bytes from the front of the buffer (ie. bytes already sent)
+ */
+void bufferConsume(Buffer *buf, size_t len) {
+   if (len >= buf->len) {
+      buf->len = 0;
+      return;
+   }
+
+   memmove(buf->data, buf->data + len, buf->len - len);
+   buf->len -= len;
+
+   return;
+}
+
+void bufferReset(Buffer *buf) {
+   buf->len = 0;
+
+   return;
+}
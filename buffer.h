@@ -0,0 +1,27 @@
+
+#ifndef __BUFFER_H_
+#define __BUFFER_H_
+
+#include <stddef.h>
+
+#define BUFFER_INITIAL_SIZE 4096
+
+typedef struct {
+   char *data;
+   size_t len;
+   size_t cap;
+} Buffer;
+
+void bufferInit(Buffer *buf);
+void bufferFree(Buffer *buf);
+void bufferReserve(Buffer *buf, size_t extra);
+void bufferAppend(Buffer *buf, const void *data, size_t len);
+void bufferAppendStr(Buffer *buf, const char *str);
+void bufferAppendUnsigned(Buffer *buf, unsigned long long value);
+void bufferAppendSigned(Buffer *buf, long long value);
+void bufferPrintf(Buffer *buf, const char *fmt, ...)
+   __attribute__((format(printf, 2, 3)));
+void bufferConsume(Buffer *buf, size_t len);
+void bufferReset(Buffer *buf);
+
+#endif // __BUFFER_H_
@@ -0,0 +1,644 @@
+/*
+ * Monitor of one cgroup v2 directory
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <semaphore.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "mond.h"
+#include "cgroupThread.h"
+#include "logLibrary.h"
+#include "governor.h"
+#include "scheduler.h"
+#include "keyedStats.h"
+#include "eventStream.h"
+#include "singlyLinkedList.h"
+
+#define CGROUP_PATH_LEN (MAX_INPUT_LEN + 32)
+
+// the cpu.stat and memory.stat fields, in the order of CgroupField
+#define CGROUP_CPU_FIELDS "usage_usec,user_usec,system_usec,nr_periods,nr_throttled,throttled_usec"
+#define CGROUP_MEMORY_FIELDS "anon,file,kernel,shmem,pgfault,pgmajfault"
+
+typedef enum {
+   CG_USAGE = 0,
+   CG_USER = 1,
+   CG_SYSTEM = 2,
+   CG_PERIODS = 3,
+   CG_THROTTLED = 4,
+   CG_THROTTLED_USEC = 5
+} CgroupCpuField;
+
+typedef enum {
+   CG_ANON = 0,
+   CG_FILE = 1,
+   CG_KERNEL = 2,
+   CG_SHMEM = 3,
+   CG_PGFAULT = 4,
+   CG_PGMAJFAULT = 5
+} CgroupMemoryField;
+
+/*
+ * Files of the cgroup, kept open between ticks.  Only cpu.stat is always
+ * there, the others need their controller enabled in the parent and are -1
+ * otherwise.
+ */
+typedef struct {
+   int fdCpu;
+   int fdMemory;
+   int fdMemoryStat;
+   int fdIo;
+   int fdPids;
+   KeyedStats cpu;
+   KeyedStats memory;
+   Buffer raw;
+} CgroupStats;
+
+void openCgroupFiles(const char *dir, CgroupStats *stats);
+int openCgroupFile(const char *dir, const char *name);
+int sampleCgroup(ThreadTable *line, CgroupStats *stats, CgroupSample *sample);
+unsigned long long cgroupValue(int fd, Buffer *raw);
+void cgroupIoTotals(const char *buf, CgroupSample *sample);
+void chartCgroup(SampleHistory *history, CgroupSample *sample);
+void printCgroupLogs(FILE *fLogFile, const char *dir, CgroupSample *sample);
+void closeCgroupFiles(CgroupStats *stats);
+
+extern sem_t availableThreads;
+extern LinkedList *completedList;
+extern int alignTicks;
+
+
+void *cgroupThread(void *args) {
+   ThreadTable *threadTableLine = NULL;
+   int value = -1;
+   int stop = 0;
+   unsigned long sleepTime = -1;
+   long long cpuStart = 0;
+   long long dueUsec = 0;
+   PriorityClass priority = PRIORITY_NORMAL;
+   GovernorState governed = { 1.0, 0.0, 0.0 };
+   struct timeval startTime, endTime;
+   unsigned long offsetTime = -1;
+   CgroupSample sample;
+   CgroupStats stats;
+
+   ThreadTable *threadTableHandle = (ThreadTable *)args;
+
+   // set before the thread starts and never changed
+   priority = threadTableHandle->priority;
+   schedulerSlack(priority, threadTableHandle->interval);
+
+   // the directory is set before the thread starts and only this thread clears it
+   openCgroupFiles(threadTableHandle->cgroup, &stats);
+
+   if ((threadTableLine = (ThreadTable *)calloc(1, sizeof (ThreadTable))) == NULL) {
+      perror("calloc failed");
+      exit(-1);
+   }
+
+   while (1) {
+
+      if (gettimeofday(&startTime, NULL) == -1) {
+         perror("gettimeofday failed");
+         exit(-1);
+      }
+      cpuStart = governorThreadCpu();
+      schedulerEnter(priority, dueUsec, sleepTime);
+
+      /*
+       *  What threads use this critical section:
+       *    Only the individual cgroup thread uses this critical section.
+       *
+       *  What shared resources are being protected:
+       *    This thread's line of the threadTable is the only resource locked.
+       *    We lock the whole line of the threadTable, but are interested in
+       *    the history, endStatus and fileTable reference.
+       *
+       *  Line justification and performance concerns:
+       *    Every line in this critical section (except error handling) must
+       *    use the shared resources and therefore, must be locked.  As for
+       *    performance concerns, the reads of the open cgroup files and the
+       *    print may take a small amount of time.  The information locked
+       *    and used is absolutely necessary to proper functioning.  Also,
+       *    only the command and webmon threads may block while trying to get
+       *    access to the threadTable.
+       *
+       *  Mutex vs. semaphore decision:
+       *    A mutex was used because we only had resources that were
+       *    mutually exclusive.  Either it was in use or it wasn't.
+       *
+       */
+
+      // lock outer
+      if (pthread_mutex_lock(&(threadTableHandle->mutex)) != 0) {
+         perror("pthread_mutex_lock failed");
+         exit(-1);
+      }
+
+      /*
+       *  What threads use this critical section:
+       *    Only the individual cgroup thread uses this critical section.
+       *
+       *  What shared resources are being protected:
+       *    This thread's line of the fileTable is the only resource locked.
+       *    We lock the whole line of the fileTable, but are interested in
+       *    the file pointer.
+       *
+       *  Line justification and performance concerns:
+       *    Every line in this critical section (except error handling and stop
+       *    flags) must use the shared resources and therefore, must be locked.
+       *    The information locked and used is absolutely necessary to proper
+       *    functioning.  All other threads may block while trying to get
+       *    access to the fileTable. As for performance concerns, print may
+       *    take a small amount of time blocking for writing the logs.
+       *    Contention for the fileTable is mitigated by taking into account
+       *    the amount of time to acquire the locks when writing to the logs
+       *    (ie. the offset is subtracted from the interval time).
+       *
+       *  Mutex vs. semaphore decision:
+       *    A mutex was used because we only had resources that were
+       *    mutually exclusive.  Either it was in use or it wasn't.
+       *
+       */
+
+      // lock inner
+      if (pthread_mutex_lock(&(threadTableHandle->fTable->mutex)) != 0) {
+         perror("pthread_mutex_lock failed");
+         exit(-1);
+      }
+
+      // critical section
+      if (sampleCgroup(threadTableHandle, &stats, &sample) == 0) {
+         printCgroupLogs(threadTableHandle->fTable->filep, threadTableHandle->cgroup, &sample);
+         alertEvaluate(threadTableHandle->alerts, threadTableHandle->fTable->filep, threadTableHandle->pid,
+               threadTableHandle->cgroup, threadTableHandle->history);
+         anomalyEvaluate(threadTableHandle->anomalies, threadTableHandle->fTable->filep, threadTableHandle->pid,
+               threadTableHandle->cgroup, threadTableHandle->history);
+         quantileUpdate(&(threadTableHandle->quantiles), threadTableHandle->history);
+         summaryUpdate(&(threadTableHandle->summary), threadTableHandle->history, sleepTime);
+         if (governorChanged(&governed) != 0) {
+            governorPrint(threadTableHandle->fTable->filep, &governed);
+         }
+      } else if (threadTableHandle->endStatus == RUNNING) {
+         // the cgroup was removed
+         threadTableHandle->endStatus = EXITED;
+      }
+
+      // unlock inner
+      if (pthread_mutex_unlock(&(threadTableHandle->fTable->mutex)) != 0) {
+         perror("pthread_mutex_unlock failed");
+         exit(-1);
+      }
+
+      // unlock unlock outer
+      if (pthread_mutex_unlock(&(threadTableHandle->mutex)) != 0) {
+         perror("pthread_mutex_unlock failed");
+         exit(-1);
+      }
+
+      schedulerLeave();
+
+      // only this thread touches its alert state
+      alertActions(threadTableHandle->alerts, threadTableHandle->pid);
+
+      /*
+       *  What threads use this critical section:
+       *    Only the individual cgroup thread uses this critical section.
+       *
+       *  What shared resources are being protected:
+       *    This thread's line of the threadTable is the only resource locked.
+       *    We lock the whole line of the threadTable because we are interested
+       *    in the endStatus.  Optionally, we are interesting in all of the
+       *    fields if we are in fact exiting because they are used or reset
+       *    (for cleaning up).
+       *
+       *  Line justification and performance concerns:
+       *    Every line in this critical section (except error handling and the
+       *    stop flags) must use the shared resources and therefore, must be
+       *    locked.  The information locked and used is absolutely necessary
+       *    to proper functioning.  Also, as for performance concerns only
+       *    the command thread may block while to trying to get access to the
+       *    threadTable, but is of little concern because it will only lock for
+       *    a short amount of time to perform the exit check or a longer time (on
+       *    its way to exiting and cleaning up).
+       *
+       *  Mutex vs. semaphore decision:
+       *    A mutex was used because we only had resources that were
+       *    mutually exclusive.  Either it was in use or it wasn't.
+       *
+       */
+
+      // Check to Terminate Thread
+      // lock outer
+      if (pthread_mutex_lock(&(threadTableHandle->mutex)) != 0) {
+         perror("pthread_mutex_lock failed");
+         exit(-1);
+      }
+
+      // critical section
+      if (threadTableHandle->endStatus != RUNNING) {
+
+         // copy table entry for linked list
+         memcpy(threadTableLine, threadTableHandle, sizeof (ThreadTable));
+
+         /*
+          *  What threads use this critical section:
+          *    Only the individual cgroup thread uses this critical section.
+          *
+          *  What shared resources are being protected:
+          *    This thread's line of the fileTable is the only resource locked.
+          *    We lock the whole line of the fileTable, but are interested in
+          *    the count semaphore and optionally other fields if we are the
+          *    last to use the file.
+          *
+          *  Line justification and performance concerns:
+          *    Every line in this critical section (except error handling) must
+          *    use the shared resources and therefore, must be locked. The
+          *    information locked and used is absolutely necessary to proper
+          *    functioning.  All other threads may block while trying to get
+          *    access to the fileTable. As for performance concerns, close may
+          *    take a small amount of time.  Contention for the fileTable is
+          *    mitigated by taking into account the amount of time to acquire
+          *    the locks when writing to the logs (ie. the offset is subtracted
+          *    from the interval time).
+          *
+          *  Mutex vs. semaphore decision:
+          *    A mutex was used because we only had resources that were
+          *    mutually exclusive.  Either it was in use or it wasn't.
+          *
+          */
+
+         // clean up file table (close if necessary)
+         // lock inner
+         if (pthread_mutex_lock(&(threadTableHandle->fTable->mutex)) != 0) {
+            perror("pthread_mutex_lock failed");
+            exit(-1);
+         }
+
+         // critical section
+         alertEnd(threadTableHandle->alerts, threadTableHandle->fTable->filep, threadTableHandle->pid, threadTableHandle->cgroup);
+         if (sem_wait(&(threadTableHandle->fTable->count)) == -1) {
+            perror("sem_wait failed");
+            exit(-1);
+         }
+
+         if (sem_getvalue(&(threadTableHandle->fTable->count), &value) == -1) {
+            perror("sem_getvalue failed");
+            exit(-1);
+         }
+
+         if (value == 0) { // last thread using file
+            fclose(threadTableHandle->fTable->filep);
+            // clean up file table
+            threadTableHandle->fTable->filep = NULL;
+            threadTableHandle->fTable->dev = 0;
+            threadTableHandle->fTable->inode = 0;
+         }
+
+         // unlock inner
+         if (pthread_mutex_unlock(&(threadTableHandle->fTable->mutex)) != 0) {
+            perror("pthread_mutex_unlock failed");
+            exit(-1);
+         }
+
+         // clean up thread table
+         threadTableHandle->tid = 0;
+         threadTableHandle->pid = 0;
+         threadTableHandle->fTable = NULL;
+         threadTableHandle->interval = 0;
+         threadTableHandle->priority = PRIORITY_NORMAL;
+         threadTableHandle->startTime = 0;
+         threadTableHandle->endTime = 0;
+         threadTableHandle->endStatus = RUNNING;
+         threadTableHandle->executable[0] = '\0';
+         threadTableHandle->cgroup[0] = '\0';
+         historyDestroy(&(threadTableHandle->history));
+         threadTableLine->history = NULL;
+         alertSetDestroy(&(threadTableHandle->alerts));
+         threadTableLine->alerts = NULL;
+         anomalySetDestroy(&(threadTableHandle->anomalies));
+         threadTableLine->anomalies = NULL;
+
+         stop = 1;
+      }
+
+      sleepTime = threadTableHandle->interval;
+
+      // unlock unlock outer
+      if (pthread_mutex_unlock(&(threadTableHandle->mutex)) != 0) {
+         perror("pthread_mutex_unlock failed");
+         exit(-1);
+      }
+
+      if (stop == 1) {
+         break;
+      }
+
+      sleepTime = governorCharge(governorThreadCpu() - cpuStart, sleepTime, priority);
+      dueUsec = startTime.tv_sec * CONVERT_SEC_TO_USEC + startTime.tv_usec + sleepTime;
+
+      if (gettimeofday(&endTime, NULL) == -1) {
+         perror("gettimeofday failed");
+         exit(-1);
+      }
+
+      offsetTime = (endTime.tv_sec * CONVERT_SEC_TO_USEC + endTime.tv_usec) -
+         (startTime.tv_sec * CONVERT_SEC_TO_USEC + startTime.tv_usec);
+
+      // wait interval time
+      if (alignTicks != 0) {
+         dueUsec = schedulerAlign(sleepTime);
+         longSleep(dueUsec - currentTimeUsec());
+      } else {
+         longSleep(sleepTime - offsetTime);
+      }
+   }
+
+   closeCgroupFiles(&stats);
+
+   threadTableLine->endTime = time(NULL);
+
+   /*
+    *  What threads use this critical section:
+    *    Only the cgroup thread uses this critical section.
+    *
+    *  What shared resources are being protected:
+    *    The linked list of completed tasks is the only resource locked.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling) must use
+    *    the shared resources and therefore, must be locked.  As for performance
+    *    concerns none of the lines should block for extended periods of time
+    *    and all of the information locked and used is absolutely necessary
+    *    to proper functioning.  Also, only the command thread or another dying
+    *    tread would block waiting for access to the linked list which should
+    *    be of little concern since they are dead and the linked list insert
+    *    will be fast since we keep a tail reference rather than using
+    *    traversal.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // linked list - add node
+   // lock linked list
+   if (pthread_mutex_lock(&(completedList->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (LLInsertTail(completedList, threadTableLine) == -1) {
+      perror("calloc failed");
+      exit(-1);
+   }
+
+   // unlock linked list
+   if (pthread_mutex_unlock(&(completedList->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   // the list owns the copy from here on and never changes it
+   eventCompleted(threadTableLine);
+   eventFiles();
+
+   sem_post(&availableThreads);
+
+   return NULL;
+}
+
+/*
+ * Return: 1 if dir looks like a cgroup v2 directory, 0 otherwise
+ */
+int isCgroupDir(const char *dir) {
+   char path[CGROUP_PATH_LEN] = "";
+
+   snprintf(path, sizeof (path), "%s/cgroup.procs", dir);
+   if (access(path, F_OK) != 0) {
+      return 0;
+   }
+
+   snprintf(path, sizeof (path), "%s/cpu.stat", dir);
+
+   return (access(path, R_OK) == 0) ? 1 : 0;
+}
+
+void openCgroupFiles(const char *dir, CgroupStats *stats) {
+   stats->fdCpu = openCgroupFile(dir, "cpu.stat");
+   stats->fdMemory = openCgroupFile(dir, "memory.current");
+   stats->fdMemoryStat = openCgroupFile(dir, "memory.stat");
+   stats->fdIo = openCgroupFile(dir, "io.stat");
+   stats->fdPids = openCgroupFile(dir, "pids.current");
+
+   keyedStatsInit(&(stats->cpu));
+   keyedStatsAddList(&(stats->cpu), CGROUP_CPU_FIELDS);
+   keyedStatsBuild(&(stats->cpu));
+   keyedStatsInit(&(stats->memory));
+   keyedStatsAddList(&(stats->memory), CGROUP_MEMORY_FIELDS);
+   keyedStatsBuild(&(stats->memory));
+   bufferInit(&(stats->raw));
+
+   return;
+}
+
+/*
+ * Return: the open file, -1 if the cgroup does not have it
+ */
+int openCgroupFile(const char *dir, const char *name) {
+   char path[CGROUP_PATH_LEN] = "";
+
+   snprintf(path, sizeof (path), "%s/%s", dir, name);
+
+   return open(path, O_RDONLY);
+}
+
+/*
+ * Reads the cgroup files once and records the values in the history.  The
+ * caller holds the table row lock.
+ *
+ * Return: 0 on success, -1 if the cgroup went away
+ */
+int sampleCgroup(ThreadTable *line, CgroupStats *stats, CgroupSample *sample) {
+   struct stat info;
+
+   memset(sample, 0, sizeof (CgroupSample));
+   sample->timeUsec = currentTimeUsec();
+
+   // a removed cgroup fails every read of the files it had open (a copy
+   // of the tree outside cgroupfs only loses its links)
+   if (stats->fdCpu == -1 || fstat(stats->fdCpu, &info) == -1 || info.st_nlink == 0 ||
+         keyedStatsUpdate(&(stats->cpu), stats->fdCpu, sample->timeUsec) != 0) {
+      return -1;
+   }
+
+   sample->usageUsec = stats->cpu.fields[CG_USAGE].value;
+   sample->userUsec = stats->cpu.fields[CG_USER].value;
+   sample->systemUsec = stats->cpu.fields[CG_SYSTEM].value;
+   sample->nrPeriods = stats->cpu.fields[CG_PERIODS].value;
+   sample->nrThrottled = stats->cpu.fields[CG_THROTTLED].value;
+   sample->throttledUsec = stats->cpu.fields[CG_THROTTLED_USEC].value;
+
+   sample->memoryCurrent = cgroupValue(stats->fdMemory, &(stats->raw));
+   if (stats->fdMemoryStat != -1 &&
+         keyedStatsUpdate(&(stats->memory), stats->fdMemoryStat, sample->timeUsec) == 0) {
+      sample->anon = stats->memory.fields[CG_ANON].value;
+      sample->file = stats->memory.fields[CG_FILE].value;
+      sample->kernel = stats->memory.fields[CG_KERNEL].value;
+      sample->shmem = stats->memory.fields[CG_SHMEM].value;
+      sample->pgfault = stats->memory.fields[CG_PGFAULT].value;
+      sample->pgmajfault = stats->memory.fields[CG_PGMAJFAULT].value;
+   }
+
+   if (stats->fdIo != -1 && readProcBuffer(stats->fdIo, &(stats->raw)) >= 0) {
+      cgroupIoTotals(stats->raw.data, sample);
+   }
+
+   sample->pidsCurrent = cgroupValue(stats->fdPids, &(stats->raw));
+
+   if (line->history != NULL) {
+      Sample *slot = historyPush(line->history);
+      slot->cgroup = *sample;
+      chartCgroup(line->history, sample);
+      eventSample(line, slot);
+   }
+
+   return 0;
+}
+
+/*
+ * Return: the number a single value file holds, 0 if it is missing
+ */
+unsigned long long cgroupValue(int fd, Buffer *raw) {
+   const char *cursor = NULL;
+
+   if (fd == -1 || readProcBuffer(fd, raw) <= 0) {
+      return 0;
+   }
+
+   cursor = raw->data;
+
+   return parseUnsigned(&cursor);
+}
+
+/*
+ * Note: every line is "major:minor rbytes=N wbytes=N rios=N wios=N ..."
+ */
+void cgroupIoTotals(const char *buf, CgroupSample *sample) {
+   const char *cursor = buf, *key = NULL;
+   unsigned long long value = 0;
+   size_t len = 0;
+
+   while (*cursor != '\0') {
+      // skip the separator (or the device before the first key)
+      while (*cursor != ' ' && *cursor != '\n' && *cursor != '\0') {
+         cursor++;
+      }
+      while (*cursor == ' ' || *cursor == '\n') {
+         cursor++;
+      }
+
+      key = cursor;
+      while (*cursor != '=' && *cursor != ' ' && *cursor != '\n' && *cursor != '\0') {
+         cursor++;
+      }
+      if (*cursor != '=') {
+         continue;
+      }
+
+      len = cursor - key;
+      cursor++;
+      value = parseUnsigned(&cursor);
+
+      if (len == 6 && strncmp(key, "rbytes", 6) == 0) {
+         sample->ioReadBytes += value;
+      } else if (len == 6 && strncmp(key, "wbytes", 6) == 0) {
+         sample->ioWriteBytes += value;
+      } else if (len == 4 && strncmp(key, "rios", 4) == 0) {
+         sample->ioReads += value;
+      } else if (len == 4 && strncmp(key, "wios", 4) == 0) {
+         sample->ioWrites += value;
+      }
+   }
+
+   return;
+}
+
+/*
+ * Adds memory.current (MB) and the cpu use (percent of one cpu since the
+ * previous sample) of the newest sample to the monitor's chart
+ */
+void chartCgroup(SampleHistory *history, CgroupSample *sample) {
+   CgroupSample *prev = NULL;
+   float values[CHART_MAX_LINES] = { 0 };
+   double elapsed = 0.0;
+
+   if (history->count < 2) {
+      return;
+   }
+
+   prev = &(historyGet(history, history->count - 2)->cgroup);
+   elapsed = (sample->timeUsec - prev->timeUsec) / 1000000.0;
+   if (elapsed <= 0.0) {
+      return;
+   }
+
+   if (history->chart == NULL) {
+      history->chart = chartCreate();
+   }
+
+   values[0] = (float)(sample->memoryCurrent / (1024.0 * 1024.0));
+   values[1] = (float)(100.0 * counterDelta(sample->usageUsec, prev->usageUsec) / (1000000.0 * elapsed));
+   chartPush(history->chart, sample->timeUsec, values);
+
+   return;
+}
+
+void printCgroupLogs(FILE *fLogFile, const char *dir, CgroupSample *sample) {
+   char timeStr[MAX_INPUT_LEN] = "";
+
+   // log statistics
+   fprintf(fLogFile, "[%s] Cgroup(%s) ", generateLogTime(timeStr), dir);
+   fprintf(fLogFile, " [CPU] usageusec %llu userusec %llu systemusec %llu nrperiods %llu"
+         " nrthrottled %llu throttledusec %llu",
+         sample->usageUsec, sample->userUsec, sample->systemUsec, sample->nrPeriods,
+         sample->nrThrottled, sample->throttledUsec);
+   fprintf(fLogFile, " [MEMORY] current %llu anon %llu file %llu kernel %llu shmem %llu"
+         " pgfault %llu pgmajfault %llu",
+         sample->memoryCurrent, sample->anon, sample->file, sample->kernel, sample->shmem,
+         sample->pgfault, sample->pgmajfault);
+   fprintf(fLogFile, " [IO] rbytes %llu wbytes %llu rios %llu wios %llu",
+         sample->ioReadBytes, sample->ioWriteBytes, sample->ioReads, sample->ioWrites);
+   fprintf(fLogFile, " [PIDS] current %llu", sample->pidsCurrent);
+   fprintf(fLogFile, "\n");
+
+   return;
+}
+
+void closeCgroupFiles(CgroupStats *stats) {
+   int *fds[] = { &(stats->fdCpu), &(stats->fdMemory), &(stats->fdMemoryStat), &(stats->fdIo), &(stats->fdPids) };
+   int i = 0;
+
+   for (i = 0; i < (int)(sizeof (fds) / sizeof (fds[0])); i++) {
+      if (*fds[i] != -1) {
+         close(*fds[i]);
+         *fds[i] = -1;
+      }
+   }
+
+   keyedStatsDestroy(&(stats->cpu));
+   keyedStatsDestroy(&(stats->memory));
+   bufferFree(&(stats->raw));
+
+   return;
+}
@@ -0,0 +1,7 @@
+#ifndef __CGROUP_THREAD_H_
+#define __CGROUP_THREAD_H_
+
+void *cgroupThread(void *args);
+int isCgroupDir(const char *dir);
+
+#endif // __CGROUP_THREAD_H_
@@ -0,0 +1,372 @@
+/*
+ * Self-contained charts: long per-monitor series downsampled with
+ * Largest-Triangle-Three-Buckets and drawn as inline SVG, so the page needs
+ * no script or network access to show them.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "chart.h"
+#include "htmlTemplate.h"
+
+#define CHART_MARGIN_LEFT 56
+#define CHART_MARGIN_RIGHT 8
+#define CHART_MARGIN_TOP 22
+#define CHART_MARGIN_BOTTOM 20
+#define CHART_LEGEND_X 220
+#define CHART_LEGEND_STEP 90
+
+void chartAppendFixed(Buffer *out, double value);
+void chartAppendValue(Buffer *out, double value);
+void chartAppendTime(Buffer *out, long long timeUsec);
+
+static const char *chartColors[CHART_MAX_LINES] = { "#1f77b4", "#d62728", "#2ca02c" };
+
+// width, height, width, height, title
+static const Fragment chartHeadTemplate[] = {
+   FRAGMENT("\
+      <svg xmlns=\"http://www.w3.org/2000/svg\" width=\"", SLOT_SIGNED),
+   FRAGMENT("\" height=\"", SLOT_SIGNED),
+   FRAGMENT("\" viewBox=\"0 0 ", SLOT_SIGNED),
+   FRAGMENT(" ", SLOT_SIGNED),
+   FRAGMENT("\" font-family=\"sans-serif\" font-size=\"11\">\n\
+         <text x=\"4\" y=\"14\" font-weight=\"bold\">", SLOT_TEXT),
+   FRAGMENT("</text>\n", SLOT_END)
+};
+
+// x, color, name
+static const Fragment chartLegendTemplate[] = {
+   FRAGMENT("\
+         <text x=\"", SLOT_SIGNED),
+   FRAGMENT("\" y=\"14\" fill=\"", SLOT_RAW),
+   FRAGMENT("\">", SLOT_TEXT),
+   FRAGMENT("</text>\n", SLOT_END)
+};
+
+// plot x, y, width, height, label x, label y (followed by the maximum)
+static const Fragment chartFrameTemplate[] = {
+   FRAGMENT("\
+         <rect x=\"", SLOT_SIGNED),
+   FRAGMENT("\" y=\"", SLOT_SIGNED),
+   FRAGMENT("\" width=\"", SLOT_SIGNED),
+   FRAGMENT("\" height=\"", SLOT_SIGNED),
+   FRAGMENT("\" fill=\"none\" stroke=\"#ccc\"/>\n\
+         <text x=\"", SLOT_SIGNED),
+   FRAGMENT("\" y=\"", SLOT_SIGNED),
+   FRAGMENT("\" text-anchor=\"end\">", SLOT_END)
+};
+
+// zero label x, y, time label x, y (followed by the first time)
+static const Fragment chartAxisTemplate[] = {
+   FRAGMENT("</text>\n\
+         <text x=\"", SLOT_SIGNED),
+   FRAGMENT("\" y=\"", SLOT_SIGNED),
+   FRAGMENT("\" text-anchor=\"end\">0</text>\n\
+         <text x=\"", SLOT_SIGNED),
+   FRAGMENT("\" y=\"", SLOT_SIGNED),
+   FRAGMENT("\">", SLOT_END)
+};
+
+// label x, label y (followed by the last time)
+static const Fragment chartEndTimeTemplate[] = {
+   FRAGMENT("</text>\n\
+         <text x=\"", SLOT_SIGNED),
+   FRAGMENT("\" y=\"", SLOT_SIGNED),
+   FRAGMENT("\" text-anchor=\"end\">", SLOT_END)
+};
+
+// color (followed by the points)
+static const Fragment chartLineTemplate[] = {
+   FRAGMENT("\
+         <polyline fill=\"none\" stroke-width=\"1.5\" stroke=\"", SLOT_RAW),
+   FRAGMENT("\" points=\"", SLOT_END)
+};
+
+// x, y
+static const Fragment chartEmptyTemplate[] = {
+   FRAGMENT("\
+         <text x=\"", SLOT_SIGNED),
+   FRAGMENT("\" y=\"", SLOT_SIGNED),
+   FRAGMENT("\" fill=\"#888\">waiting for samples</text>\n", SLOT_END)
+};
+
+
+ChartSeries *chartCreate() {
+   ChartSeries *series = NULL;
+
+   if ((series = (ChartSeries *)calloc(1, sizeof (ChartSeries))) == NULL) {
+      perror("calloc failed");
+      exit(-1);
+   }
+
+   series->lines = CHART_ALL_LINES;
+   series->stride = 1;
+
+   return series;
+}
+
+void chartDestroy(ChartSeries **series) {
+   free(*series);
+   *series = NULL;
+
+   return;
+}
+
+void chartPush(ChartSeries *series, long long timeUsec, const float *values) {
+   int i = 0;
+
+   if (++(series->skip) < series->stride) {
+      return;
+   }
+   series->skip = 0;
+
+   // full, halve the resolution of everything kept so far
+   if (series->count == CHART_POINTS) {
+      for (i = 0; i < CHART_POINTS / 2; i++) {
+         series->points[i] = series->points[i * 2];
+      }
+      series->count = CHART_POINTS / 2;
+      series->stride *= 2;
+   }
+
+   series->points[series->count].timeUsec = timeUsec;
+   memcpy(series->points[series->count].value, values, sizeof (float) * CHART_MAX_LINES);
+   series->count++;
+
+   return;
+}
+
+/*
+ * Largest-Triangle-Three-Buckets: keeps the first and last points and, from
+ * each of threshold - 2 buckets in between, the point forming the largest
+ * triangle with the previously kept point and the average of the next
+ * bucket.  Peaks survive where plain decimation would drop them.
+ *
+ * Return: the number of indexes written to selected (at most threshold)
+ */
+int chartDownsample(const ChartPoint *points, int count, int line, int threshold, int *selected) {
+   double every = 0.0, area = 0.0, maxArea = 0.0;
+   double avgX = 0.0, avgY = 0.0, prevX = 0.0, prevY = 0.0;
+   int avgStart = 0, avgEnd = 0, rangeStart = 0, rangeEnd = 0;
+   int prev = 0, next = 0, kept = 0, i = 0, j = 0;
+
+   if (threshold >= count || threshold < 3) {
+      for (i = 0; i < count; i++) {
+         selected[i] = i;
+      }
+      return count;
+   }
+
+   every = (double)(count - 2) / (threshold - 2);
+   selected[kept++] = 0;
+
+   for (i = 0; i < threshold - 2; i++) {
+      avgStart = (int)((i + 1) * every) + 1;
+      avgEnd = (int)((i + 2) * every) + 1;
+      if (avgEnd > count) {
+         avgEnd = count;
+      }
+      if (avgStart >= avgEnd) {
+         avgStart = avgEnd - 1;
+      }
+
+      avgX = 0.0;
+      avgY = 0.0;
+      for (j = avgStart; j < avgEnd; j++) {
+         avgX += (double)(points[j].timeUsec - points[0].timeUsec);
+         avgY += points[j].value[line];
+      }
+      avgX /= (avgEnd - avgStart);
+      avgY /= (avgEnd - avgStart);
+
+      rangeStart = (int)(i * every) + 1;
+      rangeEnd = (int)((i + 1) * every) + 1;
+
+      prevX = (double)(points[prev].timeUsec - points[0].timeUsec);
+      prevY = points[prev].value[line];
+      maxArea = -1.0;
+      next = rangeStart;
+
+      for (j = rangeStart; j < rangeEnd; j++) {
+         area = fabs((prevX - avgX) * (points[j].value[line] - prevY) -
+               (prevX - (double)(points[j].timeUsec - points[0].timeUsec)) * (avgY - prevY));
+         if (area > maxArea) {
+            maxArea = area;
+            next = j;
+         }
+      }
+
+      selected[kept++] = next;
+      prev = next;
+   }
+
+   selected[kept++] = count - 1;
+
+   return kept;
+}
+
+/*
+ * Draws the spec's lines of the series as one <svg> element scaled from 0
+ * to the largest value, with at most spec->width points per line.  Lines
+ * the series has no data for are left out, and so is a chart without any.
+ */
+void chartRender(Buffer *out, const ChartSeries *series, const ChartSpec *spec) {
+   int plotW = spec->width - CHART_MARGIN_LEFT - CHART_MARGIN_RIGHT;
+   int plotH = spec->height - CHART_MARGIN_TOP - CHART_MARGIN_BOTTOM;
+   const ChartPoint *points = series->points;
+   double maxValue = 0.0, span = 0.0;
+   int *selected = NULL;
+   SlotValue values[7];
+   int line = 0, kept = 0, i = 0;
+
+   if ((series->lines & (CHART_LINE(spec->firstLine + spec->lines) - CHART_LINE(spec->firstLine))) == 0) {
+      return;
+   }
+
+   values[0].s = spec->width;
+   values[1].s = spec->height;
+   values[2].s = spec->width;
+   values[3].s = spec->height;
+   values[4].str = spec->title;
+   templateRender(out, NULL, chartHeadTemplate, values);
+
+   for (line = 0; line < spec->lines; line++) {
+      if ((series->lines & CHART_LINE(spec->firstLine + line)) == 0) {
+         continue;
+      }
+      values[0].s = CHART_LEGEND_X + line * CHART_LEGEND_STEP;
+      values[1].str = chartColors[line];
+      values[2].str = spec->names[line];
+      templateRender(out, NULL, chartLegendTemplate, values);
+   }
+
+   if (series->count < 2) {
+      values[0].s = CHART_MARGIN_LEFT;
+      values[1].s = CHART_MARGIN_TOP + plotH / 2;
+      templateRender(out, NULL, chartEmptyTemplate, values);
+      bufferAppendStr(out, "      </svg>\n");
+      return;
+   }
+
+   for (i = 0; i < series->count; i++) {
+      for (line = spec->firstLine; line < spec->firstLine + spec->lines; line++) {
+         if ((series->lines & CHART_LINE(line)) != 0 && points[i].value[line] > maxValue) {
+            maxValue = points[i].value[line];
+         }
+      }
+   }
+   if (maxValue <= 0.0) {
+      maxValue = 1.0;
+   }
+
+   values[0].s = CHART_MARGIN_LEFT;
+   values[1].s = CHART_MARGIN_TOP;
+   values[2].s = plotW;
+   values[3].s = plotH;
+   values[4].s = CHART_MARGIN_LEFT - 4;
+   values[5].s = CHART_MARGIN_TOP + 8;
+   templateRender(out, NULL, chartFrameTemplate, values);
+   chartAppendValue(out, maxValue);
+
+   values[0].s = CHART_MARGIN_LEFT - 4;
+   values[1].s = CHART_MARGIN_TOP + plotH;
+   values[2].s = CHART_MARGIN_LEFT;
+   values[3].s = spec->height - 4;
+   templateRender(out, NULL, chartAxisTemplate, values);
+   chartAppendTime(out, points[0].timeUsec);
+
+   values[0].s = spec->width - CHART_MARGIN_RIGHT;
+   values[1].s = spec->height - 4;
+   templateRender(out, NULL, chartEndTimeTemplate, values);
+   chartAppendTime(out, points[series->count - 1].timeUsec);
+   bufferAppendStr(out, "</text>\n");
+
+   if ((selected = (int *)malloc(sizeof (int) * series->count)) == NULL) {
+      perror("malloc failed");
+      exit(-1);
+   }
+
+   span = (double)(points[series->count - 1].timeUsec - points[0].timeUsec);
+   if (span <= 0.0) {
+      span = 1.0;
+   }
+
+   for (line = 0; line < spec->lines; line++) {
+      if ((series->lines & CHART_LINE(spec->firstLine + line)) == 0) {
+         continue;
+      }
+      kept = chartDownsample(points, series->count, spec->firstLine + line, plotW, selected);
+
+      values[0].str = chartColors[line];
+      templateRender(out, NULL, chartLineTemplate, values);
+
+      for (i = 0; i < kept; i++) {
+         const ChartPoint *point = &(points[selected[i]]);
+
+         if (i != 0) {
+            bufferAppend(out, " ", 1);
+         }
+         chartAppendFixed(out, CHART_MARGIN_LEFT + plotW * ((double)(point->timeUsec - points[0].timeUsec) / span));
+         bufferAppend(out, ",", 1);
+         chartAppendFixed(out, CHART_MARGIN_TOP + plotH * (1.0 - point->value[spec->firstLine + line] / maxValue));
+      }
+
+      bufferAppendStr(out, "\"/>\n");
+   }
+
+   free(selected);
+
+   bufferAppendStr(out, "      </svg>\n");
+
+   return;
+}
+
+/*
+ * Appends a non-negative coordinate with one decimal
+ */
+void chartAppendFixed(Buffer *out, double value) {
+   long tenths = lround(value * 10.0);
+   char digit = '0' + (tenths % 10);
+
+   if (tenths < 0) {
+      tenths = 0;
+      digit = '0';
+   }
+
+   bufferAppendUnsigned(out, tenths / 10);
+   bufferAppend(out, ".", 1);
+   bufferAppend(out, &digit, 1);
+
+   return;
+}
+
+void chartAppendValue(Buffer *out, double value) {
+   if (value >= 100.0) {
+      bufferPrintf(out, "%.0f", value);
+   } else {
+      bufferPrintf(out, "%.2f", value);
+   }
+
+   return;
+}
+
+void chartAppendTime(Buffer *out, long long timeUsec) {
+   char timeStr[32] = "";
+   time_t when = (time_t)(timeUsec / 1000000);
+   struct tm tm;
+
+   if (localtime_r(&when, &tm) == NULL) {
+      perror("localtime_r failed");
+      exit(-1);
+   }
+
+   strftime(timeStr, sizeof (timeStr), "%b %d %T", &tm);
+   bufferAppendStr(out, timeStr);
+
+   return;
+}
@@ -0,0 +1,45 @@
+#ifndef __CHART_H_
+#define __CHART_H_
+
+#include "buffer.h"
+
+#define CHART_POINTS 4096
+#define CHART_MAX_LINES 3
+#define CHART_LINE(index) (1u << (index))
+#define CHART_ALL_LINES (CHART_LINE(CHART_MAX_LINES) - 1)
+
+typedef struct {
+   long long timeUsec;
+   float value[CHART_MAX_LINES];
+} ChartPoint;
+
+/*
+ * Whole-lifetime series of one monitor in bounded memory.  When it fills,
+ * every other point is dropped and from then on only every stride-th push
+ * is kept, so it always covers the time since the first push.  Values
+ * whose bit is not in lines were never collected and are not drawn.
+ */
+typedef struct {
+   unsigned int lines;   // CHART_LINE of each value that carries data
+   int count;
+   int stride;
+   int skip;
+   ChartPoint points[CHART_POINTS];
+} ChartSeries;
+
+typedef struct {
+   const char *title;
+   int firstLine;        // index into ChartPoint.value
+   int lines;
+   const char *names[CHART_MAX_LINES];
+   int width;            // pixels, also the number of points drawn
+   int height;
+} ChartSpec;
+
+ChartSeries *chartCreate();
+void chartDestroy(ChartSeries **series);
+void chartPush(ChartSeries *series, long long timeUsec, const float *values);
+int chartDownsample(const ChartPoint *points, int count, int line, int threshold, int *selected);
+void chartRender(Buffer *out, const ChartSeries *series, const ChartSpec *spec);
+
+#endif // __CHART_H_
@@ -13,14 +13,22 @@
 #include "commands.h"
 #include "systemThread.h"
 #include "monitorThread.h"
+#include "cgroupThread.h"
+#include "processProviders.h"
+#include "adaptiveInterval.h"
+#include "governor.h"
 #include "webmon.h"
+#include "eventStream.h"
 #include "singlyLinkedList.h"
 
 #define SLEEP_DELAY_US 10
 #define EXEC_FAIL_STATUS 251   // arbitrary large uncommon number
 
 FileTable *getFileTableEntry(char *file);
+void publishAdded(ThreadTable *line);
 ThreadTable *getThreadTableEntry();
+void printQuantiles(QuantileSet *quantiles, int recent);
+void printLeak(LeakTrend *leak);
 
 extern FileTable fileTable[FILE_TABLE_SIZE];
 extern ThreadTable threadTable[THREAD_TABLE_SIZE];
@@ -28,11 +36,23 @@ extern ThreadTable systemThreadTable;
 extern sem_t availableThreads;
 extern int systemThreadState;
 extern LinkedList *completedList;
+extern FieldPlan fieldPlan;
+extern int useUring;
 extern int webmonActive;
 
-void add(char *type, char *aux, char *interval, char *logFile) {
+void add(char *type, char *aux, char *interval, char *logFile, char *metrics, char *slowInterval, char *adaptive,
+      char *priority, char *detect, char *leak) {
    int pidTemp = -1;
    int intervalTemp = -1;
+   unsigned int providersTemp = 0, slowTemp = 0;
+   long slowIntervalTemp = PROVIDER_SLOW_INTERVAL;
+   unsigned long minIntervalTemp = 0, maxIntervalTemp = 0;
+   PriorityClass priorityTemp = PRIORITY_NORMAL;
+   AlertKind kind = ALERT_PROCESS;
+   int detectMetrics[ANOMALY_MAX_METRICS];
+   int detectCount = 0;
+   int leakMetric = -1;
+   long long leakWindow = 0;
    int isChildFlag = -1;
    int status = -1;
 
@@ -44,14 +64,67 @@ void add(char *type, char *aux, char *interval, char *logFile) {
       return;
    }
 
+   if (priority != NULL && priorityParse(priority, &priorityTemp) == -1) {
+      printf("%s is not a valid priority (critical, normal or bulk)\n", priority);
+      return;
+   }
+
+   if (strncmp(type, "-s", MAX_INPUT_LEN - 1) == 0) {
+      kind = ALERT_SYSTEM;
+   } else if (strncmp(type, "-c", MAX_INPUT_LEN - 1) == 0) {
+      kind = ALERT_CGROUP;
+   }
+
+   if (detect != NULL && (detectCount = anomalyParse(detect, kind, detectMetrics)) == -1) {
+      printf("%s is not a valid metric list for this monitor (see 'alert')\n", detect);
+      return;
+   }
+
+   // extra metrics only exist for processes
+   if (metrics != NULL || slowInterval != NULL || adaptive != NULL || leak != NULL) {
+      if (strncmp(type, "-p", MAX_INPUT_LEN - 1) != 0 && strncmp(type, "-e", MAX_INPUT_LEN - 1) != 0) {
+         printf("-m, -t, -a and -w only apply to process monitors\n");
+         return;
+      }
+      if (metrics != NULL && providersParse(metrics, &providersTemp, &slowTemp) == -1) {
+         printf("%s is not a valid metric list (io,status,sched,smaps,fd or all, :fast or :slow)\n", metrics);
+         return;
+      }
+   }
+
+   if (slowInterval != NULL) {
+      errno = 0;
+      slowIntervalTemp = strtol(slowInterval, NULL, 10);
+      if (errno != 0 || slowIntervalTemp <= 0) {
+         printf("%s is not a valid interval\n", slowInterval);
+         return;
+      }
+   }
+
+   if (adaptive != NULL && adaptiveParse(adaptive, &minIntervalTemp, &maxIntervalTemp) == -1) {
+      printf("%s is not a valid min,max interval\n", adaptive);
+      return;
+   }
+
+   if (leak != NULL && leakParse(leak, &leakMetric, &leakWindow) == -1) {
+      printf("%s is not a valid leak window ([rss:|pss:]<duration>)\n", leak);
+      return;
+   }
+
    if (strncmp(type, "-s", MAX_INPUT_LEN - 1) == 0) {
 
       // setup systemThreadTable
       systemThreadTable.pid = -1;
       systemThreadTable.interval = intervalTemp;
+      systemThreadTable.priority = priorityTemp;
       systemThreadTable.startTime = time(NULL);
       systemThreadTable.fTable = getFileTableEntry(logFile);
       strncpy(systemThreadTable.fileName, logFile, MAX_INPUT_LEN - 1);
+      systemThreadTable.history = historyCreate();
+      systemThreadTable.alerts = alertSetCreate(ALERT_SYSTEM);
+      systemThreadTable.anomalies = anomalySetCreate(detectMetrics, detectCount);
+      quantileInit(&(systemThreadTable.quantiles), kind);
+      summaryInit(&(systemThreadTable.summary), kind);
 
       // create pthread
       if (pthread_create(&systemThreadTable.tid, NULL, systemThread, &systemThreadTable) != 0) {
@@ -60,11 +133,12 @@ void add(char *type, char *aux, char *interval, char *logFile) {
       }
 
       systemThreadState = SYSTEM_THREAD_RUNNING;
+      publishAdded(&systemThreadTable);
 
       return;
    }
 
-   // only -p or -e gets here
+   // only -p, -e or -c gets here
 
    // find free table row
    ThreadTable *newThread = getThreadTableEntry();
@@ -72,6 +146,50 @@ void add(char *type, char *aux, char *interval, char *logFile) {
       return;
    }
 
+   if (strncmp(type, "-c", MAX_INPUT_LEN - 1) == 0) {
+      char dir[MAX_INPUT_LEN] = "";
+      const char *base = NULL;
+
+      // relative paths are under the cgroup2 mount
+      if (snprintf(dir, MAX_INPUT_LEN, (aux[0] == '/') ? "%s" : CGROUP_ROOT "/%s", aux) >= MAX_INPUT_LEN ||
+            isCgroupDir(dir) == 0) {
+         printf("%s is not a cgroup v2 directory\n", aux);
+         return;
+      }
+
+      base = strrchr(dir, '/');
+      base = (base != NULL && base[1] != '\0') ? base + 1 : dir;
+
+      // initialize table row
+      newThread->isChild = 0;
+      newThread->pid = CGROUP_THREAD_ID;
+      newThread->interval = intervalTemp;
+      newThread->priority = priorityTemp;
+      newThread->startTime = time(NULL);
+      newThread->fTable = getFileTableEntry(logFile);
+      strncpy(newThread->fileName, logFile, MAX_INPUT_LEN - 1);
+      snprintf(newThread->cgroup, MAX_INPUT_LEN, "%s", dir);
+      snprintf(newThread->executable, MAX_EXE_LEN, "%s", base);
+      newThread->history = historyCreate();
+      newThread->alerts = alertSetCreate(ALERT_CGROUP);
+      newThread->anomalies = anomalySetCreate(detectMetrics, detectCount);
+      quantileInit(&(newThread->quantiles), kind);
+      summaryInit(&(newThread->summary), kind);
+
+      // create pthread
+      if (pthread_create(&(newThread->tid), NULL, cgroupThread, newThread) != 0) {
+         perror("pthread_create failed");
+         exit(-1);
+      }
+
+      // decrement value of available running threads
+      sem_wait(&availableThreads);
+
+      publishAdded(newThread);
+
+      return;
+   }
+
    if (strncmp(type, "-p", MAX_INPUT_LEN - 1) == 0) {
       errno = 0;
       pidTemp = strtol(aux, NULL, 10);
@@ -114,10 +232,25 @@ void add(char *type, char *aux, char *interval, char *logFile) {
    // initialize table row
    newThread->isChild = isChildFlag;
    newThread->pid = pidTemp;
+   newThread->providers = providersTemp;
+   newThread->slowProviders = slowTemp;
+   newThread->slowInterval = slowIntervalTemp;
+   newThread->fields = fieldPlan;
+   newThread->uring = useUring;
    newThread->interval = intervalTemp;
+   newThread->priority = priorityTemp;
+   newThread->minInterval = minIntervalTemp;
+   newThread->maxInterval = maxIntervalTemp;
+   newThread->effectiveInterval = intervalTemp;
    newThread->startTime = time(NULL);
    newThread->fTable = getFileTableEntry(logFile);
    strncpy(newThread->fileName, logFile, MAX_INPUT_LEN - 1);
+   newThread->history = historyCreate();
+   newThread->alerts = alertSetCreate(ALERT_PROCESS);
+   newThread->anomalies = anomalySetCreate(detectMetrics, detectCount);
+   newThread->leak = leakCreate(leakMetric, leakWindow);
+   quantileInit(&(newThread->quantiles), kind);
+   summaryInit(&(newThread->summary), kind);
 
    // create pthread
    if (pthread_create(&(newThread->tid), NULL, monitorThread, newThread) != 0) {
@@ -128,6 +261,8 @@ void add(char *type, char *aux, char *interval, char *logFile) {
    // decrement value of available running threads
    sem_wait(&availableThreads);
 
+   publishAdded(newThread);
+
    return;
 }
 
@@ -168,12 +303,20 @@ void printRunning(ThreadTable *line) {
          exit(-1);
       }
 
-      printf("|%11lu  |  %10s  |  %10lu  |  %10lu  |  %-1s\n",
+      printf("|%11lu  |  %10s  |  %10lu  |  %10lu  |  %9lu%c  |  %8s  |  %-1s\n",
             (unsigned long)line->tid,
-            (line->pid == -1) ? "system" : pidStr,
+            (line->pid == SYSTEM_THREAD_ID) ? "system" :
+            (line->pid == CGROUP_THREAD_ID) ? "cgroup" : pidStr,
             (unsigned long)line->startTime,
             line->interval,
+            (line->minInterval != 0) ? line->effectiveInterval : line->interval,
+            (line->minInterval != 0) ? '~' : ' ',
+            priorityName(line->priority),
             line->fileName);
+      printQuantiles(&(line->quantiles), 1);
+      if (line->leak != NULL) {
+         printLeak(line->leak);
+      }
    }
 
    // unlock
@@ -185,14 +328,62 @@ void printRunning(ThreadTable *line) {
    return;
 }
 
+/*
+ * Prints the lifetime (and with recent, the last QUANTILE_WINDOW or two)
+ * p50/p95/p99/max of each metric the monitor keeps sketches of
+ */
+void printQuantiles(QuantileSet *quantiles, int recent) {
+   QuantileSummary summary;
+   int i = 0;
+
+   for (i = 0; i < quantiles->count; i++) {
+      quantileLifetime(quantiles, i, &summary);
+      if (summary.count == 0) {
+         continue;
+      }
+
+      printf("|    %-7s p50 %.2f p95 %.2f p99 %.2f max %.2f", quantileName(quantiles, i),
+            summary.p50, summary.p95, summary.p99, summary.max);
+      if (recent != 0) {
+         quantileRecent(quantiles, i, &summary);
+         printf(" (recent p50 %.2f p95 %.2f p99 %.2f max %.2f)", summary.p50, summary.p95, summary.p99,
+               summary.max);
+      }
+      printf("\n");
+   }
+
+   return;
+}
+
+void printLeak(LeakTrend *leak) {
+   printf("|    %-7s ", alertMetricName(leak->metric));
+   if (leak->fitted == 0) {
+      printf("trend after %.0f s\n", leak->windowUsec / 1000000.0);
+      return;
+   }
+
+   printf("trend %.0f bytes/hour (r2 %.2f)", leak->slope, leak->r2);
+   if (leak->leaking != 0) {
+      printf(" leaking");
+      if (leak->oomHours >= 0.0) {
+         printf(", oom in %.1f h", leak->oomHours);
+      }
+   }
+   printf("\n");
+
+   return;
+}
+
 void listActive() {
+   GovernorState governor;
+   PriorityStats stats[PRIORITIES];
    int i = 0;
 
    printf("-------------------------\n");
    printf(" List of Active Monitors \n");
    printf("-------------------------\n");
-   printf("|  Thread Id  |  Process Id  |  Start Time  |   Interval   |  Log File\n");
-   printf("| ----------- | ------------ | ------------ | ------------ | ----------\n");
+   printf("|  Thread Id  |  Process Id  |  Start Time  |   Interval   |  Effective   |  Priority  |  Log File\n");
+   printf("| ----------- | ------------ | ------------ | ------------ | ------------ | ---------- | ----------\n");
 
    if (systemThreadState == SYSTEM_THREAD_RUNNING) {
       printRunning(&systemThreadTable);
@@ -202,6 +393,21 @@ void listActive() {
       printRunning(&(threadTable[i]));
    }
 
+   governorGet(&governor);
+   if (governor.budget > 0.0) {
+      printf("Monitors used %.2f%% of a core (budget %.2f%%), intervals stretched %.2fx\n",
+            governor.usage, governor.budget, governor.stretch);
+   }
+
+   schedulerStats(stats);
+   for (i = 0; i < PRIORITIES; i++) {
+      if (stats[i].ticks != 0) {
+         printf("%-8s ticks %llu late %llu (mean %llu usec, max %lld usec)\n", priorityName(i),
+               stats[i].ticks, stats[i].late, stats[i].latenessUsec / stats[i].ticks,
+               stats[i].maxLatenessUsec);
+      }
+   }
+
    return;
 }
 
@@ -253,11 +459,14 @@ void listCompleted() {
 
       printf("|%11lu  |  %10s  |  %10lu  |  %10lu  |  %10lu  |  %-1s\n",
             (unsigned long)line->tid,
-            (line->pid == -1) ? "system" : pidStr,
+            (line->pid == SYSTEM_THREAD_ID) ? "system" :
+            (line->pid == CGROUP_THREAD_ID) ? "cgroup" : pidStr,
             (unsigned long)line->startTime,
             (unsigned long)line->endTime,
             line->interval,
             line->fileName);
+      printQuantiles(&(line->quantiles), 0);
+      summaryPrint(stdout, &(line->summary));
    }
 
    // unlock
@@ -376,6 +585,22 @@ void removeThread(pthread_t tid) {
 }
 
 void killProcess(pid_t pid) {
+   if (killMonitored(pid) == -1) {
+      printf("Process not found\n");
+   }
+
+   return;
+}
+
+/*
+ * Sends SIGTERM to a monitored process and marks its row killed.  Safe to
+ * call from a monitor thread that released its locks: a process that exits
+ * in the meantime is simply gone.
+ *
+ * Return: 0 if the process was signalled (or may not be), -1 if it is not
+ * monitored or already gone
+ */
+int killMonitored(pid_t pid) {
    int found = 0;
    ThreadTable *line = NULL;
 
@@ -385,7 +610,8 @@ void killProcess(pid_t pid) {
 
       /*
        *  What threads use this critical section:
-       *    Only the command thread uses this critical section.
+       *    The command thread and monitor threads running a kill alert
+       *    (without any lock of their own held) use this critical section.
        *
        *  What shared resources are being protected:
        *    Each line of the threadTable individually is the only resource
@@ -430,19 +656,23 @@ void killProcess(pid_t pid) {
    }
 
    if (found == 0) {
-      printf("Process not found\n");
+      return -1;
    } else {
       if (kill(pid, SIGTERM) == -1) {
+         if (errno == ESRCH) {
+            return -1;
+         }
          perror("kill failed");
          if (errno != EPERM) {
             exit(-1);
          }
-         return;
+         return 0;
       }
 
       /*
        *  What threads use this critical section:
-       *    Only the command thread uses this critical section.
+       *    The command thread and monitor threads running a kill alert use
+       *    this critical section.
        *
        *  What shared resources are being protected:
        *    Each line of the threadTable individually is the only resource
@@ -480,7 +710,7 @@ void killProcess(pid_t pid) {
       }
    }
 
-   return;
+   return 0;
 }
 
 void exitMond() {
@@ -748,7 +978,50 @@ ThreadTable *getThreadTableEntry() {
    return availableThread;
 }
 
-void startWebmon(int intervalSec, int refreshSec, char *file) {
+/*
+ * Tells live webmon pages about a newly started monitor and its log file
+ */
+void publishAdded(ThreadTable *line) {
+
+   /*
+    *  What threads use this critical section:
+    *    The command thread and the monitor thread that was just created.
+    *
+    *  What shared resources are being protected:
+    *    The new table row, the monitor thread may already be sampling it.
+    *
+    *  Line justification and performance concerns:
+    *    Only the row is serialized while locked; the event itself is a copy.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (line->startTime != 0) {
+      eventAdded(line);
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   eventFiles();
+
+   return;
+}
+
+void startWebmon(int intervalSec, int refreshSec, char *file, int port) {
    pthread_t webmonHandle;
    WebmonParams *webmonParams = NULL;
 
@@ -759,7 +1032,27 @@ void startWebmon(int intervalSec, int refreshSec, char *file) {
 
    webmonParams->intervalSec = intervalSec;
    webmonParams->refreshSec = refreshSec;
-   strncpy(webmonParams->file, file, MAX_INPUT_LEN - 1);
+   webmonParams->port = port;
+   if (file != NULL) {
+      strncpy(webmonParams->file, file, MAX_INPUT_LEN - 1);
+   }
+
+   // bind here so a busy port is reported at the prompt
+   if (port != 0) {
+      if ((webmonParams->server = (HttpServer *)calloc(1, sizeof (HttpServer))) == NULL) {
+         perror("calloc failed");
+         exit(-1);
+      }
+
+      if (httpServerInit(webmonParams->server, port, webmonHandleRequest, NULL) == -1) {
+         printf("web monitor could not listen on port %d\n", port);
+         free(webmonParams->server);
+         free(webmonParams);
+         return;
+      }
+
+      httpServerSetWake(webmonParams->server, enableEventLog(), eventStreamPump);
+   }
 
    // create pthread
    if (pthread_create(&webmonHandle, NULL, webmonThread, webmonParams) != 0) {
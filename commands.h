@@ -4,13 +4,15 @@
 
 #include <pthread.h>
 
-void startWebmon(int intervalSec, int refreshSec, char *file);
+void startWebmon(int intervalSec, int refreshSec, char *file, int port);
 
-void add(char *type, char *aux, char *interval, char *logFile);
+void add(char *type, char *aux, char *interval, char *logFile, char *metrics, char *slowInterval, char *adaptive,
+      char *priority, char *detect, char *leak);
 void listActive();
 void listCompleted();
 void removeThread(pthread_t tid);
 void killProcess(pid_t pid);
+int killMonitored(pid_t pid);
 void exitMond();
 
 #endif // __COMMANDS_H_
@@ -0,0 +1,199 @@
+/*
+ * Per cpu utilisation, logging only the cpus whose use moved
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cpuStats.h"
+#include "logLibrary.h"
+
+#define CPU_INITIAL_COUNT 8
+#define CPU_NEVER_LOGGED -1000.0f
+
+void cpuStatsGrow(CpuStats *stats);
+void *cpuArrayGrow(void *array, int cap, size_t size);
+void cpuStatsDeltas(CpuStats *stats);
+void cpuSwap(unsigned long long **a, unsigned long long **b);
+
+
+void cpuStatsInit(CpuStats *stats) {
+   memset(stats, 0, sizeof (CpuStats));
+
+   return;
+}
+
+void cpuStatsDestroy(CpuStats *stats) {
+   free(stats->id);
+   free(stats->user);
+   free(stats->system);
+   free(stats->total);
+   free(stats->idle);
+   free(stats->prevUser);
+   free(stats->prevSystem);
+   free(stats->prevTotal);
+   free(stats->prevIdle);
+   free(stats->busyPct);
+   free(stats->userPct);
+   free(stats->systemPct);
+   free(stats->loggedPct);
+   cpuStatsInit(stats);
+
+   return;
+}
+
+/*
+ * Parses the cpuN rows of a read of /proc/stat and, when the previous read
+ * listed the same cpus, computes the use of each since then
+ */
+void cpuStatsUpdate(CpuStats *stats, const char *buf) {
+   unsigned long long user = 0, nice = 0, system = 0, idle = 0;
+   unsigned long long iowait = 0, irq = 0, softirq = 0, steal = 0;
+   const char *cursor = buf;
+   int count = 0, id = 0, same = 1;
+
+   // the previous counters become the current ones' baseline
+   cpuSwap(&(stats->user), &(stats->prevUser));
+   cpuSwap(&(stats->system), &(stats->prevSystem));
+   cpuSwap(&(stats->total), &(stats->prevTotal));
+   cpuSwap(&(stats->idle), &(stats->prevIdle));
+
+   // the aggregate "cpu " row comes first, then one row per online cpu
+   while ((cursor = findLine(cursor, 1)) != NULL) {
+      if (strncmp(cursor, "cpu", 3) != 0 || cursor[3] < '0' || cursor[3] > '9') {
+         break;
+      }
+
+      cursor += 3;
+      id = (int)parseUnsigned(&cursor);
+      user = parseUnsigned(&cursor);
+      nice = parseUnsigned(&cursor);
+      system = parseUnsigned(&cursor);
+      idle = parseUnsigned(&cursor);
+      iowait = parseUnsigned(&cursor);
+      irq = parseUnsigned(&cursor);
+      softirq = parseUnsigned(&cursor);
+      steal = parseUnsigned(&cursor);
+
+      if (count == stats->cap) {
+         cpuStatsGrow(stats);
+         same = 0;
+      }
+
+      if (count >= stats->count || stats->id[count] != id) {
+         stats->id[count] = id;
+         stats->loggedPct[count] = CPU_NEVER_LOGGED;
+         same = 0;
+      }
+
+      stats->user[count] = user + nice;
+      stats->system[count] = system + irq + softirq;
+      stats->idle[count] = idle + iowait;
+      stats->total[count] = user + nice + system + idle + iowait + irq + softirq + steal;
+      count++;
+   }
+
+   // a cpu went on or off line, start over from this read
+   stats->ready = (same != 0 && count == stats->count && count > 0) ? 1 : 0;
+   stats->count = count;
+
+   if (stats->ready != 0) {
+      cpuStatsDeltas(stats);
+   }
+
+   return;
+}
+
+/*
+ * Note: the per cpu iowait counter can go backwards, so every delta goes
+ * through counterDelta instead of wrapping into a huge percentage
+ */
+void cpuStatsDeltas(CpuStats *stats) {
+   unsigned long long total = 0, idle = 0;
+   float scale = 0.0f;
+   int i = 0;
+
+   for (i = 0; i < stats->count; i++) {
+      total = counterDelta(stats->total[i], stats->prevTotal[i]);
+      idle = counterDelta(stats->idle[i], stats->prevIdle[i]);
+      scale = (total > 0) ? 100.0f / (float)total : 0.0f;
+
+      stats->busyPct[i] = (float)((total > idle) ? total - idle : 0) * scale;
+      stats->userPct[i] = (float)counterDelta(stats->user[i], stats->prevUser[i]) * scale;
+      stats->systemPct[i] = (float)counterDelta(stats->system[i], stats->prevSystem[i]) * scale;
+   }
+
+   return;
+}
+
+/*
+ * Logs "cpuN busy/user/system" for the cpus whose busy percentage moved by
+ * at least threshold since they were last logged
+ */
+void cpuStatsPrint(FILE *fLogFile, CpuStats *stats, float threshold) {
+   int printed = 0;
+   int i = 0;
+
+   if (stats->ready == 0) {
+      return;
+   }
+
+   for (i = 0; i < stats->count; i++) {
+      if (fabsf(stats->busyPct[i] - stats->loggedPct[i]) < threshold) {
+         continue;
+      }
+
+      if (printed == 0) {
+         fprintf(fLogFile, " [CPUS]");
+         printed = 1;
+      }
+
+      fprintf(fLogFile, " cpu%d %.1f/%.1f/%.1f", stats->id[i],
+            stats->busyPct[i], stats->userPct[i], stats->systemPct[i]);
+      stats->loggedPct[i] = stats->busyPct[i];
+   }
+
+   return;
+}
+
+void cpuStatsGrow(CpuStats *stats) {
+   int cap = (stats->cap == 0) ? CPU_INITIAL_COUNT : stats->cap * 2;
+
+   stats->id = cpuArrayGrow(stats->id, cap, sizeof (int));
+   stats->user = cpuArrayGrow(stats->user, cap, sizeof (unsigned long long));
+   stats->system = cpuArrayGrow(stats->system, cap, sizeof (unsigned long long));
+   stats->total = cpuArrayGrow(stats->total, cap, sizeof (unsigned long long));
+   stats->idle = cpuArrayGrow(stats->idle, cap, sizeof (unsigned long long));
+   stats->prevUser = cpuArrayGrow(stats->prevUser, cap, sizeof (unsigned long long));
+   stats->prevSystem = cpuArrayGrow(stats->prevSystem, cap, sizeof (unsigned long long));
+   stats->prevTotal = cpuArrayGrow(stats->prevTotal, cap, sizeof (unsigned long long));
+   stats->prevIdle = cpuArrayGrow(stats->prevIdle, cap, sizeof (unsigned long long));
+   stats->busyPct = cpuArrayGrow(stats->busyPct, cap, sizeof (float));
+   stats->userPct = cpuArrayGrow(stats->userPct, cap, sizeof (float));
+   stats->systemPct = cpuArrayGrow(stats->systemPct, cap, sizeof (float));
+   stats->loggedPct = cpuArrayGrow(stats->loggedPct, cap, sizeof (float));
+   stats->cap = cap;
+
+   return;
+}
+
+void *cpuArrayGrow(void *array, int cap, size_t size) {
+   if ((array = realloc(array, cap * size)) == NULL) {
+      perror("realloc failed");
+      exit(-1);
+   }
+
+   return array;
+}
+
+void cpuSwap(unsigned long long **a, unsigned long long **b) {
+   unsigned long long *swap = *a;
+
+   *a = *b;
+   *b = swap;
+
+   return;
+}
@@ -0,0 +1,35 @@
+#ifndef __CPU_STATS_H_
+#define __CPU_STATS_H_
+
+#include <stdio.h>
+
+/*
+ * Per cpu utilisation from the cpuN rows of /proc/stat.  The counters are
+ * kept as one array per field (not one struct per cpu) so the delta loop
+ * walks contiguous memory.
+ */
+typedef struct {
+   int count;
+   int cap;
+   int ready;                      // previous counters are valid
+   int *id;                        // N of cpuN (offline cpus are not listed)
+   unsigned long long *user;       // user + nice
+   unsigned long long *system;     // system + irq + softirq
+   unsigned long long *total;      // every field but guest time
+   unsigned long long *prevUser;
+   unsigned long long *prevSystem;
+   unsigned long long *prevTotal;
+   unsigned long long *idle;       // idle + iowait
+   unsigned long long *prevIdle;
+   float *busyPct;
+   float *userPct;
+   float *systemPct;
+   float *loggedPct;               // busyPct when the cpu was last logged
+} CpuStats;
+
+void cpuStatsInit(CpuStats *stats);
+void cpuStatsDestroy(CpuStats *stats);
+void cpuStatsUpdate(CpuStats *stats, const char *buf);
+void cpuStatsPrint(FILE *fLogFile, CpuStats *stats, float threshold);
+
+#endif // __CPU_STATS_H_
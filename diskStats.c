@@ -0,0 +1,249 @@
+/*
+ * Per device i/o rates from /proc/diskstats
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "diskStats.h"
+#include "logLibrary.h"
+
+#define DISK_INITIAL_DEVICES 16
+#define DISK_PATH_LEN 128
+
+DiskDevice *diskStatsDevice(DiskStats *stats, const char *name, size_t len);
+int diskIsPartition(const char *name);
+
+
+void diskStatsInit(DiskStats *stats) {
+   memset(stats, 0, sizeof (DiskStats));
+   nameIndexInit(&(stats->index));
+   bufferInit(&(stats->raw));
+
+   return;
+}
+
+void diskStatsDestroy(DiskStats *stats) {
+   nameIndexDestroy(&(stats->index));
+   bufferFree(&(stats->raw));
+   free(stats->devices);
+   stats->devices = NULL;
+   stats->count = 0;
+   stats->cap = 0;
+
+   return;
+}
+
+/*
+ * Reads every line of diskstats and updates the counters and the rates
+ * since the previous update of each device
+ *
+ * Return: 0 on success, -1 if the file could not be read
+ */
+int diskStatsUpdate(DiskStats *stats, int fd, long long timeUsec) {
+   double elapsed = (stats->lastUsec != 0) ? (timeUsec - stats->lastUsec) / 1000000.0 : 0.0;
+   const char *cursor = NULL, *name = NULL;
+   DiskDevice *device = NULL;
+   unsigned long long reads = 0, writes = 0;
+   size_t nameLen = 0;
+
+   if (readProcBuffer(fd, &(stats->raw)) <= 0) {
+      return -1;
+   }
+
+   stats->tick++;
+   cursor = stats->raw.data;
+
+   // major minor name reads merged sectors ms writes merged sectors ms in-flight busy-ms ...
+   while (*cursor != '\0') {
+      cursor = skipFields(cursor, 2);
+      while (*cursor == ' ' || *cursor == '\t') {
+         cursor++;
+      }
+      name = cursor;
+      while (*cursor != ' ' && *cursor != '\t' && *cursor != '\n' && *cursor != '\0') {
+         cursor++;
+      }
+      nameLen = cursor - name;
+
+      if (nameLen > 0) {
+         device = diskStatsDevice(stats, name, nameLen);
+
+         device->prev = device->now;
+         device->now.reads = parseUnsigned(&cursor);
+         cursor = skipFields(cursor, 1);
+         device->now.sectorsRead = parseUnsigned(&cursor);
+         device->now.msRead = parseUnsigned(&cursor);
+         device->now.writes = parseUnsigned(&cursor);
+         cursor = skipFields(cursor, 1);
+         device->now.sectorsWritten = parseUnsigned(&cursor);
+         device->now.msWritten = parseUnsigned(&cursor);
+         cursor = skipFields(cursor, 1);
+         device->now.msBusy = parseUnsigned(&cursor);
+
+         // rates only when the device was also there on the previous tick
+         if (device->tick == stats->tick - 1 && elapsed > 0.0) {
+            reads = counterDelta(device->now.reads, device->prev.reads);
+            writes = counterDelta(device->now.writes, device->prev.writes);
+            device->readIops = reads / elapsed;
+            device->writeIops = writes / elapsed;
+            device->readKBps = counterDelta(device->now.sectorsRead, device->prev.sectorsRead) *
+               (DISK_SECTOR_SIZE / 1024.0) / elapsed;
+            device->writeKBps = counterDelta(device->now.sectorsWritten, device->prev.sectorsWritten) *
+               (DISK_SECTOR_SIZE / 1024.0) / elapsed;
+            device->readAwaitMs = (reads != 0) ?
+               (double)counterDelta(device->now.msRead, device->prev.msRead) / reads : 0.0;
+            device->writeAwaitMs = (writes != 0) ?
+               (double)counterDelta(device->now.msWritten, device->prev.msWritten) / writes : 0.0;
+            device->busyPercent = counterDelta(device->now.msBusy, device->prev.msBusy) / (elapsed * 10.0);
+         } else {
+            device->readIops = device->writeIops = 0.0;
+            device->readKBps = device->writeKBps = 0.0;
+            device->readAwaitMs = device->writeAwaitMs = 0.0;
+            device->busyPercent = 0.0;
+         }
+
+         device->tick = stats->tick;
+      }
+
+      if ((cursor = strchr(cursor, '\n')) == NULL) {
+         break;
+      }
+      cursor++;
+   }
+
+   stats->lastUsec = timeUsec;
+
+   return 0;
+}
+
+/*
+ * Sums the counters of the whole devices currently listed (partitions
+ * would count the same i/o twice)
+ */
+void diskStatsTotals(DiskStats *stats, DiskCounters *totals) {
+   DiskDevice *device = NULL;
+   int i = 0;
+
+   memset(totals, 0, sizeof (DiskCounters));
+
+   for (i = 0; i < stats->count; i++) {
+      device = &(stats->devices[i]);
+      if (device->tick != stats->tick || device->partition != 0) {
+         continue;
+      }
+
+      totals->reads += device->now.reads;
+      totals->sectorsRead += device->now.sectorsRead;
+      totals->msRead += device->now.msRead;
+      totals->writes += device->now.writes;
+      totals->sectorsWritten += device->now.sectorsWritten;
+      totals->msWritten += device->now.msWritten;
+   }
+
+   return;
+}
+
+/*
+ * Return: the busy percent of the busiest whole device currently listed
+ */
+double diskStatsBusiest(DiskStats *stats) {
+   DiskDevice *device = NULL;
+   double busiest = 0.0;
+   int i = 0;
+
+   for (i = 0; i < stats->count; i++) {
+      device = &(stats->devices[i]);
+      if (device->tick == stats->tick && device->partition == 0 && device->busyPercent > busiest) {
+         busiest = device->busyPercent;
+      }
+   }
+
+   return busiest;
+}
+
+void diskStatsPrint(FILE *fLogFile, DiskStats *stats, DiskFilter filter) {
+   DiskDevice *device = NULL;
+   int i = 0;
+
+   for (i = 0; i < stats->count; i++) {
+      device = &(stats->devices[i]);
+
+      if (device->tick != stats->tick) {
+         continue;
+      }
+      if (filter != DISK_FILTER_ALL && device->partition != 0) {
+         continue;
+      }
+      if (filter == DISK_FILTER_ACTIVE && device->readIops == 0.0 && device->writeIops == 0.0) {
+         continue;
+      }
+
+      fprintf(fLogFile, " [DISKSTATS(%s)] totalnoreads %llu totalsectorsread %llu nomsread %llu"
+            " totalnowrites %llu nosectorswritten %llu nomswritten %llu"
+            " riops %.1f wiops %.1f rkbs %.1f wkbs %.1f rawait %.2f wawait %.2f",
+            device->name, device->now.reads, device->now.sectorsRead, device->now.msRead,
+            device->now.writes, device->now.sectorsWritten, device->now.msWritten,
+            device->readIops, device->writeIops, device->readKBps, device->writeKBps,
+            device->readAwaitMs, device->writeAwaitMs);
+   }
+
+   return;
+}
+
+/*
+ * Return: the row of the named device, added on first sight
+ */
+DiskDevice *diskStatsDevice(DiskStats *stats, const char *name, size_t len) {
+   DiskDevice *device = NULL;
+   int idx = nameIndexGet(&(stats->index), name, len);
+
+   if (idx != -1) {
+      return &(stats->devices[idx]);
+   }
+
+   if (stats->count == stats->cap) {
+      stats->cap = (stats->cap == 0) ? DISK_INITIAL_DEVICES : stats->cap * 2;
+      if ((stats->devices = (DiskDevice *)realloc(stats->devices, sizeof (DiskDevice) * stats->cap)) == NULL) {
+         perror("realloc failed");
+         exit(-1);
+      }
+   }
+
+   if (len >= DISK_NAME_LEN) {
+      len = DISK_NAME_LEN - 1;
+   }
+
+   idx = stats->count++;
+   device = &(stats->devices[idx]);
+   memset(device, 0, sizeof (DiskDevice));
+   memcpy(device->name, name, len);
+   device->name[len] = '\0';
+   device->partition = diskIsPartition(device->name);
+
+   nameIndexPut(&(stats->index), name, len, idx);
+
+   return device;
+}
+
+/*
+ * Partitions have a "partition" attribute in sysfs, checked once per device
+ */
+int diskIsPartition(const char *name) {
+   char path[DISK_PATH_LEN] = "";
+   char *c = NULL;
+
+   snprintf(path, sizeof (path), "/sys/class/block/%s/partition", name);
+
+   // sysfs spells a '/' in the device name as '!' (eg. cciss/c0d0)
+   for (c = path + strlen("/sys/class/block/"); c < path + strlen(path) - strlen("/partition"); c++) {
+      if (*c == '/') {
+         *c = '!';
+      }
+   }
+
+   return (access(path, F_OK) == 0) ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+#ifndef __DISK_STATS_H_
+#define __DISK_STATS_H_
+
+#include <stdio.h>
+
+#include "buffer.h"
+#include "nameIndex.h"
+
+#define DISK_NAME_LEN 32
+#define DISK_SECTOR_SIZE 512
+
+typedef enum {
+   DISK_FILTER_ALL = 0,      // every line, partitions included
+   DISK_FILTER_WHOLE = 1,    // whole devices only
+   DISK_FILTER_ACTIVE = 2    // whole devices with i/o since the last tick
+} DiskFilter;
+
+typedef struct {
+   unsigned long long reads;
+   unsigned long long sectorsRead;
+   unsigned long long msRead;
+   unsigned long long writes;
+   unsigned long long sectorsWritten;
+   unsigned long long msWritten;
+   unsigned long long msBusy;     // time with i/o in flight
+} DiskCounters;
+
+typedef struct {
+   char name[DISK_NAME_LEN];
+   int partition;
+   unsigned long tick;       // last update that listed the device
+   DiskCounters now;
+   DiskCounters prev;
+   double readIops;
+   double writeIops;
+   double readKBps;
+   double writeKBps;
+   double readAwaitMs;       // average time per completed read
+   double writeAwaitMs;
+   double busyPercent;       // of the time since the last tick
+} DiskDevice;
+
+/*
+ * Every block device of /proc/diskstats, found by name through a hash so a
+ * tick is one pass over the file however many devices there are.  Devices
+ * that disappear keep their row (tick tells whether they are current).
+ */
+typedef struct {
+   NameIndex index;
+   DiskDevice *devices;
+   int count;
+   int cap;
+   unsigned long tick;
+   long long lastUsec;
+   Buffer raw;
+} DiskStats;
+
+void diskStatsInit(DiskStats *stats);
+void diskStatsDestroy(DiskStats *stats);
+int diskStatsUpdate(DiskStats *stats, int fd, long long timeUsec);
+void diskStatsTotals(DiskStats *stats, DiskCounters *totals);
+double diskStatsBusiest(DiskStats *stats);
+void diskStatsPrint(FILE *fLogFile, DiskStats *stats, DiskFilter filter);
+
+#endif // __DISK_STATS_H_
@@ -0,0 +1,458 @@
+/*
+ * Server-sent events: live deltas for the webmon page
+ *
+ * Monitor, system and command threads publish events (new sample, monitor
+ * added, monitor completed, file table changed) into a ring with increasing
+ * sequence numbers.  The webmon thread is woken through an eventfd and
+ * forwards every event a stream has not seen yet.  A client that reconnects
+ * with Last-Event-ID (or ?since=) resumes where it left off; if the ring has
+ * already overwritten those events it is told to reload instead.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "mond.h"
+#include "eventStream.h"
+#include "webApi.h"
+#include "jsonWriter.h"
+#include "logLibrary.h"
+
+#define EVENT_DATA_LEN (EVENT_FRAME_LEN - 64)
+
+typedef struct {
+   char buf[EVENT_DATA_LEN];
+   size_t len;
+} EventData;
+
+void eventDataSink(void *ctx, const char *data, size_t len);
+void eventPush(const char *type, EventData *data);
+void eventWriteRow(JsonWriter *w, ThreadTable *line, int completed);
+void eventStreamSend(HttpConn *conn);
+
+extern FileTable fileTable[FILE_TABLE_SIZE];
+
+pthread_mutex_t eventMutex;
+Event *eventLog = NULL;
+unsigned long eventSeq = 0;
+int eventFd = -1;
+int eventWakePending = 0;
+int eventsEnabled = 0;
+
+
+void initEventLog() {
+   if (pthread_mutex_init(&eventMutex, NULL) != 0) {
+      perror("pthread_mutex_init failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+void destroyEventLog() {
+   if (pthread_mutex_destroy(&eventMutex) != 0) {
+      perror("pthread_mutex_destroy failed");
+      exit(-1);
+   }
+
+   free(eventLog);
+   eventLog = NULL;
+   if (eventFd != -1) {
+      close(eventFd);
+      eventFd = -1;
+   }
+
+   return;
+}
+
+/*
+ * Starts recording events (nothing is recorded until a webmon server runs)
+ *
+ * Return: the eventfd that is signalled when new events arrive
+ */
+int enableEventLog() {
+   if (eventsEnabled != 0) {
+      return eventFd;
+   }
+
+   if ((eventLog = (Event *)calloc(EVENT_LOG_LEN, sizeof (Event))) == NULL) {
+      perror("calloc failed");
+      exit(-1);
+   }
+
+   if ((eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+      perror("eventfd failed");
+      exit(-1);
+   }
+
+   eventsEnabled = 1;
+
+   return eventFd;
+}
+
+unsigned long eventLogSeq() {
+   unsigned long seq = 0;
+
+   // lock
+   if (pthread_mutex_lock(&eventMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   seq = eventSeq;
+
+   // unlock
+   if (pthread_mutex_unlock(&eventMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return seq;
+}
+
+void eventDataSink(void *ctx, const char *data, size_t len) {
+   EventData *eventData = (EventData *)ctx;
+
+   // a single event never comes close, truncate rather than overflow
+   if (eventData->len + len > EVENT_DATA_LEN) {
+      len = EVENT_DATA_LEN - eventData->len;
+   }
+
+   memcpy(eventData->buf + eventData->len, data, len);
+   eventData->len += len;
+
+   return;
+}
+
+void eventPush(const char *type, EventData *data) {
+   uint64_t one = 1;
+   Event *event = NULL;
+   int len = 0;
+
+   /*
+    *  What threads use this critical section:
+    *    Every monitor thread, the system thread and the command thread
+    *    publish here; the webmon thread reads the ring in eventStreamSend.
+    *
+    *  What shared resources are being protected:
+    *    The event ring and its sequence counter.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling) must use
+    *    the shared resources and therefore, must be locked.  The frame is
+    *    serialized before locking so only a copy is done while held, and
+    *    the eventfd is only written when the reader has not been woken yet.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&eventMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   eventSeq++;
+   event = &(eventLog[eventSeq % EVENT_LOG_LEN]);
+   event->seq = eventSeq;
+   len = snprintf(event->frame, EVENT_FRAME_LEN, "id: %lu\nevent: %s\ndata: %.*s\n\n",
+         eventSeq, type, (int)data->len, data->buf);
+   event->len = (len < EVENT_FRAME_LEN) ? len : EVENT_FRAME_LEN - 1;
+
+   if (eventWakePending == 0) {
+      eventWakePending = 1;
+      if (write(eventFd, &one, sizeof (one)) == -1 && errno != EAGAIN) {
+         perror("write failed");
+         exit(-1);
+      }
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&eventMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * Note: called with the row lock held by the sampling thread
+ */
+void eventSample(ThreadTable *line, Sample *sample) {
+   EventData data;
+   JsonWriter w;
+
+   if (eventsEnabled == 0) {
+      return;
+   }
+
+   data.len = 0;
+   jsonInit(&w, eventDataSink, &data);
+
+   jsonBeginObject(&w);
+   jsonFieldUnsigned(&w, "tid", (unsigned long)line->tid);
+   jsonFieldSigned(&w, "pid", line->pid);
+   jsonFieldUnsigned(&w, "seq", (line->history != NULL) ? line->history->total : 0);
+   jsonKey(&w, "sample");
+   apiWriteSample(&w, line->pid, sample);
+   jsonEndObject(&w);
+   jsonFlush(&w);
+
+   eventPush("sample", &data);
+
+   return;
+}
+
+void eventWriteRow(JsonWriter *w, ThreadTable *line, int completed) {
+   SummaryText text;
+
+   jsonBeginObject(w);
+   jsonFieldUnsigned(w, "tid", (unsigned long)line->tid);
+   jsonFieldSigned(w, "pid", line->pid);
+   jsonFieldSigned(w, "startTime", line->startTime);
+   if (completed != 0) {
+      jsonFieldSigned(w, "endTime", line->endTime);
+      jsonFieldString(w, "endStatus", (line->endStatus == KILLED) ? "killed" :
+            (line->endStatus == STOPPED) ? "stopped" : "exited");
+   }
+   jsonFieldUnsigned(w, "interval", line->interval);
+   jsonFieldString(w, "logFile", line->fileName);
+   if (completed != 0) {
+      // the cells of the completed row, as the page renders them
+      summaryFormat(&(line->summary), &text);
+      jsonFieldUnsigned(w, "samples", line->summary.samples);
+      jsonFieldUnsigned(w, "missedTicks", line->summary.missedTicks);
+      jsonFieldString(w, "peakMemory", text.peakMemory);
+      jsonFieldString(w, "cpu", text.cpu);
+      jsonFieldString(w, "faults", text.faults);
+      jsonFieldString(w, "exit", text.exit);
+   }
+   jsonEndObject(w);
+
+   return;
+}
+
+void eventAdded(ThreadTable *line) {
+   EventData data;
+   JsonWriter w;
+
+   if (eventsEnabled == 0) {
+      return;
+   }
+
+   data.len = 0;
+   jsonInit(&w, eventDataSink, &data);
+   eventWriteRow(&w, line, 0);
+   jsonFlush(&w);
+
+   eventPush("added", &data);
+
+   return;
+}
+
+void eventCompleted(ThreadTable *line) {
+   EventData data;
+   JsonWriter w;
+
+   if (eventsEnabled == 0) {
+      return;
+   }
+
+   data.len = 0;
+   jsonInit(&w, eventDataSink, &data);
+   eventWriteRow(&w, line, 1);
+   jsonFlush(&w);
+
+   eventPush("completed", &data);
+
+   return;
+}
+
+/*
+ * Publishes the whole file table (it has at most FILE_TABLE_SIZE rows).
+ *
+ * Note: must not be called with a fileTable row locked
+ */
+void eventFiles() {
+   EventData data;
+   JsonWriter w;
+   int value = 0;
+   int i = 0;
+
+   if (eventsEnabled == 0) {
+      return;
+   }
+
+   data.len = 0;
+   jsonInit(&w, eventDataSink, &data);
+   jsonBeginArray(&w);
+
+   for (i = 0; i < FILE_TABLE_SIZE; i++) {
+      // lock
+      if (pthread_mutex_lock(&(fileTable[i].mutex)) != 0) {
+         perror("pthread_mutex_lock failed");
+         exit(-1);
+      }
+
+      // critical section
+      if (fileTable[i].dev != 0 && fileTable[i].inode != 0) {
+         if (sem_getvalue(&(fileTable[i].count), &value) == -1) {
+            perror("sem_getvalue failed");
+            exit(-1);
+         }
+
+         jsonBeginObject(&w);
+         jsonFieldUnsigned(&w, "dev", (unsigned long)fileTable[i].dev);
+         jsonFieldUnsigned(&w, "inode", (unsigned long)fileTable[i].inode);
+         jsonFieldSigned(&w, "count", value);
+         jsonEndObject(&w);
+      }
+
+      // unlock
+      if (pthread_mutex_unlock(&(fileTable[i].mutex)) != 0) {
+         perror("pthread_mutex_unlock failed");
+         exit(-1);
+      }
+   }
+
+   jsonEndArray(&w);
+   jsonFlush(&w);
+
+   eventPush("files", &data);
+
+   return;
+}
+
+/*
+ * GET /events[?since=<seq>]
+ *
+ * Turns the connection into an event stream.  Events after the
+ * Last-Event-ID header (or since) are replayed first.
+ */
+void eventStreamOpen(HttpConn *conn, HttpRequest *req) {
+   char param[32] = "";
+
+   conn->lastSeq = eventLogSeq();
+
+   if (req->lastEventId != NULL) {
+      conn->lastSeq = strtoul(req->lastEventId, NULL, 10);
+   } else if (httpQueryParam(req->query, "since", param, sizeof (param)) == 0) {
+      conn->lastSeq = strtoul(param, NULL, 10);
+   }
+
+   httpBeginStream(conn, req, 200, "text/event-stream");
+   if (req->isHead != 0) {
+      httpEndStream(conn);
+      return;
+   }
+
+   conn->streaming = 1;
+   httpSendChunk(conn, "retry: 2000\n\n", 13);
+   eventStreamSend(conn);
+
+   return;
+}
+
+/*
+ * Forwards the events conn has not seen yet
+ */
+void eventStreamSend(HttpConn *conn) {
+   Event *event = NULL;
+   unsigned long seq = 0;
+
+   if (conn->out.len > EVENT_MAX_BACKLOG) {
+      // the client is not reading, it resumes with Last-Event-ID
+      conn->dead = 1;
+      return;
+   }
+
+   // lock
+   if (pthread_mutex_lock(&eventMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (conn->lastSeq > eventSeq || eventSeq - conn->lastSeq >= EVENT_LOG_LEN) {
+      // what it missed is gone, have it start over
+      httpSendChunk(conn, "event: reset\ndata: {}\n\n", 23);
+      conn->lastSeq = eventSeq;
+   }
+
+   for (seq = conn->lastSeq + 1; seq <= eventSeq; seq++) {
+      event = &(eventLog[seq % EVENT_LOG_LEN]);
+      httpSendChunk(conn, event->frame, event->len);
+   }
+   conn->lastSeq = eventSeq;
+
+   // unlock
+   if (pthread_mutex_unlock(&eventMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * Called by the webmon thread when the eventfd fires
+ */
+void eventStreamPump(HttpServer *server, void *ctx) {
+   uint64_t count = 0;
+   HttpConn *conn = NULL;
+
+   if (read(eventFd, &count, sizeof (count)) == -1 && errno != EAGAIN) {
+      perror("read failed");
+      exit(-1);
+   }
+
+   // lock
+   if (pthread_mutex_lock(&eventMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   eventWakePending = 0;
+
+   // unlock
+   if (pthread_mutex_unlock(&eventMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   for (conn = server->conns; conn != NULL; conn = conn->next) {
+      if (conn->streaming != 0 && conn->dead == 0) {
+         eventStreamSend(conn);
+      }
+   }
+
+   return;
+}
+
+/*
+ * Keeps idle streams (and the proxies in front of them) from timing out
+ */
+void eventStreamPing(HttpServer *server) {
+   HttpConn *conn = NULL;
+
+   for (conn = server->conns; conn != NULL; conn = conn->next) {
+      if (conn->streaming != 0 && conn->dead == 0) {
+         httpSendChunk(conn, ": ping\n\n", 8);
+      }
+   }
+
+   return;
+}
@@ -0,0 +1,38 @@
+
+#ifndef __EVENT_STREAM_H_
+#define __EVENT_STREAM_H_
+
+#include "mond.h"
+#include "httpServer.h"
+
+#define EVENTS_PATH "/events"
+#define EVENT_LOG_LEN 1024
+#define EVENT_FRAME_LEN 1536
+#define EVENT_MAX_BACKLOG (1 << 20)
+#define EVENT_PING_SEC 15
+
+/*
+ * One server-sent event, stored as the complete frame
+ * ("id: ...\nevent: ...\ndata: ...\n\n") so every client gets the same bytes
+ */
+typedef struct {
+   unsigned long seq;
+   int len;
+   char frame[EVENT_FRAME_LEN];
+} Event;
+
+void initEventLog();
+void destroyEventLog();
+int enableEventLog();
+unsigned long eventLogSeq();
+
+void eventSample(ThreadTable *line, Sample *sample);
+void eventAdded(ThreadTable *line);
+void eventCompleted(ThreadTable *line);
+void eventFiles();
+
+void eventStreamOpen(HttpConn *conn, HttpRequest *req);
+void eventStreamPump(HttpServer *server, void *ctx);
+void eventStreamPing(HttpServer *server);
+
+#endif // __EVENT_STREAM_H_
@@ -0,0 +1,198 @@
+/*
+ * Process fields chosen with 'set fields', compiled into a per file plan
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "fieldPlan.h"
+#include "logLibrary.h"
+
+#define FIELD_STAT_FIRST 3      // the column after "pid (comm)"
+
+typedef enum {
+   FIELD_CHAR = 0,
+   FIELD_UNSIGNED = 1,
+   FIELD_SIGNED = 2
+} FieldType;
+
+typedef struct {
+   const char *name;          // in the spec, as proc(5) names the column
+   const char *logName;
+   FieldSource source;
+   int column;                // 1 based
+   FieldType type;
+   size_t offset;             // into ProcessSample
+} FieldInfo;
+
+int fieldLookup(const char *name, size_t len, unsigned int *mask);
+const char *fieldTake(const FieldInfo *info, const char *cursor, ProcessSample *sample);
+
+#define INFO(name, logName, source, column, type, field) \
+   { name, logName, source, column, type, offsetof(ProcessSample, field) }
+
+/*
+ * In column order within each file, the plan relies on it
+ */
+static const FieldInfo fieldInfo[FIELDS] = {
+   INFO("stat.state", "stat", SOURCE_STAT, 3, FIELD_CHAR, state),
+   INFO("stat.minflt", "minorfaults", SOURCE_STAT, 10, FIELD_UNSIGNED, minorFaults),
+   INFO("stat.majflt", "majorfaults", SOURCE_STAT, 12, FIELD_UNSIGNED, majorFaults),
+   INFO("stat.utime", "usermodetime", SOURCE_STAT, 14, FIELD_UNSIGNED, userTime),
+   INFO("stat.stime", "kernelmodetime", SOURCE_STAT, 15, FIELD_UNSIGNED, kernelTime),
+   INFO("stat.priority", "priority", SOURCE_STAT, 18, FIELD_SIGNED, priority),
+   INFO("stat.nice", "nice", SOURCE_STAT, 19, FIELD_SIGNED, nice),
+   INFO("stat.num_threads", "nothreads", SOURCE_STAT, 20, FIELD_SIGNED, numThreads),
+   INFO("stat.vsize", "vsize", SOURCE_STAT, 23, FIELD_UNSIGNED, vsize),
+   INFO("stat.rss", "rss", SOURCE_STAT, 24, FIELD_SIGNED, rss),
+   INFO("statm.size", "program", SOURCE_STATM, 1, FIELD_UNSIGNED, program),
+   INFO("statm.resident", "residentset", SOURCE_STATM, 2, FIELD_UNSIGNED, residentSet),
+   INFO("statm.shared", "share", SOURCE_STATM, 3, FIELD_UNSIGNED, share),
+   INFO("statm.text", "text", SOURCE_STATM, 4, FIELD_UNSIGNED, text),
+   INFO("statm.data", "data", SOURCE_STATM, 6, FIELD_UNSIGNED, data),
+};
+
+static const char *sourceNames[SOURCES] = { "stat", "statm" };
+
+
+/*
+ * Compiles "stat.minflt,statm.resident,..." into a plan.  A bare file name
+ * ("statm") takes every field of that file and "all" every field.
+ *
+ * Return: 0 on success, -1 if a name is unknown or nothing was chosen
+ */
+int fieldPlanCompile(FieldPlan *plan, const char *spec) {
+   const char *start = spec, *end = NULL;
+   unsigned int mask = 0;
+   FieldSource source;
+   int i = 0;
+
+   if (strcmp(spec, "all") == 0) {
+      mask = FIELD_ALL;
+   } else {
+      while (*start != '\0') {
+         if ((end = strchr(start, ',')) == NULL) {
+            end = start + strlen(start);
+         }
+         if (end > start && fieldLookup(start, end - start, &mask) == -1) {
+            return -1;
+         }
+         start = (*end == ',') ? end + 1 : end;
+      }
+   }
+
+   if (mask == 0) {
+      return -1;
+   }
+
+   memset(plan, 0, sizeof (FieldPlan));
+   plan->mask = mask;
+
+   // the table is in column order, so this leaves each file sorted
+   for (i = 0; i < FIELDS; i++) {
+      if ((mask & FIELD_BIT(i)) != 0) {
+         source = fieldInfo[i].source;
+         plan->fields[source][plan->count[source]++] = (unsigned char)i;
+      }
+   }
+
+   return 0;
+}
+
+/*
+ * Return: 1 if the plan needs the file, 0 otherwise
+ */
+int fieldPlanUses(const FieldPlan *plan, FieldSource source) {
+   return (plan->count[source] > 0) ? 1 : 0;
+}
+
+/*
+ * Parses the planned fields of one file.  cursor is the start of statm or,
+ * for stat, just past the ')' closing the executable name.
+ */
+void fieldPlanExtract(const FieldPlan *plan, FieldSource source, const char *cursor, ProcessSample *sample) {
+   const FieldInfo *info = NULL;
+   int column = (source == SOURCE_STAT) ? FIELD_STAT_FIRST : 1;
+   int i = 0;
+
+   for (i = 0; i < plan->count[source]; i++) {
+      info = &(fieldInfo[plan->fields[source][i]]);
+      cursor = skipFields(cursor, info->column - column);
+      cursor = fieldTake(info, cursor, sample);
+      column = info->column + 1;
+   }
+
+   return;
+}
+
+/*
+ * Logs " name value" for each planned field of one file
+ */
+void fieldPlanPrint(FILE *fLogFile, const FieldPlan *plan, FieldSource source, const ProcessSample *sample) {
+   const FieldInfo *info = NULL;
+   const char *field = NULL;
+   int i = 0;
+
+   for (i = 0; i < plan->count[source]; i++) {
+      info = &(fieldInfo[plan->fields[source][i]]);
+      field = (const char *)sample + info->offset;
+
+      switch (info->type) {
+         case FIELD_CHAR: fprintf(fLogFile, " %s %c", info->logName, *field); break;
+         case FIELD_UNSIGNED: fprintf(fLogFile, " %s %llu", info->logName, *(const unsigned long long *)field); break;
+         case FIELD_SIGNED: fprintf(fLogFile, " %s %lld", info->logName, *(const long long *)field); break;
+      }
+   }
+
+   return;
+}
+
+/*
+ * Adds the field (or, for a bare file name, the fields) called name to mask
+ *
+ * Return: 0 on success, -1 if the name is unknown
+ */
+int fieldLookup(const char *name, size_t len, unsigned int *mask) {
+   int i = 0, found = 0;
+
+   for (i = 0; i < FIELDS; i++) {
+      if ((strlen(fieldInfo[i].name) == len && strncmp(fieldInfo[i].name, name, len) == 0) ||
+            (strlen(sourceNames[fieldInfo[i].source]) == len &&
+             strncmp(sourceNames[fieldInfo[i].source], name, len) == 0)) {
+         *mask |= FIELD_BIT(i);
+         found = 1;
+      }
+   }
+
+   return (found != 0) ? 0 : -1;
+}
+
+/*
+ * Return: the cursor just past the field
+ */
+const char *fieldTake(const FieldInfo *info, const char *cursor, ProcessSample *sample) {
+   char *field = (char *)sample + info->offset;
+
+   switch (info->type) {
+      case FIELD_CHAR:
+         while (*cursor == ' ') {
+            cursor++;
+         }
+         *field = *cursor;
+         while (*cursor != ' ' && *cursor != '\n' && *cursor != '\0') {
+            cursor++;
+         }
+         break;
+      case FIELD_UNSIGNED:
+         *(unsigned long long *)field = parseUnsigned(&cursor);
+         break;
+      case FIELD_SIGNED:
+         *(long long *)field = parseSigned(&cursor);
+         break;
+   }
+
+   return cursor;
+}
@@ -0,0 +1,54 @@
+#ifndef __FIELD_PLAN_H_
+#define __FIELD_PLAN_H_
+
+#include <stdio.h>
+
+#include "samples.h"
+
+typedef enum {
+   FIELD_STATE = 0,
+   FIELD_MINFLT = 1,
+   FIELD_MAJFLT = 2,
+   FIELD_UTIME = 3,
+   FIELD_STIME = 4,
+   FIELD_PRIORITY = 5,
+   FIELD_NICE = 6,
+   FIELD_THREADS = 7,
+   FIELD_VSIZE = 8,
+   FIELD_RSS = 9,
+   FIELD_SIZE = 10,
+   FIELD_RESIDENT = 11,
+   FIELD_SHARED = 12,
+   FIELD_TEXT = 13,
+   FIELD_DATA = 14,
+   FIELDS = 15
+} FieldId;
+
+typedef enum {
+   SOURCE_STAT = 0,
+   SOURCE_STATM = 1,
+   SOURCES = 2
+} FieldSource;
+
+#define FIELD_BIT(id) (1u << (id))
+#define FIELD_ALL (FIELD_BIT(FIELDS) - 1)
+
+/*
+ * The stat and statm columns a process monitor collects, compiled once
+ * from a "stat.minflt,statm.resident,..." spec.  The fields of each file
+ * are kept sorted by column so a tick scans every file once, front to
+ * back, and stops after its last wanted column; a file without wanted
+ * columns is not read at all.
+ */
+typedef struct {
+   unsigned int mask;
+   int count[SOURCES];
+   unsigned char fields[SOURCES][FIELDS];  // FieldId, by column
+} FieldPlan;
+
+int fieldPlanCompile(FieldPlan *plan, const char *spec);
+int fieldPlanUses(const FieldPlan *plan, FieldSource source);
+void fieldPlanExtract(const FieldPlan *plan, FieldSource source, const char *cursor, ProcessSample *sample);
+void fieldPlanPrint(FILE *fLogFile, const FieldPlan *plan, FieldSource source, const ProcessSample *sample);
+
+#endif // __FIELD_PLAN_H_
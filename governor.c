@@ -0,0 +1,240 @@
+/*
+ * Keeps the CPU time of all monitor threads under the 'set budget'
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "governor.h"
+#include "logLibrary.h"
+
+void governorAdjust(long long nowUsec);
+
+pthread_mutex_t governorMutex;
+GovernorState governor = { 1.0, 0.0, 0.0 };
+long long governorWindowUsec = 0;     // start of the current window
+long long governorWindowNsec = 0;     // monitor CPU time in it
+
+
+void initGovernor() {
+   if (pthread_mutex_init(&governorMutex, NULL) != 0) {
+      perror("pthread_mutex_init failed");
+      exit(-1);
+   }
+
+   governorWindowUsec = currentTimeUsec();
+
+   return;
+}
+
+void destroyGovernor() {
+   if (pthread_mutex_destroy(&governorMutex) != 0) {
+      perror("pthread_mutex_destroy failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * budget is percent of one core, 0 turns the governor off
+ */
+void governorSetBudget(double budget) {
+   /*
+    *  What threads use this critical section:
+    *    The command thread ('set budget').
+    *
+    *  What shared resources are being protected:
+    *    The governor state.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling) must use
+    *    the shared resources and therefore, must be locked.  It is a copy, so
+    *    monitor threads charging their ticks barely wait.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&governorMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   governor.budget = budget;
+   if (budget <= 0.0) {
+      governor.stretch = 1.0;
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&governorMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+void governorGet(GovernorState *state) {
+   /*
+    *  What threads use this critical section:
+    *    The command thread (listactive) and every monitor thread after it
+    *    charged a tick.
+    *
+    *  What shared resources are being protected:
+    *    The governor state.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling) must use
+    *    the shared resources and therefore, must be locked.  It is a copy, so
+    *    monitor threads charging their ticks barely wait.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&governorMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   *state = governor;
+
+   // unlock
+   if (pthread_mutex_unlock(&governorMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * Return: the CPU time of the calling thread in nsec
+ */
+long long governorThreadCpu() {
+   struct timespec now;
+
+   if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) == -1) {
+      perror("clock_gettime failed");
+      exit(-1);
+   }
+
+   return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+ * Adds the CPU time one tick of a monitor took.
+ *
+ * Return: interval, stretched by the governor unless the monitor is critical
+ */
+unsigned long governorCharge(long long cpuNsec, unsigned long interval, PriorityClass priority) {
+   double stretch = 1.0;
+
+   /*
+    *  What threads use this critical section:
+    *    Every monitor thread (process, cgroup and system) once per tick.
+    *
+    *  What shared resources are being protected:
+    *    The governor state and its usage window.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling) must use
+    *    the shared resources and therefore, must be locked.  It only adds to
+    *    the window and, once per window, divides a few numbers, so no thread
+    *    holds it for long even with thousands of monitors.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&governorMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   governorWindowNsec += cpuNsec;
+   governorAdjust(currentTimeUsec());
+   stretch = governor.stretch;
+
+   // unlock
+   if (pthread_mutex_unlock(&governorMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return (priority == PRIORITY_CRITICAL) ? interval : (unsigned long)(interval * stretch);
+}
+
+/*
+ * Copies the governor into seen
+ *
+ * Return: 1 if the stretch differs from the one seen before, 0 otherwise
+ */
+int governorChanged(GovernorState *seen) {
+   double stretch = seen->stretch;
+
+   governorGet(seen);
+
+   return (seen->stretch != stretch) ? 1 : 0;
+}
+
+void governorPrint(FILE *fLogFile, const GovernorState *state) {
+   char timeStr[MAX_TIME_LEN] = "";
+
+   fprintf(fLogFile, "[%s] Governor  [GOVERNOR] stretch %.2f usage %.2f%% budget %.2f%%\n",
+         generateLogTime(timeStr), state->stretch, state->usage, state->budget);
+
+   return;
+}
+
+/*
+ * Closes the window once it is GOVERNOR_WINDOW long.  Over budget, every
+ * interval is stretched so the next window lands at GOVERNOR_TARGET of it;
+ * well under budget (GOVERNOR_RELAX) the stretch shrinks the same way.
+ * Must be called with the governor locked.
+ */
+void governorAdjust(long long nowUsec) {
+   long long elapsed = nowUsec - governorWindowUsec;
+   double stretch = governor.stretch;
+
+   if (elapsed < GOVERNOR_WINDOW) {
+      return;
+   }
+
+   governor.usage = 100.0 * (governorWindowNsec / 1000.0) / elapsed;
+   governorWindowUsec = nowUsec;
+   governorWindowNsec = 0;
+
+   if (governor.budget <= 0.0) {
+      governor.stretch = 1.0;
+      return;
+   }
+
+   if (governor.usage > governor.budget ||
+         (governor.usage < governor.budget * GOVERNOR_RELAX && stretch > 1.0)) {
+      stretch *= governor.usage / (governor.budget * GOVERNOR_TARGET);
+   }
+
+   stretch = (stretch < 1.0) ? 1.0 : (stretch > GOVERNOR_MAX_STRETCH) ? GOVERNOR_MAX_STRETCH : stretch;
+   // whole hundredths, so the logs only see real changes
+   governor.stretch = (long long)(stretch * 100.0 + 0.5) / 100.0;
+
+   return;
+}
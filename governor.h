@@ -0,0 +1,32 @@
+#ifndef __GOVERNOR_H_
+#define __GOVERNOR_H_
+
+#include <stdio.h>
+
+#include "scheduler.h"
+
+#define GOVERNOR_WINDOW 1000000     // usec of ticks folded into one usage
+#define GOVERNOR_MAX_STRETCH 64.0   // intervals never grow beyond this
+#define GOVERNOR_TARGET 0.75        // of the budget, after a change
+#define GOVERNOR_RELAX 0.5          // of the budget, below it stretch shrinks
+
+/*
+ * What the monitors cost mond, as last seen by one monitor.  usage and
+ * budget are percent of one core.
+ */
+typedef struct {
+   double stretch;
+   double usage;
+   double budget;
+} GovernorState;
+
+void initGovernor();
+void destroyGovernor();
+void governorSetBudget(double budget);
+void governorGet(GovernorState *state);
+long long governorThreadCpu();
+unsigned long governorCharge(long long cpuNsec, unsigned long interval, PriorityClass priority);
+int governorChanged(GovernorState *seen);
+void governorPrint(FILE *fLogFile, const GovernorState *state);
+
+#endif // __GOVERNOR_H_
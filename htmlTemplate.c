@@ -0,0 +1,154 @@
+/*
+ * Precompiled html templates: static fragments with typed slots rendered
+ * straight into a Buffer, without printf.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "htmlTemplate.h"
+
+#define SECONDS_PER_HOUR 3600
+
+void appendTwoDigits(Buffer *buf, int value);
+long utcOffsetAt(time_t when);
+
+
+void timeCacheInit(TimeCache *cache) {
+   memset(cache, 0, sizeof (TimeCache));
+   cache->windowStart = -1;
+
+   return;
+}
+
+void templateRender(Buffer *buf, TimeCache *cache, const Fragment *tmpl, const SlotValue *values) {
+   const Fragment *frag = NULL;
+
+   for (frag = tmpl; ; frag++) {
+      bufferAppend(buf, frag->text, frag->len);
+
+      switch (frag->slot) {
+         case SLOT_END:
+            return;
+         case SLOT_UNSIGNED:
+            bufferAppendUnsigned(buf, values->u);
+            break;
+         case SLOT_SIGNED:
+            bufferAppendSigned(buf, values->s);
+            break;
+         case SLOT_TEXT:
+            templateAppendText(buf, values->str);
+            break;
+         case SLOT_RAW:
+            bufferAppendStr(buf, values->str);
+            break;
+         case SLOT_TIME:
+            templateAppendTime(buf, cache, values->t);
+            break;
+      }
+
+      values++;
+   }
+
+   return;
+}
+
+void templateAppendTime(Buffer *buf, TimeCache *cache, time_t when) {
+   struct tm tm;
+   long offset = 0;
+
+   if (cache->windowStart == -1 || when < cache->windowStart ||
+         when >= cache->windowStart + cache->windowLen) {
+      if (localtime_r(&when, &tm) == NULL) {
+         perror("localtime_r failed");
+         exit(-1);
+      }
+
+      cache->windowStart = when - tm.tm_min * 60 - tm.tm_sec;
+      cache->windowLen = SECONDS_PER_HOUR;
+      cache->firstMinute = 0;
+
+      if (utcOffsetAt(cache->windowStart) != tm.tm_gmtoff ||
+            utcOffsetAt(cache->windowStart + SECONDS_PER_HOUR - 1) != tm.tm_gmtoff) {
+         cache->windowStart = when - tm.tm_sec;
+         cache->windowLen = 60;
+         cache->firstMinute = tm.tm_min;
+      }
+
+      cache->prefixLen = strftime(cache->prefix, sizeof (cache->prefix), "%a %b %d %H:", &tm);
+      cache->yearLen = strftime(cache->year, sizeof (cache->year), " %Y", &tm);
+   }
+
+   offset = (long)(when - cache->windowStart);
+
+   bufferAppend(buf, cache->prefix, cache->prefixLen);
+   appendTwoDigits(buf, cache->firstMinute + offset / 60);
+   bufferAppend(buf, ":", 1);
+   appendTwoDigits(buf, offset % 60);
+   bufferAppend(buf, cache->year, cache->yearLen);
+
+   return;
+}
+
+/*
+ * Appends text with the html special characters escaped; runs without any
+ * copy the characters in bulk
+ */
+void templateAppendText(Buffer *buf, const char *text) {
+   const char *run = text;
+   const char *entity = NULL;
+
+   for (; *text != '\0'; text++) {
+      switch (*text) {
+         case '&':
+            entity = "&amp;";
+            break;
+         case '<':
+            entity = "&lt;";
+            break;
+         case '>':
+            entity = "&gt;";
+            break;
+         case '"':
+            entity = "&quot;";
+            break;
+         case '\'':
+            entity = "&#39;";
+            break;
+         default:
+            continue;
+      }
+
+      bufferAppend(buf, run, text - run);
+      bufferAppendStr(buf, entity);
+      run = text + 1;
+   }
+
+   bufferAppend(buf, run, text - run);
+
+   return;
+}
+
+long utcOffsetAt(time_t when) {
+   struct tm tm;
+
+   if (localtime_r(&when, &tm) == NULL) {
+      perror("localtime_r failed");
+      exit(-1);
+   }
+
+   return tm.tm_gmtoff;
+}
+
+void appendTwoDigits(Buffer *buf, int value) {
+   char digits[2];
+
+   digits[0] = '0' + value / 10;
+   digits[1] = '0' + value % 10;
+   bufferAppend(buf, digits, 2);
+
+   return;
+}
@@ -0,0 +1,58 @@
+#ifndef __HTML_TEMPLATE_H_
+#define __HTML_TEMPLATE_H_
+
+#include <stddef.h>
+#include <time.h>
+
+#include "buffer.h"
+
+/*
+ * A template is an array of static fragments, each followed by the slot its
+ * value is written into.  The last fragment has SLOT_END.  Fragment lengths
+ * are computed by the compiler so rendering is memcpy plus the slot values.
+ */
+typedef enum {
+   SLOT_END = 0,
+   SLOT_UNSIGNED,   // value.u
+   SLOT_SIGNED,     // value.s
+   SLOT_TEXT,       // value.str, html escaped
+   SLOT_RAW,        // value.str, copied as is
+   SLOT_TIME        // value.t, "%a %b %d %T %Y" in local time
+} SlotType;
+
+typedef struct {
+   const char *text;
+   size_t len;
+   SlotType slot;
+} Fragment;
+
+#define FRAGMENT(text, slot) { text, sizeof (text) - 1, slot }
+
+typedef union {
+   unsigned long u;
+   long s;
+   const char *str;
+   time_t t;
+} SlotValue;
+
+/*
+ * Local time of the hour last formatted; times in the same hour only need
+ * their minutes and seconds written.  An hour with a utc offset change in it
+ * is cached a minute at a time instead.
+ */
+typedef struct {
+   time_t windowStart;
+   long windowLen;
+   int firstMinute;      // minute of windowStart (0 unless a minute window)
+   char prefix[32];      // "Mon Jan 02 13:"
+   size_t prefixLen;
+   char year[8];         // " 2026"
+   size_t yearLen;
+} TimeCache;
+
+void timeCacheInit(TimeCache *cache);
+void templateRender(Buffer *buf, TimeCache *cache, const Fragment *tmpl, const SlotValue *values);
+void templateAppendTime(Buffer *buf, TimeCache *cache, time_t when);
+void templateAppendText(Buffer *buf, const char *text);
+
+#endif // __HTML_TEMPLATE_H_
@@ -0,0 +1,728 @@
+/*
+ * Minimal non-blocking HTTP/1.1 server driven by epoll.
+ *
+ * A single thread owns the server and calls httpServerPoll() in its loop.
+ * Every connection is non-blocking; requests are parsed from the per
+ * connection input buffer (pipelining and keep-alive are supported) and
+ * whatever the socket does not accept right away is kept in the output
+ * buffer until EPOLLOUT says there is room again.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "httpServer.h"
+
+void httpAcceptConns(HttpServer *server);
+void httpReadConn(HttpServer *server, HttpConn *conn);
+void httpFlushConn(HttpConn *conn);
+void httpCloseConn(HttpServer *server, HttpConn *conn);
+void httpSweepConns(HttpServer *server);
+void httpSetWantWrite(HttpConn *conn, int want);
+void httpWritev(HttpConn *conn, struct iovec *iov, int iovCnt);
+int httpParseRequest(char *head, HttpRequest *req, size_t *bodyLen);
+const char *httpStatusText(int status);
+
+
+int httpServerInit(HttpServer *server, int port, HttpHandler handler, void *ctx) {
+   struct sockaddr_in addr;
+   struct epoll_event ev;
+   int on = 1;
+
+   memset(server, 0, sizeof (HttpServer));
+   server->listenFd = -1;
+   server->epollFd = -1;
+   server->wakeFd = -1;
+   server->port = port;
+   server->handler = handler;
+   server->ctx = ctx;
+
+   if ((server->listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+      perror("socket failed");
+      return -1;
+   }
+
+   if (setsockopt(server->listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on)) == -1) {
+      perror("setsockopt failed");
+      httpServerDestroy(server);
+      return -1;
+   }
+
+   // only serve the local host
+   memset(&addr, 0, sizeof (addr));
+   addr.sin_family = AF_INET;
+   addr.sin_port = htons(port);
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   if (bind(server->listenFd, (struct sockaddr *)&addr, sizeof (addr)) == -1) {
+      perror("bind failed");
+      httpServerDestroy(server);
+      return -1;
+   }
+
+   if (listen(server->listenFd, SOMAXCONN) == -1) {
+      perror("listen failed");
+      httpServerDestroy(server);
+      return -1;
+   }
+
+   if ((server->epollFd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+      perror("epoll_create1 failed");
+      httpServerDestroy(server);
+      return -1;
+   }
+
+   // a NULL data pointer marks the listening socket
+   memset(&ev, 0, sizeof (ev));
+   ev.events = EPOLLIN;
+   ev.data.ptr = NULL;
+   if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->listenFd, &ev) == -1) {
+      perror("epoll_ctl failed");
+      httpServerDestroy(server);
+      return -1;
+   }
+
+   return 0;
+}
+
+void httpServerDestroy(HttpServer *server) {
+
+   while (server->conns != NULL) {
+      httpCloseConn(server, server->conns);
+   }
+
+   if (server->epollFd != -1) {
+      close(server->epollFd);
+      server->epollFd = -1;
+   }
+
+   if (server->listenFd != -1) {
+      close(server->listenFd);
+      server->listenFd = -1;
+   }
+
+   return;
+}
+
+/*
+ * Also waits on fd (ie. an eventfd) and calls onWake when it is readable
+ */
+int httpServerSetWake(HttpServer *server, int fd, HttpWakeHandler onWake) {
+   struct epoll_event ev;
+
+   server->wakeFd = fd;
+   server->onWake = onWake;
+
+   memset(&ev, 0, sizeof (ev));
+   ev.events = EPOLLIN;
+   ev.data.ptr = &(server->wakeFd);
+   if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+      perror("epoll_ctl failed");
+      return -1;
+   }
+
+   return 0;
+}
+
+/*
+ * Waits at most timeoutMs for socket activity and services it.
+ */
+void httpServerPoll(HttpServer *server, int timeoutMs) {
+   struct epoll_event events[HTTP_MAX_EVENTS];
+   int n = 0;
+   int i = 0;
+
+   if ((n = epoll_wait(server->epollFd, events, HTTP_MAX_EVENTS, timeoutMs)) == -1) {
+      if (errno != EINTR) {
+         perror("epoll_wait failed");
+         exit(-1);
+      }
+      n = 0;
+   }
+
+   for (i = 0; i < n; i++) {
+      HttpConn *conn = (HttpConn *)events[i].data.ptr;
+
+      if (conn == NULL) {
+         httpAcceptConns(server);
+         continue;
+      }
+
+      if ((void *)conn == (void *)&(server->wakeFd)) {
+         server->onWake(server, server->ctx);
+         continue;
+      }
+
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+         httpCloseConn(server, conn);
+         continue;
+      }
+
+      if (events[i].events & EPOLLOUT) {
+         httpFlushConn(conn);
+      }
+
+      if (conn->dead == 0 && (events[i].events & EPOLLIN)) {
+         httpReadConn(server, conn);
+      }
+
+      if (conn->dead != 0 || (conn->closeAfterWrite != 0 && conn->out.len == 0)) {
+         httpCloseConn(server, conn);
+      }
+   }
+
+   httpSweepConns(server);
+
+   return;
+}
+
+void httpAcceptConns(HttpServer *server) {
+   struct epoll_event ev;
+   HttpConn *conn = NULL;
+   int fd = -1;
+   int on = 1;
+
+   while (1) {
+      if ((fd = accept4(server->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1) {
+         if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ||
+               errno == ECONNABORTED) {
+            return;
+         }
+         if (errno == EMFILE || errno == ENFILE) {
+            // out of descriptors, try again on the next wake up
+            return;
+         }
+         perror("accept4 failed");
+         exit(-1);
+      }
+
+      if (server->connCount >= HTTP_MAX_CONNS) {
+         close(fd);
+         continue;
+      }
+
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof (on));
+
+      if ((conn = (HttpConn *)calloc(1, sizeof (HttpConn))) == NULL) {
+         perror("calloc failed");
+         exit(-1);
+      }
+
+      conn->fd = fd;
+      conn->epollFd = server->epollFd;
+      conn->lastActive = time(NULL);
+      bufferInit(&conn->in);
+      bufferInit(&conn->out);
+
+      memset(&ev, 0, sizeof (ev));
+      ev.events = EPOLLIN;
+      ev.data.ptr = conn;
+      if (epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+         perror("epoll_ctl failed");
+         exit(-1);
+      }
+
+      conn->next = server->conns;
+      server->conns = conn;
+      server->connCount++;
+   }
+
+   return;
+}
+
+void httpReadConn(HttpServer *server, HttpConn *conn) {
+   HttpRequest req;
+   ssize_t n = 0;
+   size_t bodyLen = 0;
+   char *end = NULL;
+   int eof = 0;
+
+   conn->lastActive = time(NULL);
+
+   // a complete request fits in HTTP_MAX_BUFFERED, so reading stops there
+   // and whatever is left waits in the socket for the next EPOLLIN
+   while (conn->in.len < HTTP_MAX_BUFFERED) {
+      bufferReserve(&conn->in, HTTP_READ_SIZE);
+      n = read(conn->fd, conn->in.data + conn->in.len, conn->in.cap - conn->in.len - 1);
+      if (n > 0) {
+         conn->in.len += n;
+         // nothing more will be answered, drop what else the peer sends
+         if (conn->closeAfterWrite != 0 || conn->streaming != 0) {
+            conn->in.len = 0;
+         }
+         continue;
+      }
+      if (n == 0) { // peer closed its side, answer what it sent
+         eof = 1;
+         break;
+      }
+      if (errno == EINTR) {
+         continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+         break;
+      }
+      conn->dead = 1;
+      return;
+   }
+
+   // handle every complete request in the buffer (pipelining)
+   while (conn->dead == 0 && conn->closeAfterWrite == 0 && conn->streaming == 0) {
+      conn->in.data[conn->in.len] = '\0';
+
+      if ((end = strstr(conn->in.data, "\r\n\r\n")) == NULL ||
+            (size_t)(end - conn->in.data) > HTTP_MAX_REQUEST_LEN) {
+         if (conn->in.len > HTTP_MAX_REQUEST_LEN) {
+            memset(&req, 0, sizeof (req));
+            req.keepAlive = 0;
+            httpRespond(conn, &req, 431, "text/plain", "request too large\n", 18);
+         }
+         break;
+      }
+
+      *end = '\0';
+      if (httpParseRequest(conn->in.data, &req, &bodyLen) == -1) {
+         memset(&req, 0, sizeof (req));
+         req.keepAlive = 0;
+         httpRespond(conn, &req, 400, "text/plain", "bad request\n", 12);
+         break;
+      }
+
+      // wait for the (ignored) request body to arrive
+      if ((size_t)(end + 4 - conn->in.data) + bodyLen > conn->in.len) {
+         *end = '\r';
+         if (bodyLen > HTTP_MAX_REQUEST_LEN) {
+            memset(&req, 0, sizeof (req));
+            req.keepAlive = 0;
+            httpRespond(conn, &req, 413, "text/plain", "request too large\n", 18);
+         }
+         break;
+      }
+
+      if (req.keepAlive == 0) {
+         conn->closeAfterWrite = 1;
+      }
+
+      server->handler(conn, &req, server->ctx);
+
+      bufferConsume(&conn->in, (end + 4 - conn->in.data) + bodyLen);
+      bufferReserve(&conn->in, 1);
+   }
+
+   if (eof != 0) {
+      conn->closeAfterWrite = 1;
+   }
+
+   return;
+}
+
+/*
+ * Parses the request line and the headers we care about in place.
+ *
+ * Return: 0 on success, -1 on a malformed request
+ */
+int httpParseRequest(char *head, HttpRequest *req, size_t *bodyLen) {
+   char *line = NULL, *next = NULL, *version = NULL, *value = NULL, *end = NULL;
+   int keepAliveHeader = -1;
+
+   memset(req, 0, sizeof (HttpRequest));
+   *bodyLen = 0;
+
+   // request line: METHOD SP target SP HTTP/1.x
+   if ((next = strstr(head, "\r\n")) != NULL) {
+      *next = '\0';
+      next += 2;
+   }
+
+   req->method = head;
+   if ((line = strchr(head, ' ')) == NULL) {
+      return -1;
+   }
+   *line++ = '\0';
+   req->path = line;
+   if ((version = strchr(line, ' ')) == NULL) {
+      return -1;
+   }
+   *version++ = '\0';
+
+   if (strncmp(version, "HTTP/1.", 7) != 0 || version[7] < '0' || version[7] > '9') {
+      return -1;
+   }
+   req->minorVersion = version[7] - '0';
+
+   if ((line = strchr(req->path, '?')) != NULL) {
+      *line++ = '\0';
+      req->query = line;
+   } else {
+      req->query = "";
+   }
+
+   // headers
+   while (next != NULL && *next != '\0') {
+      line = next;
+      if ((next = strstr(line, "\r\n")) != NULL) {
+         *next = '\0';
+         next += 2;
+      }
+
+      if ((value = strchr(line, ':')) == NULL) {
+         return -1;
+      }
+      *value++ = '\0';
+      while (*value == ' ' || *value == '\t') {
+         value++;
+      }
+
+      if (strcasecmp(line, "Connection") == 0) {
+         if (strcasestr(value, "close") != NULL) {
+            keepAliveHeader = 0;
+         } else if (strcasestr(value, "keep-alive") != NULL) {
+            keepAliveHeader = 1;
+         }
+      } else if (strcasecmp(line, "Content-Length") == 0) {
+         // strtoul would take "-1" as a huge length
+         if (*value < '0' || *value > '9') {
+            return -1;
+         }
+         errno = 0;
+         *bodyLen = strtoul(value, &end, 10);
+         while (*end == ' ' || *end == '\t') {
+            end++;
+         }
+         if (errno != 0 || *end != '\0') {
+            return -1;
+         }
+      } else if (strcasecmp(line, "Last-Event-ID") == 0) {
+         req->lastEventId = value;
+      }
+   }
+
+   if (keepAliveHeader == -1) {
+      req->keepAlive = (req->minorVersion >= 1) ? 1 : 0;
+   } else {
+      req->keepAlive = keepAliveHeader;
+   }
+
+   req->isHead = (strcmp(req->method, "HEAD") == 0) ? 1 : 0;
+
+   return 0;
+}
+
+void httpRespond(HttpConn *conn, HttpRequest *req, int status,
+      const char *contentType, const char *body, size_t len) {
+   char header[512] = "";
+   struct iovec iov[2];
+   int headerLen = 0;
+
+   headerLen = snprintf(header, sizeof (header),
+         "HTTP/1.1 %d %s\r\n"
+         "Server: mond\r\n"
+         "Content-Type: %s\r\n"
+         "Content-Length: %lu\r\n"
+         "Cache-Control: no-store\r\n"
+         "Connection: %s\r\n"
+         "\r\n",
+         status, httpStatusText(status), contentType, (unsigned long)len,
+         (req->keepAlive != 0) ? "keep-alive" : "close");
+
+   if (headerLen < 0) {
+      perror("snprintf failed");
+      exit(-1);
+   }
+
+   if (req->keepAlive == 0) {
+      conn->closeAfterWrite = 1;
+   }
+
+   iov[0].iov_base = header;
+   iov[0].iov_len = headerLen;
+   iov[1].iov_base = (void *)body;
+   iov[1].iov_len = (req->isHead != 0) ? 0 : len;
+
+   httpWritev(conn, iov, 2);
+
+   return;
+}
+
+void httpSend(HttpConn *conn, const char *data, size_t len) {
+   struct iovec iov;
+
+   iov.iov_base = (void *)data;
+   iov.iov_len = len;
+
+   httpWritev(conn, &iov, 1);
+
+   return;
+}
+
+/*
+ * Writes straight to the socket when nothing is queued, and queues whatever
+ * the socket did not take.
+ */
+void httpWritev(HttpConn *conn, struct iovec *iov, int iovCnt) {
+   struct msghdr msg;
+   ssize_t written = 0;
+   int i = 0;
+
+   if (conn->dead != 0) {
+      return;
+   }
+
+   if (conn->out.len == 0) {
+      memset(&msg, 0, sizeof (msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = iovCnt;
+
+      // sendmsg is writev that can ask for EPIPE instead of SIGPIPE
+      do {
+         written = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+      } while (written == -1 && errno == EINTR);
+
+      // EPIPE and ECONNRESET: the peer went away
+      if (written == -1) {
+         if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            conn->dead = 1;
+            return;
+         }
+         written = 0;
+      }
+   }
+
+   for (i = 0; i < iovCnt; i++) {
+      if ((size_t)written >= iov[i].iov_len) {
+         written -= iov[i].iov_len;
+         continue;
+      }
+      bufferAppend(&conn->out, (char *)iov[i].iov_base + written, iov[i].iov_len - written);
+      written = 0;
+   }
+
+   if (conn->out.len > 0) {
+      httpSetWantWrite(conn, 1);
+   }
+
+   return;
+}
+
+void httpFlushConn(HttpConn *conn) {
+   ssize_t written = 0;
+
+   while (conn->out.len > 0) {
+      // a peer that went away is EPIPE on this connection, not SIGPIPE for mond
+      written = send(conn->fd, conn->out.data, conn->out.len, MSG_NOSIGNAL);
+      if (written == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+         }
+         conn->dead = 1;
+         return;
+      }
+      bufferConsume(&conn->out, written);
+   }
+
+   conn->lastActive = time(NULL);
+   httpSetWantWrite(conn, 0);
+
+   return;
+}
+
+void httpSetWantWrite(HttpConn *conn, int want) {
+   struct epoll_event ev;
+
+   if (conn->wantWrite == want) {
+      return;
+   }
+
+   memset(&ev, 0, sizeof (ev));
+   ev.events = EPOLLIN | ((want != 0) ? EPOLLOUT : 0);
+   ev.data.ptr = conn;
+   if (epoll_ctl(conn->epollFd, EPOLL_CTL_MOD, conn->fd, &ev) == -1) {
+      conn->dead = 1;
+      return;
+   }
+
+   conn->wantWrite = want;
+
+   return;
+}
+
+void httpCloseConn(HttpServer *server, HttpConn *conn) {
+   HttpConn **cur = &(server->conns);
+
+   while (*cur != NULL && *cur != conn) {
+      cur = &((*cur)->next);
+   }
+
+   if (*cur != NULL) {
+      *cur = conn->next;
+      server->connCount--;
+   }
+
+   // closing the descriptor also removes it from the epoll set
+   close(conn->fd);
+   bufferFree(&conn->in);
+   bufferFree(&conn->out);
+   free(conn);
+
+   return;
+}
+
+/*
+ * Closes connections that failed outside of their own events (ie. while
+ * being pushed to) and keep-alive connections idle for too long
+ */
+void httpSweepConns(HttpServer *server) {
+   time_t now = time(NULL);
+   HttpConn *conn = server->conns, *next = NULL;
+   int idleCheck = (now != server->lastSweep) ? 1 : 0;
+
+   server->lastSweep = now;
+
+   while (conn != NULL) {
+      next = conn->next;
+      if (conn->dead != 0) {
+         httpCloseConn(server, conn);
+      } else if (idleCheck != 0 && conn->streaming == 0 && conn->out.len == 0 &&
+            now - conn->lastActive > HTTP_IDLE_TIMEOUT_SEC) {
+         httpCloseConn(server, conn);
+      }
+      conn = next;
+   }
+
+   return;
+}
+
+/*
+ * Starts a response of unknown length.  HTTP/1.1 clients get chunked
+ * transfer encoding; HTTP/1.0 clients get the raw body and the connection is
+ * closed at the end to delimit it.
+ */
+void httpBeginStream(HttpConn *conn, HttpRequest *req, int status, const char *contentType) {
+   char header[512] = "";
+   int headerLen = 0;
+
+   conn->chunked = (req->minorVersion >= 1) ? 1 : 0;
+   conn->headOnly = req->isHead;
+
+   if (conn->chunked == 0 || req->keepAlive == 0) {
+      conn->closeAfterWrite = 1;
+   }
+
+   headerLen = snprintf(header, sizeof (header),
+         "HTTP/1.1 %d %s\r\n"
+         "Server: mond\r\n"
+         "Content-Type: %s\r\n"
+         "%s"
+         "Cache-Control: no-store\r\n"
+         "Connection: %s\r\n"
+         "\r\n",
+         status, httpStatusText(status), contentType,
+         (conn->chunked != 0) ? "Transfer-Encoding: chunked\r\n" : "",
+         (conn->closeAfterWrite == 0) ? "keep-alive" : "close");
+
+   if (headerLen < 0) {
+      perror("snprintf failed");
+      exit(-1);
+   }
+
+   httpSend(conn, header, headerLen);
+
+   return;
+}
+
+void httpSendChunk(HttpConn *conn, const char *data, size_t len) {
+   char sizeLine[32] = "";
+   struct iovec iov[3];
+   int sizeLen = 0;
+
+   if (len == 0 || conn->headOnly != 0) {
+      return;
+   }
+
+   if (conn->chunked == 0) {
+      httpSend(conn, data, len);
+      return;
+   }
+
+   sizeLen = snprintf(sizeLine, sizeof (sizeLine), "%lx\r\n", (unsigned long)len);
+
+   iov[0].iov_base = sizeLine;
+   iov[0].iov_len = sizeLen;
+   iov[1].iov_base = (void *)data;
+   iov[1].iov_len = len;
+   iov[2].iov_base = "\r\n";
+   iov[2].iov_len = 2;
+
+   httpWritev(conn, iov, 3);
+
+   return;
+}
+
+void httpEndStream(HttpConn *conn) {
+   if (conn->chunked != 0 && conn->headOnly == 0) {
+      httpSend(conn, "0\r\n\r\n", 5);
+   }
+
+   conn->chunked = 0;
+   conn->headOnly = 0;
+
+   return;
+}
+
+/*
+ * Copies the value of name=value from a query string into value
+ *
+ * Return: 0 if found, -1 otherwise
+ */
+int httpQueryParam(const char *query, const char *name, char *value, size_t len) {
+   size_t nameLen = strlen(name);
+   size_t i = 0;
+   const char *cursor = query;
+
+   while (cursor != NULL && *cursor != '\0') {
+      if (strncmp(cursor, name, nameLen) == 0 && cursor[nameLen] == '=') {
+         cursor += nameLen + 1;
+         for (i = 0; i < len - 1 && cursor[i] != '\0' && cursor[i] != '&'; i++) {
+            value[i] = cursor[i];
+         }
+         value[i] = '\0';
+         return 0;
+      }
+      if ((cursor = strchr(cursor, '&')) != NULL) {
+         cursor++;
+      }
+   }
+
+   return -1;
+}
+
+const char *httpStatusText(int status) {
+   switch (status) {
+      case 200: return "OK";
+      case 400: return "Bad Request";
+      case 404: return "Not Found";
+      case 405: return "Method Not Allowed";
+      case 413: return "Payload Too Large";
+      case 431: return "Request Header Fields Too Large";
+      case 503: return "Service Unavailable";
+      default: return "Unknown";
+   }
+}
@@ -0,0 +1,79 @@
+
+#ifndef __HTTP_SERVER_H_
+#define __HTTP_SERVER_H_
+
+#include <stddef.h>
+#include <time.h>
+
+#include "buffer.h"
+
+#define HTTP_MAX_CONNS 1024
+#define HTTP_MAX_EVENTS 64
+#define HTTP_MAX_REQUEST_LEN 8192
+#define HTTP_MAX_BUFFERED (HTTP_MAX_REQUEST_LEN * 2 + 4)   // largest head, its end and largest body
+#define HTTP_IDLE_TIMEOUT_SEC 30
+#define HTTP_READ_SIZE 4096
+
+struct HttpConn {
+   int fd;
+   int epollFd;
+   Buffer in;
+   Buffer out;
+   int keepAlive;
+   int closeAfterWrite;
+   int wantWrite;
+   int dead;
+   int chunked;
+   int headOnly;
+   int streaming;
+   unsigned long lastSeq;
+   time_t lastActive;
+   struct HttpConn *next;
+};
+
+typedef struct HttpConn HttpConn;
+
+typedef struct {
+   const char *method;
+   const char *path;
+   const char *query;
+   int minorVersion;
+   int keepAlive;
+   int isHead;
+   const char *lastEventId;
+} HttpRequest;
+
+typedef void (*HttpHandler)(HttpConn *conn, HttpRequest *req, void *ctx);
+
+struct HttpServer;
+typedef void (*HttpWakeHandler)(struct HttpServer *server, void *ctx);
+
+typedef struct HttpServer {
+   int listenFd;
+   int epollFd;
+   int port;
+   int connCount;
+   time_t lastSweep;
+   HttpConn *conns;
+   HttpHandler handler;
+   int wakeFd;
+   HttpWakeHandler onWake;
+   void *ctx;
+} HttpServer;
+
+int httpServerInit(HttpServer *server, int port, HttpHandler handler, void *ctx);
+void httpServerPoll(HttpServer *server, int timeoutMs);
+void httpServerDestroy(HttpServer *server);
+int httpServerSetWake(HttpServer *server, int fd, HttpWakeHandler onWake);
+
+void httpRespond(HttpConn *conn, HttpRequest *req, int status,
+      const char *contentType, const char *body, size_t len);
+void httpSend(HttpConn *conn, const char *data, size_t len);
+
+void httpBeginStream(HttpConn *conn, HttpRequest *req, int status, const char *contentType);
+void httpSendChunk(HttpConn *conn, const char *data, size_t len);
+void httpEndStream(HttpConn *conn);
+
+int httpQueryParam(const char *query, const char *name, char *value, size_t len);
+
+#endif // __HTTP_SERVER_H_
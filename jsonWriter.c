@@ -0,0 +1,321 @@
+/*
+ * Zero allocation streaming JSON writer
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "jsonWriter.h"
+
+#define JSON_MAX_SCALAR_LEN 32
+#define JSON_DOUBLE_SCALE 1000
+#define JSON_DOUBLE_DIGITS 3
+#define JSON_DOUBLE_FIXED_MAX 1e15
+
+void jsonReserve(JsonWriter *w, size_t len);
+void jsonSeparator(JsonWriter *w);
+void jsonRaw(JsonWriter *w, const char *data, size_t len);
+void jsonQuoted(JsonWriter *w, const char *str);
+size_t jsonFormatUnsigned(char *out, unsigned long long value);
+
+
+void jsonInit(JsonWriter *w, JsonSink sink, void *ctx) {
+   w->len = 0;
+   w->depth = 0;
+   w->count[0] = 0;
+   w->afterKey = 0;
+   w->sink = sink;
+   w->ctx = ctx;
+
+   return;
+}
+
+void jsonFlush(JsonWriter *w) {
+   if (w->len > 0) {
+      w->sink(w->ctx, w->buf, w->len);
+      w->len = 0;
+   }
+
+   return;
+}
+
+/*
+ * Makes sure len more bytes fit in the buffer (len <= JSON_MAX_SCALAR_LEN)
+ */
+void jsonReserve(JsonWriter *w, size_t len) {
+   if (w->len + len > JSON_BUF_LEN) {
+      jsonFlush(w);
+   }
+
+   return;
+}
+
+void jsonRaw(JsonWriter *w, const char *data, size_t len) {
+   size_t room = 0;
+
+   while (len > 0) {
+      if (w->len == JSON_BUF_LEN) {
+         jsonFlush(w);
+      }
+      room = JSON_BUF_LEN - w->len;
+      if (room > len) {
+         room = len;
+      }
+      memcpy(w->buf + w->len, data, room);
+      w->len += room;
+      data += room;
+      len -= room;
+   }
+
+   return;
+}
+
+/*
+ * Emits the ',' between elements of the open container
+ */
+void jsonSeparator(JsonWriter *w) {
+   if (w->afterKey != 0) {
+      w->afterKey = 0;
+      return;
+   }
+
+   if (w->depth > 0 && w->count[w->depth] > 0) {
+      jsonReserve(w, 1);
+      w->buf[w->len++] = ',';
+   }
+
+   w->count[w->depth]++;
+
+   return;
+}
+
+void jsonBeginObject(JsonWriter *w) {
+   jsonSeparator(w);
+   jsonReserve(w, 1);
+   w->buf[w->len++] = '{';
+
+   if (w->depth < JSON_MAX_DEPTH - 1) {
+      w->depth++;
+   }
+   w->count[w->depth] = 0;
+
+   return;
+}
+
+void jsonEndObject(JsonWriter *w) {
+   jsonReserve(w, 1);
+   w->buf[w->len++] = '}';
+
+   if (w->depth > 0) {
+      w->depth--;
+   }
+
+   return;
+}
+
+void jsonBeginArray(JsonWriter *w) {
+   jsonSeparator(w);
+   jsonReserve(w, 1);
+   w->buf[w->len++] = '[';
+
+   if (w->depth < JSON_MAX_DEPTH - 1) {
+      w->depth++;
+   }
+   w->count[w->depth] = 0;
+
+   return;
+}
+
+void jsonEndArray(JsonWriter *w) {
+   jsonReserve(w, 1);
+   w->buf[w->len++] = ']';
+
+   if (w->depth > 0) {
+      w->depth--;
+   }
+
+   return;
+}
+
+void jsonKey(JsonWriter *w, const char *key) {
+   w->afterKey = 0;
+   jsonSeparator(w);
+   jsonQuoted(w, key);
+   jsonReserve(w, 1);
+   w->buf[w->len++] = ':';
+   w->afterKey = 1;
+
+   return;
+}
+
+void jsonString(JsonWriter *w, const char *str) {
+   jsonSeparator(w);
+   jsonQuoted(w, str);
+
+   return;
+}
+
+/*
+ * Writes str as a quoted and escaped JSON string
+ */
+void jsonQuoted(JsonWriter *w, const char *str) {
+   static const char hex[] = "0123456789abcdef";
+   const unsigned char *p = (const unsigned char *)str;
+
+   jsonReserve(w, 1);
+   w->buf[w->len++] = '"';
+
+   for (; *p != '\0'; p++) {
+      jsonReserve(w, 6);
+      if (*p == '"' || *p == '\\') {
+         w->buf[w->len++] = '\\';
+         w->buf[w->len++] = *p;
+      } else if (*p < 0x20) {
+         w->buf[w->len++] = '\\';
+         w->buf[w->len++] = 'u';
+         w->buf[w->len++] = '0';
+         w->buf[w->len++] = '0';
+         w->buf[w->len++] = hex[*p >> 4];
+         w->buf[w->len++] = hex[*p & 0xf];
+      } else {
+         w->buf[w->len++] = *p;
+      }
+   }
+
+   jsonReserve(w, 1);
+   w->buf[w->len++] = '"';
+
+   return;
+}
+
+/*
+ * Return: number of digits written to out (no terminator)
+ */
+size_t jsonFormatUnsigned(char *out, unsigned long long value) {
+   char tmp[JSON_MAX_SCALAR_LEN];
+   size_t n = 0, i = 0;
+
+   do {
+      tmp[n++] = '0' + (value % 10);
+      value /= 10;
+   } while (value != 0);
+
+   for (i = 0; i < n; i++) {
+      out[i] = tmp[n - 1 - i];
+   }
+
+   return n;
+}
+
+void jsonUnsigned(JsonWriter *w, unsigned long long value) {
+   jsonSeparator(w);
+   jsonReserve(w, JSON_MAX_SCALAR_LEN);
+   w->len += jsonFormatUnsigned(w->buf + w->len, value);
+
+   return;
+}
+
+void jsonSigned(JsonWriter *w, long long value) {
+   jsonSeparator(w);
+   jsonReserve(w, JSON_MAX_SCALAR_LEN);
+
+   if (value < 0) {
+      w->buf[w->len++] = '-';
+      w->len += jsonFormatUnsigned(w->buf + w->len, -(unsigned long long)value);
+   } else {
+      w->len += jsonFormatUnsigned(w->buf + w->len, value);
+   }
+
+   return;
+}
+
+/*
+ * Doubles are written with three decimals using integer formatting
+ */
+void jsonDouble(JsonWriter *w, double value) {
+   unsigned long long scaled = 0;
+   size_t n = 0;
+   int i = 0;
+
+   if (!isfinite(value)) {
+      jsonNull(w);
+      return;
+   }
+
+   jsonSeparator(w);
+   jsonReserve(w, JSON_MAX_SCALAR_LEN);
+
+   if (fabs(value) >= JSON_DOUBLE_FIXED_MAX) {
+      n = snprintf(w->buf + w->len, JSON_MAX_SCALAR_LEN, "%.17g", value);
+      w->len += n;
+      return;
+   }
+
+   if (value < 0) {
+      w->buf[w->len++] = '-';
+      value = -value;
+   }
+
+   scaled = (unsigned long long)(value * JSON_DOUBLE_SCALE + 0.5);
+   w->len += jsonFormatUnsigned(w->buf + w->len, scaled / JSON_DOUBLE_SCALE);
+   w->buf[w->len++] = '.';
+
+   scaled %= JSON_DOUBLE_SCALE;
+   for (i = JSON_DOUBLE_DIGITS - 1; i >= 0; i--) {
+      w->buf[w->len + i] = '0' + (scaled % 10);
+      scaled /= 10;
+   }
+   w->len += JSON_DOUBLE_DIGITS;
+
+   return;
+}
+
+void jsonNull(JsonWriter *w) {
+   jsonSeparator(w);
+   jsonRaw(w, "null", 4);
+
+   return;
+}
+
+/*
+ * Ends one top level value with a newline (NDJSON)
+ */
+void jsonEndRecord(JsonWriter *w) {
+   jsonReserve(w, 1);
+   w->buf[w->len++] = '\n';
+   w->depth = 0;
+   w->count[0] = 0;
+   w->afterKey = 0;
+
+   return;
+}
+
+void jsonFieldString(JsonWriter *w, const char *key, const char *str) {
+   jsonKey(w, key);
+   jsonString(w, str);
+
+   return;
+}
+
+void jsonFieldUnsigned(JsonWriter *w, const char *key, unsigned long long value) {
+   jsonKey(w, key);
+   jsonUnsigned(w, value);
+
+   return;
+}
+
+void jsonFieldSigned(JsonWriter *w, const char *key, long long value) {
+   jsonKey(w, key);
+   jsonSigned(w, value);
+
+   return;
+}
+
+void jsonFieldDouble(JsonWriter *w, const char *key, double value) {
+   jsonKey(w, key);
+   jsonDouble(w, value);
+
+   return;
+}
@@ -0,0 +1,47 @@
+
+#ifndef __JSON_WRITER_H_
+#define __JSON_WRITER_H_
+
+#include <stddef.h>
+
+#define JSON_BUF_LEN 8192
+#define JSON_MAX_DEPTH 16
+
+typedef void (*JsonSink)(void *ctx, const char *data, size_t len);
+
+/*
+ * Streaming JSON serializer.  Output is built in the fixed buffer inside the
+ * writer and handed to the sink whenever it fills up, so serializing never
+ * allocates no matter how large the document is.
+ */
+typedef struct {
+   char buf[JSON_BUF_LEN];
+   size_t len;
+   int depth;
+   int count[JSON_MAX_DEPTH];
+   int afterKey;
+   JsonSink sink;
+   void *ctx;
+} JsonWriter;
+
+void jsonInit(JsonWriter *w, JsonSink sink, void *ctx);
+void jsonFlush(JsonWriter *w);
+
+void jsonBeginObject(JsonWriter *w);
+void jsonEndObject(JsonWriter *w);
+void jsonBeginArray(JsonWriter *w);
+void jsonEndArray(JsonWriter *w);
+void jsonKey(JsonWriter *w, const char *key);
+void jsonString(JsonWriter *w, const char *str);
+void jsonUnsigned(JsonWriter *w, unsigned long long value);
+void jsonSigned(JsonWriter *w, long long value);
+void jsonDouble(JsonWriter *w, double value);
+void jsonNull(JsonWriter *w);
+void jsonEndRecord(JsonWriter *w);
+
+void jsonFieldString(JsonWriter *w, const char *key, const char *str);
+void jsonFieldUnsigned(JsonWriter *w, const char *key, unsigned long long value);
+void jsonFieldSigned(JsonWriter *w, const char *key, long long value);
+void jsonFieldDouble(JsonWriter *w, const char *key, double value);
+
+#endif // __JSON_WRITER_H_
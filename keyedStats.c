@@ -0,0 +1,300 @@
+/*
+ * Chosen fields of the "key value" proc files, looked up by key
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keyedStats.h"
+#include "logLibrary.h"
+
+#define KEYED_MIN_TABLE 8
+#define KEYED_SEED_TRIES 4096
+
+unsigned int keyedHash(const char *key, size_t len, unsigned int seed);
+size_t keyedKeyLen(const char *line);
+int keyedLookup(KeyedStats *stats, const char *key, size_t len);
+int keyedFast(KeyedStats *stats);
+void keyedScan(KeyedStats *stats);
+
+
+void keyedStatsInit(KeyedStats *stats) {
+   memset(stats, 0, sizeof (KeyedStats));
+   bufferInit(&(stats->raw));
+
+   return;
+}
+
+void keyedStatsDestroy(KeyedStats *stats) {
+   free(stats->table);
+   stats->table = NULL;
+   bufferFree(&(stats->raw));
+
+   return;
+}
+
+/*
+ * Return: the index of the field (an existing one for a repeated key), -1
+ *         when the key is too long or there are too many fields
+ */
+int keyedStatsAdd(KeyedStats *stats, const char *key, size_t len) {
+   KeyedField *field = NULL;
+   int i = 0;
+
+   if (len == 0 || len >= KEYED_KEY_LEN) {
+      return -1;
+   }
+
+   for (i = 0; i < stats->count; i++) {
+      if (stats->fields[i].len == len && memcmp(stats->fields[i].key, key, len) == 0) {
+         return i;
+      }
+   }
+
+   if (stats->count == KEYED_MAX_FIELDS) {
+      return -1;
+   }
+
+   field = &(stats->fields[stats->count]);
+   memset(field, 0, sizeof (KeyedField));
+   memcpy(field->key, key, len);
+   field->key[len] = '\0';
+   field->len = len;
+
+   return stats->count++;
+}
+
+/*
+ * Adds the fields of a comma separated list of keys
+ *
+ * Return: the number of keys that could not be added
+ */
+int keyedStatsAddList(KeyedStats *stats, const char *list) {
+   const char *start = list, *end = NULL;
+   int failed = 0;
+
+   while (start != NULL && *start != '\0') {
+      if ((end = strchr(start, ',')) == NULL) {
+         end = start + strlen(start);
+      }
+      if (end > start && keyedStatsAdd(stats, start, end - start) == -1) {
+         failed++;
+      }
+      start = (*end == ',') ? end + 1 : end;
+   }
+
+   return failed;
+}
+
+/*
+ * Searches a seed that sends every key to its own slot, growing the table
+ * when a size has none.  Runs once, after the fields are added.
+ */
+void keyedStatsBuild(KeyedStats *stats) {
+   unsigned int size = KEYED_MIN_TABLE, seed = 0, slot = 0;
+   int i = 0, collision = 0;
+
+   while (size < (unsigned int)stats->count * 2) {
+      size *= 2;
+   }
+
+   while (1) {
+      if ((stats->table = (int *)realloc(stats->table, sizeof (int) * size)) == NULL) {
+         perror("realloc failed");
+         exit(-1);
+      }
+
+      for (seed = 0; seed < KEYED_SEED_TRIES; seed++) {
+         memset(stats->table, -1, sizeof (int) * size);
+         collision = 0;
+
+         for (i = 0; i < stats->count && collision == 0; i++) {
+            slot = keyedHash(stats->fields[i].key, stats->fields[i].len, seed) & (size - 1);
+            if (stats->table[slot] != -1) {
+               collision = 1;
+            }
+            stats->table[slot] = i;
+         }
+
+         if (collision == 0) {
+            stats->mask = size - 1;
+            stats->seed = seed;
+            stats->scanned = 0;
+            return;
+         }
+      }
+
+      size *= 2;
+   }
+}
+
+/*
+ * Reads the file and updates every field found in it
+ *
+ * Return: 0 on success, -1 if the file could not be read
+ */
+int keyedStatsUpdate(KeyedStats *stats, int fd, long long timeUsec) {
+   double elapsed = (stats->lastUsec != 0) ? (timeUsec - stats->lastUsec) / 1000000.0 : 0.0;
+   int hadValue[KEYED_MAX_FIELDS];
+   KeyedField *field = NULL;
+   const char *cursor = NULL;
+   int i = 0;
+
+   if (stats->count == 0) {
+      return 0;
+   }
+
+   if (stats->table == NULL || readProcBuffer(fd, &(stats->raw)) <= 0) {
+      return -1;
+   }
+
+   for (i = 0; i < stats->count; i++) {
+      hadValue[i] = stats->fields[i].found;
+      stats->fields[i].prev = stats->fields[i].value;
+   }
+
+   // the lines are where they were last time unless the layout changed
+   if (stats->scanned == 0 || keyedFast(stats) == 0) {
+      if (stats->scanned != 0) {
+         stats->rescans++;
+      }
+      keyedScan(stats);
+   }
+
+   for (i = 0; i < stats->count; i++) {
+      field = &(stats->fields[i]);
+      if (field->found == 0) {
+         field->value = 0;
+         field->perSec = 0.0;
+         continue;
+      }
+
+      cursor = stats->raw.data + field->offset + field->len;
+      field->value = parseUnsigned(&cursor);
+      field->perSec = (hadValue[i] != 0 && elapsed > 0.0) ?
+         counterDelta(field->value, field->prev) / elapsed : 0.0;
+   }
+
+   stats->lastUsec = timeUsec;
+
+   return 0;
+}
+
+/*
+ * Logs " key value" for the fields from first on, with " key/s rate" after
+ * each when rates is set (not after the nr_ gauges of vmstat)
+ */
+void keyedStatsPrint(FILE *fLogFile, KeyedStats *stats, int first, int rates) {
+   KeyedField *field = NULL;
+   int i = 0;
+
+   for (i = first; i < stats->count; i++) {
+      field = &(stats->fields[i]);
+      if (field->found == 0) {
+         continue;
+      }
+
+      fprintf(fLogFile, " %s %llu", field->key, field->value);
+      if (rates != 0 && strncmp(field->key, "nr_", 3) != 0) {
+         fprintf(fLogFile, " %s/s %.1f", field->key, field->perSec);
+      }
+   }
+
+   return;
+}
+
+/*
+ * Note: FNV-1a with the seed mixed into the offset basis
+ */
+unsigned int keyedHash(const char *key, size_t len, unsigned int seed) {
+   unsigned int hash = 2166136261u ^ (seed * 16777619u);
+   size_t i = 0;
+
+   for (i = 0; i < len; i++) {
+      hash ^= (unsigned char)key[i];
+      hash *= 16777619u;
+   }
+
+   return hash ^ (hash >> 15);
+}
+
+/*
+ * Return: the length of the key that starts line ("Cached:" and "pgfault "
+ * both end at their separator)
+ */
+size_t keyedKeyLen(const char *line) {
+   const char *cursor = line;
+
+   while (*cursor != ':' && *cursor != ' ' && *cursor != '\t' && *cursor != '\n' && *cursor != '\0') {
+      cursor++;
+   }
+
+   return cursor - line;
+}
+
+/*
+ * Return: the field of the key, -1 if it was not chosen
+ */
+int keyedLookup(KeyedStats *stats, const char *key, size_t len) {
+   int idx = stats->table[keyedHash(key, len, stats->seed) & stats->mask];
+
+   if (idx == -1 || stats->fields[idx].len != len || memcmp(stats->fields[idx].key, key, len) != 0) {
+      return -1;
+   }
+
+   return idx;
+}
+
+/*
+ * Return: 1 if every field found by the last scan still starts the line at
+ *         its offset, 0 otherwise
+ */
+int keyedFast(KeyedStats *stats) {
+   const char *data = stats->raw.data;
+   KeyedField *field = NULL;
+   int i = 0;
+
+   for (i = 0; i < stats->count; i++) {
+      field = &(stats->fields[i]);
+      if (field->found == 0) {
+         continue;
+      }
+
+      if (field->offset + field->len >= stats->raw.len ||
+            (field->offset != 0 && data[field->offset - 1] != '\n') ||
+            memcmp(data + field->offset, field->key, field->len) != 0 ||
+            keyedKeyLen(data + field->offset) != field->len) {
+         return 0;
+      }
+   }
+
+   return 1;
+}
+
+void keyedScan(KeyedStats *stats) {
+   const char *cursor = stats->raw.data;
+   size_t len = 0;
+   int i = 0, idx = 0;
+
+   for (i = 0; i < stats->count; i++) {
+      stats->fields[i].found = 0;
+   }
+
+   while (cursor != NULL && *cursor != '\0') {
+      len = keyedKeyLen(cursor);
+      if (len > 0 && (idx = keyedLookup(stats, cursor, len)) != -1) {
+         stats->fields[idx].offset = cursor - stats->raw.data;
+         stats->fields[idx].found = 1;
+      }
+
+      if ((cursor = strchr(cursor, '\n')) != NULL) {
+         cursor++;
+      }
+   }
+
+   stats->scanned = 1;
+
+   return;
+}
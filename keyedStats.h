@@ -0,0 +1,48 @@
+#ifndef __KEYED_STATS_H_
+#define __KEYED_STATS_H_
+
+#include <stdio.h>
+
+#include "buffer.h"
+
+#define KEYED_KEY_LEN 48
+#define KEYED_MAX_FIELDS 64
+
+typedef struct {
+   char key[KEYED_KEY_LEN];
+   size_t len;
+   size_t offset;             // start of the field's line in the last read
+   int found;                 // listed by the last full scan
+   unsigned long long value;
+   unsigned long long prev;
+   double perSec;             // value change per second (counters)
+} KeyedField;
+
+/*
+ * The chosen fields of a "key value" file (/proc/meminfo, /proc/vmstat).
+ * The keys are placed in a perfect hash (seed searched once when the fields
+ * are set) for the rescans, and every field remembers where its line was so
+ * a tick normally goes straight to the lines it wants.  A rescan only
+ * happens when a line moved, eg. a kernel with a different layout.
+ */
+typedef struct {
+   KeyedField fields[KEYED_MAX_FIELDS];
+   int count;
+   int *table;                // slot -> field, -1 when empty
+   unsigned int mask;
+   unsigned int seed;
+   int scanned;               // offsets are valid
+   unsigned long rescans;
+   long long lastUsec;
+   Buffer raw;
+} KeyedStats;
+
+void keyedStatsInit(KeyedStats *stats);
+void keyedStatsDestroy(KeyedStats *stats);
+int keyedStatsAdd(KeyedStats *stats, const char *key, size_t len);
+int keyedStatsAddList(KeyedStats *stats, const char *list);
+void keyedStatsBuild(KeyedStats *stats);
+int keyedStatsUpdate(KeyedStats *stats, int fd, long long timeUsec);
+void keyedStatsPrint(FILE *fLogFile, KeyedStats *stats, int first, int rates);
+
+#endif // __KEYED_STATS_H_
@@ -0,0 +1,252 @@
+/*
+ * Detects sustained rss or pss growth of a process and estimates when it
+ * runs out of memory
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "leakTrend.h"
+#include "alerts.h"
+#include "logLibrary.h"
+
+#define USEC_PER_HOUR 3600000000.0
+#define LEAK_FILE_LEN 4096
+
+void leakFit(LeakTrend *trend);
+double leakHeadroom(pid_t pid);
+int leakReadFile(const char *path, char *buf, size_t len);
+void leakRecord(FILE *fLogFile, pid_t pid, LeakTrend *trend, double value);
+
+
+/*
+ * Parses "[rss:|pss:]<window>" (rss if no metric is given)
+ *
+ * Return: 0 on success, -1 if the spec is not valid
+ */
+int leakParse(const char *spec, int *metric, long long *windowUsec) {
+   const char *window = spec;
+   char name[8] = "rss";
+
+   if (strncmp(spec, "rss:", 4) == 0 || strncmp(spec, "pss:", 4) == 0) {
+      snprintf(name, 4, "%s", spec);
+      window = spec + 4;
+   }
+
+   if ((*metric = alertMetric(name, ALERT_PROCESS)) == -1 || alertParseDuration(window, windowUsec) == -1 ||
+         *windowUsec < LEAK_BUCKETS) {
+      return -1;
+   }
+
+   return 0;
+}
+
+/*
+ * Return: NULL if metric is -1 (no trend wanted)
+ */
+LeakTrend *leakCreate(int metric, long long windowUsec) {
+   LeakTrend *trend = NULL;
+
+   if (metric == -1) {
+      return NULL;
+   }
+
+   if ((trend = (LeakTrend *)calloc(1, sizeof (LeakTrend))) == NULL) {
+      perror("calloc failed");
+      exit(-1);
+   }
+
+   trend->metric = metric;
+   trend->windowUsec = windowUsec;
+   trend->oomHours = -1.0;
+
+   return trend;
+}
+
+void leakDestroy(LeakTrend **trend) {
+   free(*trend);
+   *trend = NULL;
+
+   return;
+}
+
+/*
+ * Adds the newest sample of history to its bucket, refits the line and
+ * logs a [LEAK] record when growth starts (again every window while it
+ * lasts) and when it stops.  The caller holds the monitor's log file.
+ */
+void leakUpdate(LeakTrend *trend, FILE *fLogFile, pid_t pid, SampleHistory *history) {
+   const Sample *now = NULL, *prev = NULL;
+   LeakSums *sums = NULL;
+   long long width = 0, bucket = 0, timeUsec = 0, i = 0;
+   double value = 0.0, t = 0.0, y = 0.0;
+   int leaking = 0;
+
+   if (trend == NULL || history == NULL || history->count == 0) {
+      return;
+   }
+
+   now = historyLatest(history);
+   prev = (history->count >= 2) ? historyGet(history, history->count - 2) : NULL;
+   if (alertMetricValue(trend->metric, now, prev, &value) == -1) {
+      return;
+   }
+
+   timeUsec = now->proc.timeUsec;
+   if (trend->firstUsec == 0) {
+      trend->firstUsec = timeUsec;
+      trend->base = value;
+      trend->bucket = 0;
+   }
+
+   width = trend->windowUsec / LEAK_BUCKETS;
+   bucket = (timeUsec - trend->firstUsec) / width;
+
+   // clear the buckets that fell out of the window
+   for (i = trend->bucket + 1; i <= bucket && i <= trend->bucket + LEAK_BUCKETS; i++) {
+      memset(&(trend->sums[i % LEAK_BUCKETS]), 0, sizeof (LeakSums));
+   }
+   trend->bucket = bucket;
+
+   t = (timeUsec - trend->firstUsec - bucket * width) / USEC_PER_HOUR;
+   y = value - trend->base;
+   sums = &(trend->sums[bucket % LEAK_BUCKETS]);
+   sums->n += 1.0;
+   sums->t += t;
+   sums->tt += t * t;
+   sums->y += y;
+   sums->yy += y * y;
+   sums->ty += t * y;
+
+   // a line over part of the window says little
+   if (timeUsec - trend->firstUsec < trend->windowUsec) {
+      return;
+   }
+
+   leakFit(trend);
+   trend->fitted = 1;
+   leaking = (trend->slope >= LEAK_MIN_GROWTH && trend->r2 >= LEAK_MIN_R2);
+
+   if (leaking != 0 && (trend->leaking == 0 || timeUsec - trend->reportUsec >= trend->windowUsec)) {
+      trend->oomHours = -1.0;
+      if ((y = leakHeadroom(pid)) >= 0.0) {
+         trend->oomHours = y / trend->slope;
+      }
+      trend->leaking = 1;
+      trend->reportUsec = timeUsec;
+      leakRecord(fLogFile, pid, trend, value);
+   } else if (leaking == 0 && trend->leaking != 0) {
+      trend->leaking = 0;
+      leakRecord(fLogFile, pid, trend, value);
+   }
+
+   return;
+}
+
+/*
+ * Least squares slope and r^2 of the samples in the window, every bucket
+ * moved to hours from the start of the oldest one
+ */
+void leakFit(LeakTrend *trend) {
+   LeakSums total, *sums = NULL;
+   double hours = trend->windowUsec / LEAK_BUCKETS / USEC_PER_HOUR, o = 0.0;
+   double sxy = 0.0, sxx = 0.0, syy = 0.0;
+   int i = 0;
+
+   memset(&total, 0, sizeof (LeakSums));
+   for (i = 0; i < LEAK_BUCKETS; i++) {
+      sums = &(trend->sums[(trend->bucket - i) % LEAK_BUCKETS]);
+      o = (LEAK_BUCKETS - 1 - i) * hours;
+      total.n += sums->n;
+      total.t += sums->t + sums->n * o;
+      total.tt += sums->tt + 2.0 * o * sums->t + sums->n * o * o;
+      total.y += sums->y;
+      total.yy += sums->yy;
+      total.ty += sums->ty + o * sums->y;
+   }
+
+   sxy = total.n * total.ty - total.t * total.y;
+   sxx = total.n * total.tt - total.t * total.t;
+   syy = total.n * total.yy - total.y * total.y;
+
+   trend->slope = (sxx > 0.0) ? sxy / sxx : 0.0;
+   trend->r2 = (sxx > 0.0 && syy > 0.0) ? (sxy * sxy) / (sxx * syy) : 0.0;
+
+   return;
+}
+
+/*
+ * Return: bytes the process can still grow by, under the tightest
+ * memory.max of its cgroup v2 and ancestors if any is set and otherwise
+ * MemAvailable, -1 if neither can be read
+ */
+double leakHeadroom(pid_t pid) {
+   char buf[LEAK_FILE_LEN] = "", path[LEAK_FILE_LEN] = "", dir[LEAK_FILE_LEN] = "";
+   char *cursor = NULL, *slash = NULL;
+   double headroom = -1.0, limit = 0.0, current = 0.0;
+
+   // "0::/path" is the cgroup v2 line
+   snprintf(path, LEAK_FILE_LEN, "/proc/%d/cgroup", pid);
+   if (leakReadFile(path, buf, LEAK_FILE_LEN) > 0 && (cursor = strstr(buf, "0::/")) != NULL) {
+      snprintf(dir, LEAK_FILE_LEN, "%s", cursor + 3);
+      dir[strcspn(dir, "\n")] = '\0';
+
+      while ((slash = strrchr(dir, '/')) != NULL) {
+         snprintf(path, LEAK_FILE_LEN, "/sys/fs/cgroup%s/memory.max", dir);
+         if (leakReadFile(path, buf, LEAK_FILE_LEN) > 0 && strncmp(buf, "max", 3) != 0) {
+            limit = strtod(buf, NULL);
+            snprintf(path, LEAK_FILE_LEN, "/sys/fs/cgroup%s/memory.current", dir);
+            if (leakReadFile(path, buf, LEAK_FILE_LEN) > 0) {
+               current = strtod(buf, NULL);
+               if (headroom < 0.0 || limit - current < headroom) {
+                  headroom = (limit > current) ? limit - current : 0.0;
+               }
+            }
+         }
+         *slash = '\0';
+      }
+   }
+
+   if (headroom >= 0.0) {
+      return headroom;
+   }
+
+   if (leakReadFile("/proc/meminfo", buf, LEAK_FILE_LEN) > 0 && (cursor = strstr(buf, "MemAvailable:")) != NULL) {
+      return strtod(cursor + strlen("MemAvailable:"), NULL) * 1024.0;
+   }
+
+   return -1.0;
+}
+
+int leakReadFile(const char *path, char *buf, size_t len) {
+   ssize_t n = -1;
+   int fd = -1;
+
+   if ((fd = open(path, O_RDONLY)) == -1) {
+      return -1;
+   }
+   n = readProcFile(fd, buf, len);
+   close(fd);
+
+   return n;
+}
+
+void leakRecord(FILE *fLogFile, pid_t pid, LeakTrend *trend, double value) {
+   char timeStr[MAX_TIME_LEN] = "";
+
+   fprintf(fLogFile, "[%s] Process(%d)  [LEAK] %s %s %.0f growing %.0f bytes/hour (r2 %.2f over %.0f s)",
+         generateLogTime(timeStr), pid, alertMetricName(trend->metric),
+         (trend->leaking != 0) ? "leaking" : "stopped", value, trend->slope, trend->r2,
+         trend->windowUsec / 1000000.0);
+   if (trend->leaking != 0 && trend->oomHours >= 0.0) {
+      fprintf(fLogFile, " oom in %.1f h", trend->oomHours);
+   }
+   fprintf(fLogFile, "\n");
+   fflush(fLogFile);
+
+   return;
+}
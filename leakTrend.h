@@ -0,0 +1,54 @@
+#ifndef __LEAK_TREND_H_
+#define __LEAK_TREND_H_
+
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "samples.h"
+
+#define LEAK_BUCKETS 12
+#define LEAK_MIN_GROWTH 1048576.0     // bytes per hour, slower growth is noise
+#define LEAK_MIN_R2 0.8               // how well a line must fit the window
+
+/*
+ * Least squares sums of the samples of one bucket, time in hours from the
+ * start of the bucket and value in bytes from the first sample
+ */
+typedef struct {
+   double n;
+   double t;
+   double tt;
+   double y;
+   double yy;
+   double ty;
+} LeakSums;
+
+/*
+ * The rss or pss trend of a process ('add ... -w [rss:|pss:]<window>'): a
+ * least squares line over the last window, kept as LEAK_BUCKETS buckets of
+ * sums so a sample costs the same however long the window is.  A process
+ * leaks while the line climbs at least LEAK_MIN_GROWTH and explains at
+ * least LEAK_MIN_R2 of the variance.
+ */
+typedef struct {
+   int metric;                        // in the alert metric table
+   long long windowUsec;
+   long long firstUsec;
+   double base;                       // value of the first sample
+   long long bucket;                  // index of the newest bucket
+   LeakSums sums[LEAK_BUCKETS];
+
+   int fitted;                        // the window was full once
+   double slope;                      // bytes per hour over the window
+   double r2;
+   double oomHours;                   // until the limit at this slope, -1 if unknown
+   int leaking;
+   long long reportUsec;
+} LeakTrend;
+
+int leakParse(const char *spec, int *metric, long long *windowUsec);
+LeakTrend *leakCreate(int metric, long long windowUsec);
+void leakDestroy(LeakTrend **trend);
+void leakUpdate(LeakTrend *trend, FILE *fLogFile, pid_t pid, SampleHistory *history);
+
+#endif // __LEAK_TREND_H_
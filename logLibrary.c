@@ -8,91 +8,12 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <errno.h>
 
 #include "logLibrary.h"
 
 
-/*
- * Note: row and col are base 0 for the first line, first item
- *
- * Return: A (char *) is returned and the space needs to be freed
- */
-char *queryFileByLoc(int fd, int row, int col) {
-   int curRow = 0;
-   int curCol = 0;
-   char *linePtr = NULL, *tokenPtr = NULL, *retPtr = NULL;
-   size_t nSize = -1;
-   FILE *file = NULL;
-
-   if (lseek(fd, SEEK_SET, 0) == -1) {
-      perror("lseek failed");
-      exit(-1);
-   }
-
-   if ((file = fdopen(fd, "r")) == NULL) {
-      perror("fdopen failed");
-      exit(-1);
-   }
-
-   // move to the correct row
-   while (curRow <= row) {
-      if (getline(&linePtr, &nSize, file) == -1) {
-         if (feof(file)) {
-            if (linePtr != NULL) {
-               free(linePtr);
-               linePtr = NULL;
-            }
-            return NULL;
-         }
-         perror("getline failed");
-         exit(-1);
-      }
-      curRow++;
-   }
-
-   // move to the correct column
-   while (curCol <= col) {
-      if ((tokenPtr = strtok((curCol == 0) ? linePtr : NULL, " ")) == NULL) {
-         if (linePtr != NULL) {
-            free(linePtr);
-            linePtr = NULL;
-         }
-         return NULL;
-      }
-
-      curCol++;
-   }
-
-   if ((retPtr = (char *)calloc(1, (sizeof(char) * strlen(tokenPtr)) + 1)) == NULL) {
-      perror("calloc failed");
-      exit(-1);
-   }
-
-   if (tokenPtr != NULL) {
-      strcpy(retPtr, tokenPtr);
-   }
-
-   if (linePtr != NULL) {
-      free(linePtr);
-      linePtr = NULL;
-   }
-
-   // remove ending '\n' for only end of line cases
-   if (retPtr[strlen(retPtr) - 1] == '\n') {
-      retPtr[strlen(retPtr) - 1] = '\0';
-   }
-
-   return retPtr;
-}
-
-void printQuery(FILE *fLogFile, int fdSrc, char *queryField, int row, int col) {
-   char *retQuery = queryFileByLoc(fdSrc, row, col);
-   fprintf(fLogFile, "%s %s", queryField, retQuery);
-   free(retQuery);
-   return;
-}
-
 char *generateLogTime(char *timeStr) {
    time_t timep;
    struct tm *tm;
@@ -131,3 +52,192 @@ void longSleep(long sleepTime) {
 
    return;
 }
+
+long long currentTimeUsec() {
+   struct timeval tv;
+
+   if (gettimeofday(&tv, NULL) == -1) {
+      perror("gettimeofday failed");
+      exit(-1);
+   }
+
+   return (long long)tv.tv_sec * CONVERT_SEC_TO_USEC + tv.tv_usec;
+}
+
+/*
+ * Reads the whole (proc) file from the start into buf without any
+ * allocation.  The result is always '\0' terminated and truncated to fit.
+ *
+ * Return: bytes read or -1 if the file can no longer be read (ie. the
+ *         process is gone)
+ */
+ssize_t readProcFile(int fd, char *buf, size_t len) {
+   ssize_t n = 0;
+   size_t total = 0;
+
+   while (total < len - 1) {
+      if ((n = pread(fd, buf + total, len - 1 - total, total)) == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         buf[0] = '\0';
+         return -1;
+      }
+      if (n == 0) {
+         break;
+      }
+      total += n;
+   }
+
+   buf[total] = '\0';
+
+   return total;
+}
+
+/*
+ * Reads the whole file into buf (which keeps its memory between calls), for
+ * files that grow with the machine like diskstats or net/dev
+ *
+ * Return: the length read (buf is NUL terminated) or -1 on failure
+ */
+ssize_t readProcBuffer(int fd, Buffer *buf) {
+   ssize_t n = 0;
+
+   bufferReset(buf);
+
+   while (1) {
+      bufferReserve(buf, PROC_READ_LEN);
+      if ((n = pread(fd, buf->data + buf->len, buf->cap - buf->len - 1, buf->len)) == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         buf->len = 0;
+         buf->data[0] = '\0';
+         return -1;
+      }
+      if (n == 0) {
+         break;
+      }
+      buf->len += n;
+   }
+
+   buf->data[buf->len] = '\0';
+
+   return buf->len;
+}
+
+/*
+ * Note: row is base 0
+ *
+ * Return: start of the row or NULL if the buffer has fewer rows
+ */
+const char *findLine(const char *buf, int row) {
+   const char *cursor = buf;
+
+   while (row > 0) {
+      if ((cursor = strchr(cursor, '\n')) == NULL) {
+         return NULL;
+      }
+      cursor++;
+      row--;
+   }
+
+   return (*cursor == '\0') ? NULL : cursor;
+}
+
+/*
+ * Return: the start of the first line whose first word is key (a trailing
+ *         ':' on the word is accepted) or NULL if there is none
+ */
+const char *findLineByKey(const char *buf, const char *key) {
+   const char *cursor = buf;
+   size_t keyLen = strlen(key);
+
+   while (cursor != NULL && *cursor != '\0') {
+      if (strncmp(cursor, key, keyLen) == 0 &&
+            (cursor[keyLen] == ' ' || cursor[keyLen] == ':' || cursor[keyLen] == '\t')) {
+         return cursor;
+      }
+      if ((cursor = strchr(cursor, '\n')) != NULL) {
+         cursor++;
+      }
+   }
+
+   return NULL;
+}
+
+/*
+ * Skips count whitespace separated fields on the current line
+ */
+const char *skipFields(const char *cursor, int count) {
+   while (count > 0 && *cursor != '\0' && *cursor != '\n') {
+      while (*cursor == ' ' || *cursor == '\t') {
+         cursor++;
+      }
+      while (*cursor != ' ' && *cursor != '\t' && *cursor != '\n' && *cursor != '\0') {
+         cursor++;
+      }
+      count--;
+   }
+
+   return cursor;
+}
+
+/*
+ * Parses the next number on the line and moves the cursor past it.  A
+ * missing field parses as 0.
+ */
+unsigned long long parseUnsigned(const char **cursor) {
+   const char *p = *cursor;
+   unsigned long long value = 0;
+
+   while (*p == ' ' || *p == '\t' || *p == ':') {
+      p++;
+   }
+
+   while (*p >= '0' && *p <= '9') {
+      value = value * 10 + (*p - '0');
+      p++;
+   }
+
+   *cursor = p;
+
+   return value;
+}
+
+long long parseSigned(const char **cursor) {
+   const char *p = *cursor;
+   int negative = 0;
+   long long value = 0;
+
+   while (*p == ' ' || *p == '\t' || *p == ':') {
+      p++;
+   }
+
+   if (*p == '-') {
+      negative = 1;
+      p++;
+   }
+
+   *cursor = p;
+   value = (long long)parseUnsigned(cursor);
+
+   return (negative != 0) ? -value : value;
+}
+
+double parseDouble(const char **cursor) {
+   char *end = NULL;
+   double value = strtod(*cursor, &end);
+
+   *cursor = end;
+
+   return value;
+}
+
+/*
+ * Note: the kernel restarts a counter when it wraps or the device behind it
+ * is re-added, that tick counts as no change
+ */
+unsigned long long counterDelta(unsigned long long now, unsigned long long prev) {
+   return (now >= prev) ? now - prev : 0;
+}
@@ -3,14 +3,27 @@
 #define __LOG_LIBRARY_H_
 
 #include <stdio.h>
+#include <sys/types.h>
+
+#include "buffer.h"
 
 #define MAX_TIME_LEN 100
 #define CONVERT_SEC_TO_USEC 1000000
 #define MAX_USEC_SLEEP 1000000
+#define PROC_READ_LEN 4096
 
-char *queryFileByLoc(int fd, int row, int col);
-void printQuery(FILE *fLogFile, int fdSrc, char *queryField, int row, int col);
 char *generateLogTime(char *timeStr);
 void longSleep(long sleepTime);
+long long currentTimeUsec();
+
+ssize_t readProcFile(int fd, char *buf, size_t len);
+ssize_t readProcBuffer(int fd, Buffer *buf);
+const char *findLine(const char *buf, int row);
+const char *findLineByKey(const char *buf, const char *key);
+const char *skipFields(const char *cursor, int count);
+unsigned long long parseUnsigned(const char **cursor);
+long long parseSigned(const char **cursor);
+double parseDouble(const char **cursor);
+unsigned long long counterDelta(unsigned long long now, unsigned long long prev);
 
 #endif // __LOG_LIBRARY_H_
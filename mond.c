@@ -9,6 +9,14 @@
 #include "mond.h"
 #include "commands.h"
 #include "webmon.h"
+#include "eventStream.h"
+#include "governor.h"
+#include "alerts.h"
+#include "procBatch.h"
+#include "diskStats.h"
+#include "netStats.h"
+#include "psiStats.h"
+#include "keyedStats.h"
 #include "singlyLinkedList.h"
 
 void commandThread();
@@ -24,6 +32,17 @@ sem_t availableThreads;
 int systemThreadState = SYSTEM_THREAD_NOT_RUNNING;
 LinkedList *completedList = NULL;
 int webmonActive = WEBMON_THREAD_NOT_RUNNING;
+DiskFilter diskFilter = DISK_FILTER_WHOLE;
+float cpuThreshold = 5.0f;
+int alignTicks = 0;
+int useUring = 0;
+NetFilter netFilter = NET_FILTER_ACTIVE;
+unsigned long psiStallUsec = 100000;
+unsigned long psiWindowUsec = 1000000;
+char meminfoFields[MAX_INPUT_LEN] = "";
+FieldPlan fieldPlan;
+char vmstatFields[MAX_INPUT_LEN] = "pgfault,pgmajfault,pswpin,pswpout,pgscan_kswapd,pgscan_direct,"
+   "pgsteal_kswapd,pgsteal_direct,allocstall_normal,compact_stall,oom_kill";
 
 
 int main(int argc, char *argv[]) {
@@ -35,6 +54,11 @@ int main(int argc, char *argv[]) {
 
    initFileTable();
    initThreadTables();
+   fieldPlanCompile(&fieldPlan, "all");
+   initEventLog();
+   initGovernor();
+   initScheduler();
+   initAlerts();
 
    commandThread();
 
@@ -118,7 +142,9 @@ void commandThread() {
 
       if (strncmpSafe("add", token, MAX_INPUT_LEN - 1) == 0) {
          char *type = NULL, *aux = NULL;
-         char *interval = defaultInterval, *logFile = defaultLogFile;
+         char *interval = defaultInterval, *logFile = defaultLogFile, *metrics = NULL;
+         char *slowInterval = NULL, *adaptive = NULL, *priority = NULL, *detect = NULL, *leak = NULL;
+         int badOption = 0;
          token = strtok(NULL, " ");
          if (strncmpSafe("-s", token, MAX_INPUT_LEN - 1) == 0) {
             type = "-s";
@@ -141,35 +167,45 @@ void commandThread() {
             token = strtok(NULL, " ");
             type = "-e";
             aux = token;
+         } else if (strncmpSafe("-c", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            type = "-c";
+            if (token != NULL) {
+               aux = token;
+            } else {
+               printf("ERROR: bad input\n");
+               continue;
+            }
          } else {
             printf("ERROR: bad input\n");
             continue;
          }
 
-         token = strtok(NULL, " ");
-         if (strncmpSafe("-i", token, MAX_INPUT_LEN - 1) == 0) {
-            token = strtok(NULL, " ");
-            interval = token;
-
-            token = strtok(NULL, " ");
-            if (strncmpSafe("-f", token, MAX_INPUT_LEN - 1) == 0) {
-               token = strtok(NULL, " ");
-               if (token != NULL) {
-                  logFile = token;
-               } else {
-                  printf("ERROR: bad input\n");
-                  continue;
-               }
-            }
-         } else if (strncmpSafe("-f", token, MAX_INPUT_LEN - 1) == 0) {
-            token = strtok(NULL, " ");
-            if (token != NULL) {
+         // options in any order: -i <interval> -f <file> -m <metric,...> -t <slow interval> -a <min,max>
+         //    -r <critical|normal|bulk> -d <metric,...> -w [rss:|pss:]<window>
+         while (badOption == 0 && (token = strtok(NULL, " ")) != NULL) {
+            if (strncmpSafe("-i", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
+               interval = token;
+            } else if (strncmpSafe("-f", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
                logFile = token;
+            } else if (strncmpSafe("-m", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
+               metrics = token;
+            } else if (strncmpSafe("-t", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
+               slowInterval = token;
+            } else if (strncmpSafe("-a", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
+               adaptive = token;
+            } else if (strncmpSafe("-r", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
+               priority = token;
+            } else if (strncmpSafe("-d", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
+               detect = token;
+            } else if (strncmpSafe("-w", token, MAX_INPUT_LEN - 1) == 0 && (token = strtok(NULL, " ")) != NULL) {
+               leak = token;
             } else {
-               printf("ERROR: bad input\n");
-               continue;
+               badOption = 1;
             }
-         } else if (token != NULL) {
+         }
+
+         if (badOption == 1) {
             printf("ERROR: bad input\n");
             continue;
          }
@@ -182,7 +218,7 @@ void commandThread() {
 
          if (semValue > 0 || typeFlag == 's') {
             // call add functionality
-            add(type, aux, interval, logFile);
+            add(type, aux, interval, logFile, metrics, slowInterval, adaptive, priority, detect, leak);
          } else {
             printf("Maximum number of threads already reached.\n");
             continue;
@@ -193,7 +229,7 @@ void commandThread() {
          if (strncmpSafe("interval", token, MAX_INPUT_LEN - 1) == 0) {
             token = strtok(NULL, " ");
             if (token == NULL) {
-               printf("%s is not a valid interval\n", token);
+               printf("ERROR: bad input\n");
                continue;
             }
             // set default interval
@@ -209,6 +245,147 @@ void commandThread() {
                perror("strncpy failed");
                exit(-1);
             }
+         } else if (strncmpSafe("cputhreshold", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            if (token == NULL) {
+               printf("ERROR: bad input\n");
+               continue;
+            }
+            // per cpu rows are logged when they moved by this many percent
+            char *end = NULL;
+            float thresholdTemp = strtof(token, &end);
+            if (*end != '\0' || thresholdTemp < 0.0f || thresholdTemp > 100.0f) {
+               printf("%s is not a valid threshold\n", token);
+               continue;
+            }
+            cpuThreshold = thresholdTemp;
+         } else if (strncmpSafe("align", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            // wake every monitor on wall clock multiples of its interval
+            if (strncmpSafe("on", token, MAX_INPUT_LEN - 1) == 0) {
+               alignTicks = 1;
+            } else if (strncmpSafe("off", token, MAX_INPUT_LEN - 1) == 0) {
+               alignTicks = 0;
+            } else {
+               printf("ERROR: bad input\n");
+            }
+         } else if (strncmpSafe("uring", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            // how the next process monitors read stat and statm
+            if (strncmpSafe("on", token, MAX_INPUT_LEN - 1) == 0) {
+               if (procBatchAvailable() == 0) {
+                  printf("io_uring is not available, process monitors keep using pread\n");
+               }
+               useUring = 1;
+            } else if (strncmpSafe("off", token, MAX_INPUT_LEN - 1) == 0) {
+               useUring = 0;
+            } else {
+               printf("ERROR: bad input\n");
+            }
+         } else if (strncmpSafe("budget", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            if (token == NULL) {
+               printf("ERROR: bad input\n");
+               continue;
+            }
+            // percent of one core all monitors together may use, or off
+            if (strncmpSafe("off", token, MAX_INPUT_LEN - 1) == 0) {
+               governorSetBudget(0.0);
+               continue;
+            }
+            char *end = NULL;
+            double budgetTemp = strtod(token, &end);
+            if (*end != '\0' || budgetTemp <= 0.0) {
+               printf("%s is not a valid budget\n", token);
+               continue;
+            }
+            governorSetBudget(budgetTemp);
+         } else if (strncmpSafe("disks", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            // which diskstats rows the system thread logs
+            if (strncmpSafe("all", token, MAX_INPUT_LEN - 1) == 0) {
+               diskFilter = DISK_FILTER_ALL;
+            } else if (strncmpSafe("whole", token, MAX_INPUT_LEN - 1) == 0) {
+               diskFilter = DISK_FILTER_WHOLE;
+            } else if (strncmpSafe("active", token, MAX_INPUT_LEN - 1) == 0) {
+               diskFilter = DISK_FILTER_ACTIVE;
+            } else {
+               printf("ERROR: bad input\n");
+            }
+         } else if (strncmpSafe("nets", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            // which net/dev rows the system thread logs
+            if (strncmpSafe("all", token, MAX_INPUT_LEN - 1) == 0) {
+               netFilter = NET_FILTER_ALL;
+            } else if (strncmpSafe("physical", token, MAX_INPUT_LEN - 1) == 0) {
+               netFilter = NET_FILTER_PHYSICAL;
+            } else if (strncmpSafe("active", token, MAX_INPUT_LEN - 1) == 0) {
+               netFilter = NET_FILTER_ACTIVE;
+            } else {
+               printf("ERROR: bad input\n");
+            }
+         } else if (strncmpSafe("psi", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            if (token == NULL) {
+               printf("ERROR: bad input\n");
+               continue;
+            }
+            // psi trigger the next system thread arms: stall ms per window ms
+            if (strncmpSafe("off", token, MAX_INPUT_LEN - 1) == 0) {
+               psiStallUsec = 0;
+               continue;
+            }
+            char *window = strtok(NULL, " ");
+            if (window == NULL) {
+               printf("ERROR: bad input\n");
+               continue;
+            }
+            errno = 0;
+            long stallTemp = strtol(token, NULL, 10) * 1000;
+            long windowTemp = strtol(window, NULL, 10) * 1000;
+            if (errno != 0 || stallTemp <= 0 || stallTemp > windowTemp ||
+                  windowTemp < PSI_MIN_WINDOW_USEC || windowTemp > PSI_MAX_WINDOW_USEC) {
+               printf("%s %s is not a valid trigger\n", token, window);
+               continue;
+            }
+            psiStallUsec = stallTemp;
+            psiWindowUsec = windowTemp;
+         } else if (strncmpSafe("vmstat", token, MAX_INPUT_LEN - 1) == 0 ||
+               strncmpSafe("meminfo", token, MAX_INPUT_LEN - 1) == 0) {
+            char *fields = (token[0] == 'v') ? vmstatFields : meminfoFields;
+            token = strtok(NULL, " ");
+            if (token == NULL) {
+               printf("ERROR: bad input\n");
+               continue;
+            }
+            // comma separated keys the next system thread logs, "none" for no extra keys
+            if (strncmpSafe("none", token, MAX_INPUT_LEN - 1) == 0) {
+               fields[0] = '\0';
+               continue;
+            }
+            KeyedStats check;
+            keyedStatsInit(&check);
+            int failed = keyedStatsAddList(&check, token);
+            keyedStatsDestroy(&check);
+            if (failed != 0) {
+               printf("%s is not a valid field list\n", token);
+               continue;
+            }
+            strncpy(fields, token, MAX_INPUT_LEN - 1);
+            fields[MAX_INPUT_LEN - 1] = '\0';
+         } else if (strncmpSafe("fields", token, MAX_INPUT_LEN - 1) == 0) {
+            token = strtok(NULL, " ");
+            if (token == NULL) {
+               printf("ERROR: bad input\n");
+               continue;
+            }
+            // stat/statm columns the next process monitors collect, "all" for every one
+            FieldPlan planTemp;
+            if (fieldPlanCompile(&planTemp, token) == -1) {
+               printf("%s is not a valid field list\n", token);
+               continue;
+            }
+            fieldPlan = planTemp;
          } else if (strncmpSafe("logfile", token, MAX_INPUT_LEN - 1) == 0) {
             token = strtok(NULL, " ");
             // set default log file
@@ -278,11 +455,22 @@ void commandThread() {
          } else {
             printf("ERROR: bad input\n");
          }
+      } else if (strncmpSafe("alert", token, MAX_INPUT_LEN - 1) == 0) {
+         // alert list | alert clear | alert <metric> <op> <value> [for|avg <duration>] [log|kill|exec <command>]
+         token = strtok(NULL, "");
+         if (strncmpSafe("list", token, MAX_INPUT_LEN - 1) == 0) {
+            alertList();
+         } else if (strncmpSafe("clear", token, MAX_INPUT_LEN - 1) == 0) {
+            alertClear();
+         } else if (token == NULL || alertAdd(token) == -1) {
+            printf("ERROR: bad input\n");
+         }
       } else if (strncmpSafe("kill", token, MAX_INPUT_LEN - 1) == 0) {
          token = strtok(NULL, " ");
          errno = 0;
          pid_t pid = strtol(token, NULL, 10);
-         if (errno != 0 || pid == 0) {
+         // negative ids are the system and cgroup monitors (and process groups)
+         if (errno != 0 || pid <= 0) {
             printf("%s is not a valid process id\n", token);
             continue;
          }
@@ -341,7 +529,23 @@ void commandThread() {
             continue;
          }
 
-         startWebmon(webInterval, refreshRate, token);
+         if (strncmpSafe("-l", token, MAX_INPUT_LEN - 1) == 0) {
+            // serve the page ourselves on a local port
+            if ((token = strtok(NULL, " ")) == NULL) {
+               printf("incorrect webmon parameters\n");
+               continue;
+            }
+            errno = 0;
+            int port = strtol(token, NULL, 10);
+            if (errno != 0 || port <= 0 || port > 65535) {
+               printf("%s is not a valid port\n", token);
+               continue;
+            }
+
+            startWebmon(webInterval, refreshRate, NULL, port);
+         } else {
+            startWebmon(webInterval, refreshRate, token, 0);
+         }
       } else {
          if (token != NULL) {
             printf("%s: command not found\n", token);
@@ -355,6 +559,13 @@ void commandThread() {
    DestroyLL(&completedList);
    destroyFileTable();
    destroyThreadTables();
+   destroyGovernor();
+   destroyScheduler();
+
+   // a running webmon thread may still be streaming events
+   if (webmonActive != WEBMON_THREAD_RUNNING) {
+      destroyEventLog();
+   }
 
    return;
 }
@@ -9,10 +9,21 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "samples.h"
+#include "fieldPlan.h"
+#include "scheduler.h"
+#include "alerts.h"
+#include "anomaly.h"
+#include "quantiles.h"
+#include "summary.h"
+#include "leakTrend.h"
+
 #define MAX_INPUT_LEN 256
 #define FILE_TABLE_SIZE 11
 #define THREAD_TABLE_SIZE 10
 #define SYSTEM_THREAD_ID -1
+#define CGROUP_THREAD_ID -2
+#define CGROUP_ROOT "/sys/fs/cgroup"
 #define EXIT_PROMPT "You still have threads actively monitoring. Do you really want to exit? (y/n)"
 
 #define SYSTEM_THREAD_RUNNING 1
@@ -42,9 +53,27 @@ typedef struct {
 
    char fileName[MAX_INPUT_LEN];
    unsigned long interval;
+   unsigned long minInterval;      // adaptive bounds of 'add ... -a', 0 if fixed
+   unsigned long maxInterval;
+   unsigned long effectiveInterval;  // what an adaptive monitor sleeps now
+   PriorityClass priority;         // 'add ... -r', orders ticks under overload
+   int uring;                      // read stat and statm through io_uring
    time_t startTime;
    time_t endTime;
    TerminationStatus endStatus;
+
+   char executable[MAX_EXE_LEN];
+   char cgroup[MAX_INPUT_LEN];     // directory of a cgroup monitor
+   unsigned int providers;         // extra process metrics (processProviders.h)
+   unsigned int slowProviders;     // the ones read every slowInterval
+   unsigned long slowInterval;
+   FieldPlan fields;               // stat and statm columns of a process monitor
+   SampleHistory *history;
+   AlertSet *alerts;               // 'alert' rules in force when it was added, NULL if none
+   AnomalySet *anomalies;          // baselines of 'add ... -d', NULL if none
+   LeakTrend *leak;                // rss or pss trend of 'add ... -w', NULL if off
+   QuantileSet quantiles;          // distributions of its key metrics, kept when it completes
+   MonitorSummary summary;         // lifetime totals, kept when it completes
 } ThreadTable;
 
 
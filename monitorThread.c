@@ -8,34 +8,78 @@
 #include <fcntl.h>
 #include <sys/wait.h>
 #include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #include "monitorThread.h"
 #include "mond.h"
 #include "logLibrary.h"
+#include "governor.h"
+#include "scheduler.h"
+#include "procBatch.h"
+#include "processProviders.h"
+#include "adaptiveInterval.h"
+#include "eventStream.h"
 #include "singlyLinkedList.h"
 
-int openProcessFiles(int pid, int *fdStatProc, int *fdStatm);
-void printProcessLogs(FILE *fLogFile, int pid, int fdStatProc, int fdStatm);
+int openProcessFiles(int pid, const FieldPlan *plan, int *fdStatProc, int *fdStatm);
+int sampleProcess(ThreadTable *line, ProcBatch *batch, ProcessProviders *providers, ProcessSample *sample);
+void chartProcess(SampleHistory *history, ProcessSample *sample);
+void printProcessLogs(FILE *fLogFile, int pid, const char *executable, const FieldPlan *plan,
+      ProcessSample *sample);
 void closeProcessFiles(int fdStatProc, int fdStatm);
 
 extern sem_t availableThreads;
 extern LinkedList *completedList;
+extern int alignTicks;
 
 
 void *monitorThread(void *args) {
    int fdStat = -1, fdStatm = -1;
+   int fds[2] = { -1, -1 };
+   ProcBatch batch;
    ThreadTable *threadTableLine = NULL;
    int value = -1;
    int stop = 0;
    pid_t childPid = -1;
    int status = -1;
+   pid_t reaped = 0;
+   struct rusage usage;
    int isChildFlag = -1;
    unsigned long sleepTime = -1;
+   long long cpuStart = 0;
+   long long dueUsec = 0;
+   PriorityClass priority = PRIORITY_NORMAL;
+   GovernorState governed = { 1.0, 0.0, 0.0 };
    struct timeval startTime, endTime;
    unsigned long offsetTime = -1;
+   int opened = 0;
+   ProcessSample sample;
+   ProcessProviders providers;
+   AdaptiveInterval adaptive;
+   unsigned long nextInterval = 0;
 
    ThreadTable *threadTableHandle = (ThreadTable *)args;
 
+   // set before the thread starts and never changed
+   priority = threadTableHandle->priority;
+   schedulerSlack(priority, threadTableHandle->interval);
+
+   // the row is set up before the thread starts and the pid never changes
+   providersInit(&providers, threadTableHandle->pid, threadTableHandle->providers,
+         threadTableHandle->slowProviders, threadTableHandle->slowInterval);
+   adaptiveInit(&adaptive, threadTableHandle->minInterval, threadTableHandle->maxInterval,
+         threadTableHandle->interval);
+   nextInterval = adaptive.interval;
+
+   // stat and statm stay open for the life of the monitor
+   opened = (openProcessFiles(threadTableHandle->pid, &(threadTableHandle->fields), &fdStat, &fdStatm) == 0) ? 1 : 0;
+   if (opened == 1) {
+      fds[0] = fdStat;
+      fds[1] = fdStatm;
+      procBatchInit(&batch, fds, (fdStatm != -1) ? 2 : 1, threadTableHandle->uring);
+   }
+
    if ((threadTableLine = (ThreadTable *)calloc(1, sizeof (ThreadTable))) == NULL) {
       perror("calloc failed");
       exit(-1);
@@ -47,6 +91,8 @@ void *monitorThread(void *args) {
          perror("gettimeofday failed");
          exit(-1);
       }
+      cpuStart = governorThreadCpu();
+      schedulerEnter(priority, dueUsec, sleepTime);
 
       /*
        *  What threads use this critical section:
@@ -114,8 +160,20 @@ void *monitorThread(void *args) {
       }
 
       // critical section
-      if (openProcessFiles(threadTableHandle->pid, &fdStat, &fdStatm) == 0) {
-         printProcessLogs(threadTableHandle->fTable->filep, threadTableHandle->pid, fdStat, fdStatm);
+      if (opened == 1 && sampleProcess(threadTableHandle, &batch, &providers, &sample) == 0) {
+         printProcessLogs(threadTableHandle->fTable->filep, threadTableHandle->pid,
+               threadTableHandle->executable, &(threadTableHandle->fields), &sample);
+         alertEvaluate(threadTableHandle->alerts, threadTableHandle->fTable->filep, threadTableHandle->pid, NULL,
+               threadTableHandle->history);
+         anomalyEvaluate(threadTableHandle->anomalies, threadTableHandle->fTable->filep, threadTableHandle->pid,
+               NULL, threadTableHandle->history);
+         quantileUpdate(&(threadTableHandle->quantiles), threadTableHandle->history);
+         summaryUpdate(&(threadTableHandle->summary), threadTableHandle->history, sleepTime);
+         leakUpdate(threadTableHandle->leak, threadTableHandle->fTable->filep, threadTableHandle->pid,
+               threadTableHandle->history);
+         if (governorChanged(&governed) != 0) {
+            governorPrint(threadTableHandle->fTable->filep, &governed);
+         }
          stop = 0;
       } else {
          if (threadTableHandle->endStatus == RUNNING) {
@@ -136,10 +194,15 @@ void *monitorThread(void *args) {
          exit(-1);
       }
 
-      if (stop == 0) {
-         closeProcessFiles(fdStat, fdStatm);
+      if (stop == 0 && adaptive.minInterval != 0) {
+         nextInterval = adaptiveUpdate(&adaptive, &sample);
       }
 
+      schedulerLeave();
+
+      // only this thread touches its alert state, kill needs the row unlocked
+      alertActions(threadTableHandle->alerts, threadTableHandle->pid);
+
       /*
        *  What threads use this critical section:
        *    Only the individual monitoring thread uses this critical section.
@@ -177,6 +240,15 @@ void *monitorThread(void *args) {
       // critical section
       if (threadTableHandle->endStatus != RUNNING) {
 
+         // a child that just ended is reaped here so its record gets the exit status
+         if (isChildFlag == 1 && reaped == 0 && (reaped = wait4(childPid, &status, WNOHANG, &usage)) == -1) {
+            perror("wait4 failed");
+            exit(-1);
+         }
+         if (reaped > 0) {
+            summaryReaped(&(threadTableHandle->summary), status, &usage);
+         }
+
          // copy table entry for linked list
          memcpy(threadTableLine, threadTableHandle, sizeof (ThreadTable));
 
@@ -215,6 +287,7 @@ void *monitorThread(void *args) {
          }
 
          // critical section
+         alertEnd(threadTableHandle->alerts, threadTableHandle->fTable->filep, threadTableHandle->pid, NULL);
          if (sem_wait(&(threadTableHandle->fTable->count)) == -1) {
             perror("sem_wait failed");
             exit(-1);
@@ -244,14 +317,33 @@ void *monitorThread(void *args) {
          threadTableHandle->pid = 0;
          threadTableHandle->fTable = NULL;
          threadTableHandle->interval = 0;
+         threadTableHandle->priority = PRIORITY_NORMAL;
+         threadTableHandle->minInterval = 0;
+         threadTableHandle->maxInterval = 0;
+         threadTableHandle->effectiveInterval = 0;
          threadTableHandle->startTime = 0;
          threadTableHandle->endTime = 0;
          threadTableHandle->endStatus = RUNNING;
+         threadTableHandle->executable[0] = '\0';
+         threadTableHandle->providers = 0;
+         threadTableHandle->slowProviders = 0;
+         threadTableHandle->slowInterval = 0;
+         historyDestroy(&(threadTableHandle->history));
+         threadTableLine->history = NULL;
+         alertSetDestroy(&(threadTableHandle->alerts));
+         threadTableLine->alerts = NULL;
+         anomalySetDestroy(&(threadTableHandle->anomalies));
+         threadTableLine->anomalies = NULL;
+         leakDestroy(&(threadTableHandle->leak));
+         threadTableLine->leak = NULL;
 
          stop = 1;
       }
 
-      sleepTime = threadTableHandle->interval;
+      if (adaptive.minInterval != 0) {
+         threadTableHandle->effectiveInterval = nextInterval;
+      }
+      sleepTime = (adaptive.minInterval != 0) ? nextInterval : threadTableHandle->interval;
 
       // unlock unlock outer
       if (pthread_mutex_unlock(&(threadTableHandle->mutex)) != 0) {
@@ -263,10 +355,13 @@ void *monitorThread(void *args) {
          break;
       }
 
-      if (isChildFlag == 1) {
-         // check for child cleanup
-         if (waitpid(childPid, &status, WNOHANG) == -1) {
-            perror("waitpid failed");
+      sleepTime = governorCharge(governorThreadCpu() - cpuStart, sleepTime, priority);
+      dueUsec = startTime.tv_sec * CONVERT_SEC_TO_USEC + startTime.tv_usec + sleepTime;
+
+      if (isChildFlag == 1 && reaped == 0) {
+         // check for child cleanup, keeping its status and usage for the summary
+         if ((reaped = wait4(childPid, &status, WNOHANG, &usage)) == -1) {
+            perror("wait4 failed");
             exit(-1);
          }
       }
@@ -280,7 +375,18 @@ void *monitorThread(void *args) {
          (startTime.tv_sec * CONVERT_SEC_TO_USEC + startTime.tv_usec);
 
       // wait interval time
-      longSleep(sleepTime - offsetTime);
+      if (alignTicks != 0) {
+         dueUsec = schedulerAlign(sleepTime);
+         longSleep(dueUsec - currentTimeUsec());
+      } else {
+         longSleep(sleepTime - offsetTime);
+      }
+   }
+
+   providersDestroy(&providers);
+   if (opened == 1) {
+      procBatchDestroy(&batch);
+      closeProcessFiles(fdStat, fdStatm);
    }
 
    threadTableLine->endTime = time(NULL);
@@ -328,14 +434,24 @@ void *monitorThread(void *args) {
       exit(-1);
    }
 
+   // the list owns the copy from here on and never changes it
+   eventCompleted(threadTableLine);
+   eventFiles();
+
    sem_post(&availableThreads);
 
    return NULL;
 }
 
-int openProcessFiles(int pid, int *fdStatProc, int *fdStatm) {
+/*
+ * Note: statm is only opened when the field plan wants one of its columns,
+ * *fdStatm is -1 otherwise
+ */
+int openProcessFiles(int pid, const FieldPlan *plan, int *fdStatProc, int *fdStatm) {
    char file[MAX_INPUT_LEN] = "";
 
+   *fdStatm = -1;
+
    if (snprintf(file, MAX_INPUT_LEN - 1, "/proc/%d/stat", pid) < 0) {
       perror("snprintf failed");
       exit(-1);
@@ -345,40 +461,148 @@ int openProcessFiles(int pid, int *fdStatProc, int *fdStatm) {
       return -1;
    }
 
+   if (fieldPlanUses(plan, SOURCE_STATM) == 0) {
+      return 0;
+   }
+
    if (snprintf(file, MAX_INPUT_LEN - 1, "/proc/%d/statm", pid) < 0) {
       perror("snprintf failed");
       exit(-1);
    }
 
    if ((*fdStatm = open(file, O_RDONLY)) == -1) {
+      close(*fdStatProc);
       return -1;
    }
 
    return 0;
 }
 
-void printProcessLogs(FILE *fLogFile, int pid, int fdStatProc, int fdStatm) {
+/*
+ * Parses one read of stat and statm (files 0 and 1 of the batch) into
+ * sample and records it in the monitor's history.  The caller holds the
+ * table row lock.
+ *
+ * Return: 0 on success, -1 if the process went away or is a zombie
+ */
+int sampleProcess(ThreadTable *line, ProcBatch *batch, ProcessProviders *providers, ProcessSample *sample) {
+   const char *buf = batch->files[0].buf;
+   const char *exeStart = NULL, *exeEnd = NULL, *state = NULL;
+   size_t exeLen = 0;
+
+   memset(sample, 0, sizeof (ProcessSample));
+   sample->timeUsec = currentTimeUsec();
+
+   procBatchRead(batch);
+
+   // stat: "pid (executable) state ..." and the executable may hold spaces
+   if (batch->files[0].result <= 0) {
+      return -1;
+   }
+
+   if ((exeStart = strchr(buf, '(')) == NULL || (exeEnd = strrchr(buf, ')')) == NULL) {
+      return -1;
+   }
+
+   exeLen = exeEnd - exeStart + 1;
+   if (exeLen > MAX_EXE_LEN - 1) {
+      exeLen = MAX_EXE_LEN - 1;
+   }
+   memcpy(line->executable, exeStart, exeLen);
+   line->executable[exeLen] = '\0';
+
+   // an exited child stays readable as a zombie until it is reaped, with
+   // rss 0 and frozen counters that no consumer should see
+   for (state = exeEnd + 1; *state == ' '; state++);
+   if (*state == 'Z') {
+      return -1;
+   }
+
+   sample->fields = line->fields.mask;
+   fieldPlanExtract(&(line->fields), SOURCE_STAT, exeEnd + 1, sample);
+
+   // statm: size resident shared text lib data dt
+   if (batch->count > 1) {
+      if (batch->files[1].result <= 0) {
+         return -1;
+      }
+      fieldPlanExtract(&(line->fields), SOURCE_STATM, batch->files[1].buf, sample);
+   }
+
+   providersSample(providers, sample);
+
+   if (line->history != NULL) {
+      Sample *slot = historyPush(line->history);
+      slot->proc = *sample;
+      chartProcess(line->history, sample);
+      eventSample(line, slot);
+   }
+
+   return 0;
+}
+
+/*
+ * Adds the rss (MB) and cpu use (percent of one cpu since the previous
+ * sample) of the newest sample to the monitor's chart.  rss comes from
+ * stat.rss or else statm.resident; a line whose columns the field plan
+ * does not collect stays out of the chart.
+ */
+void chartProcess(SampleHistory *history, ProcessSample *sample) {
+   ProcessSample *prev = NULL;
+   float values[CHART_MAX_LINES] = { 0 };
+   unsigned int cpu = FIELD_BIT(FIELD_UTIME) | FIELD_BIT(FIELD_STIME), lines = 0;
+   double elapsed = 0.0;
+
+   if (history->count < 2) {
+      return;
+   }
+
+   prev = &(historyGet(history, history->count - 2)->proc);
+   elapsed = (sample->timeUsec - prev->timeUsec) / 1000000.0;
+   if (elapsed <= 0.0) {
+      return;
+   }
+
+   if ((sample->fields & FIELD_BIT(FIELD_RSS)) != 0) {
+      values[0] = (float)((double)sample->rss * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+      lines |= CHART_LINE(0);
+   } else if ((sample->fields & FIELD_BIT(FIELD_RESIDENT)) != 0) {
+      values[0] = (float)((double)sample->residentSet * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0));
+      lines |= CHART_LINE(0);
+   }
+   if ((sample->fields & cpu) == cpu) {
+      values[1] = (float)(100.0 * ((sample->userTime + sample->kernelTime) - (prev->userTime + prev->kernelTime)) /
+            (sysconf(_SC_CLK_TCK) * elapsed));
+      lines |= CHART_LINE(1);
+   }
+   if (lines == 0) {
+      return;
+   }
+
+   // the field plan of a monitor never changes, neither do its lines
+   if (history->chart == NULL) {
+      history->chart = chartCreate();
+      history->chart->lines = lines;
+   }
+
+   chartPush(history->chart, sample->timeUsec, values);
+
+   return;
+}
+
+void printProcessLogs(FILE *fLogFile, int pid, const char *executable, const FieldPlan *plan,
+      ProcessSample *sample) {
    char timeStr[MAX_INPUT_LEN] = "";
 
    // log statistics
    fprintf(fLogFile, "[%s] Process(%d) ", generateLogTime(timeStr), pid);
-   printQuery(fLogFile, fdStatProc, " [STAT] executable", 0, 1);
-   printQuery(fLogFile, fdStatProc, " stat", 0, 2);
-   printQuery(fLogFile, fdStatProc, " minorfaults", 0, 9);
-   printQuery(fLogFile, fdStatProc, " majorfaults", 0, 11);
-   printQuery(fLogFile, fdStatProc, " usermodetime", 0, 13);
-   printQuery(fLogFile, fdStatProc, " kernelmodetime", 0, 14);
-   printQuery(fLogFile, fdStatProc, " priority", 0, 17);
-   printQuery(fLogFile, fdStatProc, " nice", 0, 18);
-   printQuery(fLogFile, fdStatProc, " nothreads", 0, 19);
-   printQuery(fLogFile, fdStatProc, " vsize", 0, 22);
-   printQuery(fLogFile, fdStatProc, " rss", 0, 23);
-   fprintf(fLogFile, " [STATM]");
-   printQuery(fLogFile, fdStatm, " program", 0, 0);
-   printQuery(fLogFile, fdStatm, " residentset", 0, 1);
-   printQuery(fLogFile, fdStatm, " share", 0, 2);
-   printQuery(fLogFile, fdStatm, " text", 0, 3);
-   printQuery(fLogFile, fdStatm, " data", 0, 5);
+   fprintf(fLogFile, " [STAT] executable %s", executable);
+   fieldPlanPrint(fLogFile, plan, SOURCE_STAT, sample);
+   if (fieldPlanUses(plan, SOURCE_STATM) != 0) {
+      fprintf(fLogFile, " [STATM]");
+      fieldPlanPrint(fLogFile, plan, SOURCE_STATM, sample);
+   }
+   providersPrint(fLogFile, sample);
    fprintf(fLogFile, "\n");
 
    return;
@@ -386,8 +610,9 @@ void printProcessLogs(FILE *fLogFile, int pid, int fdStatProc, int fdStatm) {
 
 void closeProcessFiles(int fdStatProc, int fdStatm) {
    close(fdStatProc);
-   close(fdStatm);
+   if (fdStatm != -1) {
+      close(fdStatm);
+   }
 
    return;
 }
-
@@ -0,0 +1,141 @@
+/*
+ * Hashed name index (FNV-1a, linear probing) shared by the samplers that
+ * track many named rows per tick
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nameIndex.h"
+
+unsigned int nameHash(const char *name, size_t len);
+NameSlot *nameIndexSlot(NameIndex *index, const char *name, size_t len, unsigned int hash);
+void nameIndexGrow(NameIndex *index);
+
+
+void nameIndexInit(NameIndex *index) {
+   int i = 0;
+
+   if ((index->slots = (NameSlot *)malloc(sizeof (NameSlot) * NAME_INDEX_INITIAL_SIZE)) == NULL) {
+      perror("malloc failed");
+      exit(-1);
+   }
+
+   index->size = NAME_INDEX_INITIAL_SIZE;
+   index->count = 0;
+   for (i = 0; i < index->size; i++) {
+      index->slots[i].value = -1;
+   }
+
+   return;
+}
+
+void nameIndexDestroy(NameIndex *index) {
+   free(index->slots);
+   index->slots = NULL;
+   index->size = 0;
+   index->count = 0;
+
+   return;
+}
+
+/*
+ * Return: the value stored for name or -1 if there is none
+ */
+int nameIndexGet(NameIndex *index, const char *name, size_t len) {
+   if (len >= NAME_INDEX_KEY_LEN) {
+      len = NAME_INDEX_KEY_LEN - 1;
+   }
+
+   return nameIndexSlot(index, name, len, nameHash(name, len))->value;
+}
+
+void nameIndexPut(NameIndex *index, const char *name, size_t len, int value) {
+   NameSlot *slot = NULL;
+   unsigned int hash = 0;
+
+   if (len >= NAME_INDEX_KEY_LEN) {
+      len = NAME_INDEX_KEY_LEN - 1;
+   }
+
+   // keep the load under one half so probes stay short
+   if ((index->count + 1) * 2 > index->size) {
+      nameIndexGrow(index);
+   }
+
+   hash = nameHash(name, len);
+   slot = nameIndexSlot(index, name, len, hash);
+   if (slot->value == -1) {
+      slot->hash = hash;
+      memcpy(slot->key, name, len);
+      slot->key[len] = '\0';
+      index->count++;
+   }
+   slot->value = value;
+
+   return;
+}
+
+unsigned int nameHash(const char *name, size_t len) {
+   unsigned int hash = 2166136261u;
+   size_t i = 0;
+
+   for (i = 0; i < len; i++) {
+      hash ^= (unsigned char)name[i];
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+/*
+ * Return: the slot holding name or the empty slot where it belongs
+ */
+NameSlot *nameIndexSlot(NameIndex *index, const char *name, size_t len, unsigned int hash) {
+   unsigned int mask = index->size - 1;
+   unsigned int i = hash & mask;
+   NameSlot *slot = NULL;
+
+   while (1) {
+      slot = &(index->slots[i]);
+      if (slot->value == -1) {
+         return slot;
+      }
+      if (slot->hash == hash && strncmp(slot->key, name, len) == 0 && slot->key[len] == '\0') {
+         return slot;
+      }
+      i = (i + 1) & mask;
+   }
+
+   return NULL;
+}
+
+void nameIndexGrow(NameIndex *index) {
+   NameSlot *old = index->slots;
+   int oldSize = index->size;
+   NameSlot *slot = NULL;
+   int i = 0;
+
+   if ((index->slots = (NameSlot *)malloc(sizeof (NameSlot) * oldSize * 2)) == NULL) {
+      perror("malloc failed");
+      exit(-1);
+   }
+
+   index->size = oldSize * 2;
+   for (i = 0; i < index->size; i++) {
+      index->slots[i].value = -1;
+   }
+
+   for (i = 0; i < oldSize; i++) {
+      if (old[i].value != -1) {
+         slot = nameIndexSlot(index, old[i].key, strlen(old[i].key), old[i].hash);
+         *slot = old[i];
+      }
+   }
+
+   free(old);
+
+   return;
+}
@@ -0,0 +1,30 @@
+#ifndef __NAME_INDEX_H_
+#define __NAME_INDEX_H_
+
+#include <stddef.h>
+
+#define NAME_INDEX_KEY_LEN 48
+#define NAME_INDEX_INITIAL_SIZE 64
+
+typedef struct {
+   unsigned int hash;
+   int value;                       // -1 when the slot is empty
+   char key[NAME_INDEX_KEY_LEN];
+} NameSlot;
+
+/*
+ * Open addressing hash from a short name (device, interface, ...) to an int,
+ * looked up straight from the unterminated name in a parse buffer
+ */
+typedef struct {
+   NameSlot *slots;
+   int size;                        // power of two
+   int count;
+} NameIndex;
+
+void nameIndexInit(NameIndex *index);
+void nameIndexDestroy(NameIndex *index);
+int nameIndexGet(NameIndex *index, const char *name, size_t len);
+void nameIndexPut(NameIndex *index, const char *name, size_t len, int value);
+
+#endif // __NAME_INDEX_H_
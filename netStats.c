@@ -0,0 +1,338 @@
+/*
+ * Per interface traffic rates from /proc/net/dev and protocol error
+ * counters from /proc/net/snmp
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "netStats.h"
+#include "logLibrary.h"
+
+#define NET_INITIAL_INTERFACES 16
+#define NET_COMPACT_MIN 64
+#define NET_PATH_LEN 128
+#define NET_HEADER_LINES 2
+
+NetInterface *netStatsInterface(NetStats *stats, const char *name, size_t len);
+void netStatsRates(NetInterface *iface, double elapsed);
+void netStatsCompact(NetStats *stats);
+int netIsPhysical(const char *name);
+unsigned long long snmpValue(const char *buf, const char *key, const char *field);
+
+
+void netStatsInit(NetStats *stats) {
+   memset(stats, 0, sizeof (NetStats));
+   nameIndexInit(&(stats->index));
+   bufferInit(&(stats->raw));
+
+   return;
+}
+
+void netStatsDestroy(NetStats *stats) {
+   nameIndexDestroy(&(stats->index));
+   bufferFree(&(stats->raw));
+   free(stats->interfaces);
+   stats->interfaces = NULL;
+   stats->count = 0;
+   stats->cap = 0;
+
+   return;
+}
+
+/*
+ * Reads every line of net/dev and updates the counters and the rates since
+ * the previous update of each interface
+ *
+ * Return: 0 on success, -1 if the file could not be read
+ */
+int netStatsUpdate(NetStats *stats, int fd, long long timeUsec) {
+   double elapsed = (stats->lastUsec != 0) ? (timeUsec - stats->lastUsec) / 1000000.0 : 0.0;
+   const char *cursor = NULL, *name = NULL;
+   NetInterface *iface = NULL;
+   size_t nameLen = 0;
+
+   if (readProcBuffer(fd, &(stats->raw)) <= 0) {
+      return -1;
+   }
+
+   stats->tick++;
+   stats->live = 0;
+
+   // name: rx bytes packets errs drop fifo frame compressed multicast tx bytes packets errs drop ...
+   cursor = findLine(stats->raw.data, NET_HEADER_LINES);
+   while (cursor != NULL && *cursor != '\0') {
+      while (*cursor == ' ' || *cursor == '\t') {
+         cursor++;
+      }
+      name = cursor;
+      while (*cursor != ':' && *cursor != '\n' && *cursor != '\0') {
+         cursor++;
+      }
+      nameLen = cursor - name;
+
+      if (*cursor == ':' && nameLen > 0) {
+         iface = netStatsInterface(stats, name, nameLen);
+
+         iface->prev = iface->now;
+         cursor++;
+         iface->now.rxBytes = parseUnsigned(&cursor);
+         iface->now.rxPackets = parseUnsigned(&cursor);
+         iface->now.rxErrors = parseUnsigned(&cursor);
+         iface->now.rxDrops = parseUnsigned(&cursor);
+         cursor = skipFields(cursor, 4);
+         iface->now.txBytes = parseUnsigned(&cursor);
+         iface->now.txPackets = parseUnsigned(&cursor);
+         iface->now.txErrors = parseUnsigned(&cursor);
+         iface->now.txDrops = parseUnsigned(&cursor);
+
+         // rates only when the interface was also there on the previous tick
+         if (iface->tick == stats->tick - 1 && elapsed > 0.0) {
+            netStatsRates(iface, elapsed);
+         } else {
+            iface->rxKBps = iface->txKBps = 0.0;
+            iface->rxPps = iface->txPps = 0.0;
+            iface->rxDropPs = iface->txDropPs = 0.0;
+            iface->rxErrorPs = iface->txErrorPs = 0.0;
+         }
+
+         iface->tick = stats->tick;
+         stats->live++;
+      }
+
+      if ((cursor = strchr(cursor, '\n')) == NULL) {
+         break;
+      }
+      cursor++;
+   }
+
+   stats->lastUsec = timeUsec;
+
+   if (stats->count > NET_COMPACT_MIN && stats->live * 2 < stats->count) {
+      netStatsCompact(stats);
+   }
+
+   return 0;
+}
+
+void netStatsRates(NetInterface *iface, double elapsed) {
+   iface->rxKBps = counterDelta(iface->now.rxBytes, iface->prev.rxBytes) / 1024.0 / elapsed;
+   iface->txKBps = counterDelta(iface->now.txBytes, iface->prev.txBytes) / 1024.0 / elapsed;
+   iface->rxPps = counterDelta(iface->now.rxPackets, iface->prev.rxPackets) / elapsed;
+   iface->txPps = counterDelta(iface->now.txPackets, iface->prev.txPackets) / elapsed;
+   iface->rxDropPs = counterDelta(iface->now.rxDrops, iface->prev.rxDrops) / elapsed;
+   iface->txDropPs = counterDelta(iface->now.txDrops, iface->prev.txDrops) / elapsed;
+   iface->rxErrorPs = counterDelta(iface->now.rxErrors, iface->prev.rxErrors) / elapsed;
+   iface->txErrorPs = counterDelta(iface->now.txErrors, iface->prev.txErrors) / elapsed;
+
+   return;
+}
+
+/*
+ * Reads the Tcp and Udp counters of net/snmp.  fd may be -1 when the file
+ * is not available, the snmp group is then left out of the log.
+ */
+void netStatsUpdateSnmp(NetStats *stats, int fd) {
+   unsigned long long outSegs = 0;
+
+   if (fd == -1 || readProcBuffer(fd, &(stats->raw)) <= 0) {
+      stats->snmpValid = 0;
+      return;
+   }
+
+   stats->snmpPrev = stats->snmp;
+   stats->snmp.tcpOutSegs = snmpValue(stats->raw.data, "Tcp", "OutSegs");
+   stats->snmp.tcpRetransSegs = snmpValue(stats->raw.data, "Tcp", "RetransSegs");
+   stats->snmp.tcpInErrs = snmpValue(stats->raw.data, "Tcp", "InErrs");
+   stats->snmp.udpInErrors = snmpValue(stats->raw.data, "Udp", "InErrors");
+   stats->snmp.udpRcvbufErrors = snmpValue(stats->raw.data, "Udp", "RcvbufErrors");
+
+   if (stats->snmpValid != 0) {
+      outSegs = counterDelta(stats->snmp.tcpOutSegs, stats->snmpPrev.tcpOutSegs);
+      stats->retransPct = (outSegs != 0) ?
+         counterDelta(stats->snmp.tcpRetransSegs, stats->snmpPrev.tcpRetransSegs) * 100.0 / outSegs : 0.0;
+   } else {
+      stats->retransPct = 0.0;
+   }
+
+   stats->snmpValid = 1;
+
+   return;
+}
+
+/*
+ * Sums the counters of the physical interfaces currently listed (traffic
+ * through veths and bridges also crosses a physical interface or stays on
+ * the host)
+ */
+void netStatsTotals(NetStats *stats, NetCounters *totals) {
+   NetInterface *iface = NULL;
+   int i = 0;
+
+   memset(totals, 0, sizeof (NetCounters));
+
+   for (i = 0; i < stats->count; i++) {
+      iface = &(stats->interfaces[i]);
+      if (iface->tick != stats->tick || iface->physical == 0) {
+         continue;
+      }
+
+      totals->rxBytes += iface->now.rxBytes;
+      totals->rxPackets += iface->now.rxPackets;
+      totals->rxErrors += iface->now.rxErrors;
+      totals->rxDrops += iface->now.rxDrops;
+      totals->txBytes += iface->now.txBytes;
+      totals->txPackets += iface->now.txPackets;
+      totals->txErrors += iface->now.txErrors;
+      totals->txDrops += iface->now.txDrops;
+   }
+
+   return;
+}
+
+void netStatsPrint(FILE *fLogFile, NetStats *stats, NetFilter filter) {
+   NetInterface *iface = NULL;
+   int i = 0;
+
+   for (i = 0; i < stats->count; i++) {
+      iface = &(stats->interfaces[i]);
+
+      if (iface->tick != stats->tick) {
+         continue;
+      }
+      if (filter == NET_FILTER_PHYSICAL && iface->physical == 0) {
+         continue;
+      }
+      if (filter == NET_FILTER_ACTIVE && iface->rxPps == 0.0 && iface->txPps == 0.0) {
+         continue;
+      }
+
+      fprintf(fLogFile, " [NETDEV(%s)] rxbytes %llu rxpackets %llu rxerrs %llu rxdrop %llu"
+            " txbytes %llu txpackets %llu txerrs %llu txdrop %llu"
+            " rxkbs %.1f txkbs %.1f rxpps %.1f txpps %.1f rxdropps %.1f txdropps %.1f"
+            " rxerrps %.1f txerrps %.1f",
+            iface->name, iface->now.rxBytes, iface->now.rxPackets, iface->now.rxErrors,
+            iface->now.rxDrops, iface->now.txBytes, iface->now.txPackets, iface->now.txErrors,
+            iface->now.txDrops, iface->rxKBps, iface->txKBps, iface->rxPps, iface->txPps,
+            iface->rxDropPs, iface->txDropPs, iface->rxErrorPs, iface->txErrorPs);
+   }
+
+   if (stats->snmpValid != 0) {
+      fprintf(fLogFile, " [SNMP] tcpoutsegs %llu tcpretranssegs %llu tcpinerrs %llu"
+            " udpinerrors %llu udprcvbuferrors %llu retranspct %.2f",
+            stats->snmp.tcpOutSegs, stats->snmp.tcpRetransSegs, stats->snmp.tcpInErrs,
+            stats->snmp.udpInErrors, stats->snmp.udpRcvbufErrors, stats->retransPct);
+   }
+
+   return;
+}
+
+/*
+ * Return: the row of the named interface, added on first sight
+ */
+NetInterface *netStatsInterface(NetStats *stats, const char *name, size_t len) {
+   NetInterface *iface = NULL;
+   int idx = nameIndexGet(&(stats->index), name, len);
+
+   if (idx != -1) {
+      return &(stats->interfaces[idx]);
+   }
+
+   if (stats->count == stats->cap) {
+      stats->cap = (stats->cap == 0) ? NET_INITIAL_INTERFACES : stats->cap * 2;
+      if ((stats->interfaces = (NetInterface *)realloc(stats->interfaces,
+            sizeof (NetInterface) * stats->cap)) == NULL) {
+         perror("realloc failed");
+         exit(-1);
+      }
+   }
+
+   if (len >= NET_NAME_LEN) {
+      len = NET_NAME_LEN - 1;
+   }
+
+   idx = stats->count++;
+   iface = &(stats->interfaces[idx]);
+   memset(iface, 0, sizeof (NetInterface));
+   memcpy(iface->name, name, len);
+   iface->name[len] = '\0';
+   iface->physical = netIsPhysical(iface->name);
+
+   nameIndexPut(&(stats->index), name, len, idx);
+
+   return iface;
+}
+
+/*
+ * Drops the rows of the interfaces the last update did not list and indexes
+ * the rest again
+ */
+void netStatsCompact(NetStats *stats) {
+   int i = 0, kept = 0;
+
+   nameIndexDestroy(&(stats->index));
+   nameIndexInit(&(stats->index));
+
+   for (i = 0; i < stats->count; i++) {
+      if (stats->interfaces[i].tick != stats->tick) {
+         continue;
+      }
+      if (kept != i) {
+         stats->interfaces[kept] = stats->interfaces[i];
+      }
+      nameIndexPut(&(stats->index), stats->interfaces[kept].name, strlen(stats->interfaces[kept].name), kept);
+      kept++;
+   }
+
+   stats->count = kept;
+
+   return;
+}
+
+/*
+ * Interfaces backed by hardware (or a paravirtual nic) have a "device" link
+ * in sysfs, checked once per interface
+ */
+int netIsPhysical(const char *name) {
+   char path[NET_PATH_LEN] = "";
+
+   snprintf(path, sizeof (path), "/sys/class/net/%s/device", name);
+
+   return (access(path, F_OK) == 0) ? 1 : 0;
+}
+
+/*
+ * net/snmp has a line of field names followed by a line of values for each
+ * protocol
+ *
+ * Return: the value of field on the key lines, 0 if missing
+ */
+unsigned long long snmpValue(const char *buf, const char *key, const char *field) {
+   const char *header = findLineByKey(buf, key);
+   const char *values = NULL, *cursor = NULL;
+   size_t fieldLen = strlen(field);
+   int col = 0;
+
+   if (header == NULL || (values = findLine(header, 1)) == NULL) {
+      return 0;
+   }
+
+   cursor = skipFields(header, 1);
+   while (*cursor != '\n' && *cursor != '\0') {
+      while (*cursor == ' ' || *cursor == '\t') {
+         cursor++;
+      }
+      col++;
+      if (strncmp(cursor, field, fieldLen) == 0 &&
+            (cursor[fieldLen] == ' ' || cursor[fieldLen] == '\n' || cursor[fieldLen] == '\0')) {
+         cursor = skipFields(values, col);
+         return (unsigned long long)parseSigned(&cursor);
+      }
+      cursor = skipFields(cursor, 1);
+   }
+
+   return 0;
+}
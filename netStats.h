@@ -0,0 +1,83 @@
+#ifndef __NET_STATS_H_
+#define __NET_STATS_H_
+
+#include <stdio.h>
+
+#include "buffer.h"
+#include "nameIndex.h"
+
+#define NET_NAME_LEN 32
+
+typedef enum {
+   NET_FILTER_ALL = 0,        // every interface
+   NET_FILTER_PHYSICAL = 1,   // interfaces backed by a device (no lo, veth, bridge, ...)
+   NET_FILTER_ACTIVE = 2      // interfaces that moved packets since the last tick
+} NetFilter;
+
+typedef struct {
+   unsigned long long rxBytes;
+   unsigned long long rxPackets;
+   unsigned long long rxErrors;
+   unsigned long long rxDrops;
+   unsigned long long txBytes;
+   unsigned long long txPackets;
+   unsigned long long txErrors;
+   unsigned long long txDrops;
+} NetCounters;
+
+typedef struct {
+   char name[NET_NAME_LEN];
+   int physical;
+   unsigned long tick;        // last update that listed the interface
+   NetCounters now;
+   NetCounters prev;
+   double rxKBps;
+   double txKBps;
+   double rxPps;
+   double txPps;
+   double rxDropPs;
+   double txDropPs;
+   double rxErrorPs;
+   double txErrorPs;
+} NetInterface;
+
+/*
+ * Protocol counters of /proc/net/snmp
+ */
+typedef struct {
+   unsigned long long tcpOutSegs;
+   unsigned long long tcpRetransSegs;
+   unsigned long long tcpInErrs;
+   unsigned long long udpInErrors;
+   unsigned long long udpRcvbufErrors;
+} NetSnmp;
+
+/*
+ * Every interface of /proc/net/dev, found by name through a hash so a tick
+ * is one pass over the file however many interfaces there are.  Interfaces
+ * that disappear keep their row until they outnumber the live ones, then
+ * the rows are compacted (containers come and go with their veths).
+ */
+typedef struct {
+   NameIndex index;
+   NetInterface *interfaces;
+   int count;
+   int cap;
+   int live;                  // rows listed by the last update
+   unsigned long tick;
+   long long lastUsec;
+   Buffer raw;
+   int snmpValid;
+   NetSnmp snmp;
+   NetSnmp snmpPrev;
+   double retransPct;         // retransmitted share of the tcp segments sent
+} NetStats;
+
+void netStatsInit(NetStats *stats);
+void netStatsDestroy(NetStats *stats);
+int netStatsUpdate(NetStats *stats, int fd, long long timeUsec);
+void netStatsUpdateSnmp(NetStats *stats, int fd);
+void netStatsTotals(NetStats *stats, NetCounters *totals);
+void netStatsPrint(FILE *fLogFile, NetStats *stats, NetFilter filter);
+
+#endif // __NET_STATS_H_
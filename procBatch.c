@@ -0,0 +1,230 @@
+/*
+ * Reads the /proc files of one monitor per tick, through io_uring or pread
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+
+#include "procBatch.h"
+
+int procBatchSetup(ProcBatch *batch, struct io_uring_params *params);
+void procBatchTeardown(ProcBatch *batch);
+void procBatchSubmit(ProcBatch *batch);
+
+
+/*
+ * Return: 1 if the kernel hands out io_uring instances, 0 otherwise
+ */
+int procBatchAvailable() {
+   struct io_uring_params params;
+   int fd = -1;
+
+   memset(&params, 0, sizeof (params));
+   if ((fd = syscall(__NR_io_uring_setup, 1, &params)) == -1) {
+      return 0;
+   }
+   close(fd);
+
+   return 1;
+}
+
+/*
+ * Takes over fds (the caller still closes them after procBatchDestroy).
+ * A ring that cannot be set up, or whose files or buffers cannot be
+ * registered, quietly leaves the batch on pread.
+ */
+void procBatchInit(ProcBatch *batch, const int *fds, int count, int useUring) {
+   struct io_uring_params params;
+   struct iovec iov[PROC_BATCH_MAX_FILES];
+   int i = 0;
+
+   memset(batch, 0, sizeof (ProcBatch));
+   batch->ringFd = -1;
+   batch->count = (count > PROC_BATCH_MAX_FILES) ? PROC_BATCH_MAX_FILES : count;
+
+   for (i = 0; i < batch->count; i++) {
+      batch->files[i].fd = fds[i];
+      batch->files[i].result = -1;
+      iov[i].iov_base = batch->files[i].buf;
+      iov[i].iov_len = PROC_READ_LEN;
+   }
+
+   if (useUring == 0 || batch->count == 0) {
+      return;
+   }
+
+   memset(&params, 0, sizeof (params));
+   if ((batch->ringFd = syscall(__NR_io_uring_setup, PROC_BATCH_MAX_FILES, &params)) == -1) {
+      return;
+   }
+
+   if (procBatchSetup(batch, &params) == -1 ||
+         syscall(__NR_io_uring_register, batch->ringFd, IORING_REGISTER_FILES, fds, batch->count) == -1 ||
+         syscall(__NR_io_uring_register, batch->ringFd, IORING_REGISTER_BUFFERS, iov, batch->count) == -1) {
+      procBatchTeardown(batch);
+   }
+
+   return;
+}
+
+/*
+ * Reads every file from the start into its buffer
+ */
+void procBatchRead(ProcBatch *batch) {
+   int i = 0;
+
+   if (batch->ringFd != -1) {
+      procBatchSubmit(batch);
+      return;
+   }
+
+   for (i = 0; i < batch->count; i++) {
+      batch->files[i].result = readProcFile(batch->files[i].fd, batch->files[i].buf, PROC_READ_LEN);
+   }
+
+   return;
+}
+
+void procBatchDestroy(ProcBatch *batch) {
+   if (batch->ringFd != -1) {
+      procBatchTeardown(batch);
+   }
+   batch->count = 0;
+
+   return;
+}
+
+/*
+ * Maps the rings of a fresh io_uring instance
+ *
+ * Return: 0 on success, -1 otherwise
+ */
+int procBatchSetup(ProcBatch *batch, struct io_uring_params *params) {
+   char *sq = NULL, *cq = NULL;
+
+   batch->sqRingSize = params->sq_off.array + params->sq_entries * sizeof (unsigned int);
+   batch->cqRingSize = params->cq_off.cqes + params->cq_entries * sizeof (struct io_uring_cqe);
+   if ((params->features & IORING_FEAT_SINGLE_MMAP) != 0) {
+      if (batch->cqRingSize > batch->sqRingSize) {
+         batch->sqRingSize = batch->cqRingSize;
+      }
+      batch->cqRingSize = 0;
+   }
+
+   if ((batch->sqRing = mmap(NULL, batch->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               batch->ringFd, IORING_OFF_SQ_RING)) == MAP_FAILED) {
+      batch->sqRing = NULL;
+      return -1;
+   }
+
+   if (batch->cqRingSize == 0) {
+      batch->cqRing = batch->sqRing;
+   } else if ((batch->cqRing = mmap(NULL, batch->cqRingSize, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, batch->ringFd, IORING_OFF_CQ_RING)) == MAP_FAILED) {
+      batch->cqRing = NULL;
+      return -1;
+   }
+
+   batch->sqesSize = params->sq_entries * sizeof (struct io_uring_sqe);
+   if ((batch->sqes = mmap(NULL, batch->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+               batch->ringFd, IORING_OFF_SQES)) == MAP_FAILED) {
+      batch->sqes = NULL;
+      return -1;
+   }
+
+   sq = (char *)batch->sqRing;
+   cq = (char *)batch->cqRing;
+   batch->sqTail = (unsigned int *)(sq + params->sq_off.tail);
+   batch->sqMask = (unsigned int *)(sq + params->sq_off.ring_mask);
+   batch->sqArray = (unsigned int *)(sq + params->sq_off.array);
+   batch->cqHead = (unsigned int *)(cq + params->cq_off.head);
+   batch->cqTail = (unsigned int *)(cq + params->cq_off.tail);
+   batch->cqMask = (unsigned int *)(cq + params->cq_off.ring_mask);
+   batch->cqes = (struct io_uring_cqe *)(cq + params->cq_off.cqes);
+
+   return 0;
+}
+
+/*
+ * Unmaps and closes the ring, the batch falls back to pread
+ */
+void procBatchTeardown(ProcBatch *batch) {
+   if (batch->sqes != NULL) {
+      munmap(batch->sqes, batch->sqesSize);
+   }
+   if (batch->cqRing != NULL && batch->cqRing != batch->sqRing) {
+      munmap(batch->cqRing, batch->cqRingSize);
+   }
+   if (batch->sqRing != NULL) {
+      munmap(batch->sqRing, batch->sqRingSize);
+   }
+   close(batch->ringFd);
+
+   batch->ringFd = -1;
+   batch->sqRing = NULL;
+   batch->cqRing = NULL;
+   batch->sqes = NULL;
+
+   return;
+}
+
+/*
+ * Queues one fixed read per registered file, submits them with a single
+ * io_uring_enter and reaps every completion
+ */
+void procBatchSubmit(ProcBatch *batch) {
+   struct io_uring_sqe *sqe = NULL;
+   struct io_uring_cqe *cqe = NULL;
+   unsigned int tail = *(batch->sqTail), head = 0, index = 0;
+   int i = 0, reaped = 0, submit = batch->count;
+   ProcBatchFile *file = NULL;
+
+   for (i = 0; i < batch->count; i++) {
+      index = tail & *(batch->sqMask);
+      sqe = &(batch->sqes[index]);
+      memset(sqe, 0, sizeof (struct io_uring_sqe));
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->flags = IOSQE_FIXED_FILE;
+      sqe->fd = i;                                  // index of the registered file
+      sqe->addr = (unsigned long)batch->files[i].buf;
+      sqe->len = PROC_READ_LEN - 1;
+      sqe->off = 0;
+      sqe->buf_index = i;
+      sqe->user_data = i;
+      batch->sqArray[index] = index;
+      tail++;
+   }
+   __atomic_store_n(batch->sqTail, tail, __ATOMIC_RELEASE);
+
+   while (reaped < batch->count) {
+      if (syscall(__NR_io_uring_enter, batch->ringFd, submit, batch->count - reaped,
+               IORING_ENTER_GETEVENTS, NULL, 0) == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         perror("io_uring_enter failed");
+         exit(-1);
+      }
+      submit = 0;
+
+      head = *(batch->cqHead);
+      while (head != __atomic_load_n(batch->cqTail, __ATOMIC_ACQUIRE)) {
+         cqe = &(batch->cqes[head & *(batch->cqMask)]);
+         file = &(batch->files[cqe->user_data]);
+         file->result = (cqe->res < 0) ? -1 : cqe->res;
+         file->buf[(cqe->res < 0) ? 0 : cqe->res] = '\0';
+         head++;
+         reaped++;
+      }
+      __atomic_store_n(batch->cqHead, head, __ATOMIC_RELEASE);
+   }
+
+   return;
+}
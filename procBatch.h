@@ -0,0 +1,49 @@
+#ifndef __PROC_BATCH_H_
+#define __PROC_BATCH_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <linux/io_uring.h>
+
+#include "logLibrary.h"
+
+#define PROC_BATCH_MAX_FILES 8
+
+typedef struct {
+   int fd;
+   ssize_t result;            // bytes of the last read, -1 if it failed
+   char buf[PROC_READ_LEN];   // NUL terminated
+} ProcBatchFile;
+
+/*
+ * The files a monitor reads every tick, kept open for its life and read
+ * together.  With io_uring ('set uring on') the files and buffers are
+ * registered once and a tick is one io_uring_enter for all of them;
+ * otherwise, or when the kernel refuses a ring, each is a plain pread.
+ */
+typedef struct {
+   int ringFd;                // -1: pread
+   int count;
+   ProcBatchFile files[PROC_BATCH_MAX_FILES];
+
+   void *sqRing;
+   void *cqRing;
+   size_t sqRingSize;
+   size_t cqRingSize;
+   struct io_uring_sqe *sqes;
+   size_t sqesSize;
+   unsigned int *sqTail;
+   unsigned int *sqMask;
+   unsigned int *sqArray;
+   unsigned int *cqHead;
+   unsigned int *cqTail;
+   unsigned int *cqMask;
+   struct io_uring_cqe *cqes;
+} ProcBatch;
+
+int procBatchAvailable();
+void procBatchInit(ProcBatch *batch, const int *fds, int count, int useUring);
+void procBatchRead(ProcBatch *batch);
+void procBatchDestroy(ProcBatch *batch);
+
+#endif // __PROC_BATCH_H_
@@ -0,0 +1,345 @@
+/*
+ * Optional per process metrics, chosen per monitor with 'add ... -m'
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mond.h"
+#include "processProviders.h"
+#include "logLibrary.h"
+
+#define PROVIDER_MAX_KEYS 8
+
+typedef struct {
+   const char *name;                  // as listed after -m
+   const char *file;                  // under /proc/<pid>
+   int slow;                          // default tier, set for the costly ones
+   size_t first;                      // ProcessSample fields of the provider,
+   size_t size;                       // carried forward as one block
+   const char *keys;                  // fields of a "key: value" file, NULL otherwise
+   size_t fields[PROVIDER_MAX_KEYS];  // ProcessSample field of each key
+   int (*open)(ProviderState *state, const char *path);
+   int (*read)(ProcessProviders *providers, ProviderState *state, ProcessSample *sample);
+   void (*close)(ProviderState *state);
+} ProviderOps;
+
+int providerOpenFile(ProviderState *state, const char *path);
+int providerOpenDir(ProviderState *state, const char *path);
+int providerReadKeyed(ProcessProviders *providers, ProviderState *state, ProcessSample *sample);
+int providerReadSched(ProcessProviders *providers, ProviderState *state, ProcessSample *sample);
+int providerReadFds(ProcessProviders *providers, ProviderState *state, ProcessSample *sample);
+void providerCloseFile(ProviderState *state);
+void providerCloseDir(ProviderState *state);
+
+#define FIELD(name) offsetof(ProcessSample, name)
+#define FIELDS(first, last) FIELD(first), FIELD(last) + sizeof (unsigned long long) - FIELD(first)
+
+/*
+ * smaps_rollup walks every mapping under the mmap lock of the target and
+ * the fd directory lists every descriptor, so both are slow by default
+ */
+static const ProviderOps providerOps[PROVIDERS] = {
+   { "io", "io", 0, FIELDS(readChars, cancelledWriteBytes), "rchar,wchar,syscr,syscw,read_bytes,write_bytes,cancelled_write_bytes",
+      { FIELD(readChars), FIELD(writeChars), FIELD(readCalls), FIELD(writeCalls),
+         FIELD(readBytes), FIELD(writeBytes), FIELD(cancelledWriteBytes) },
+      providerOpenFile, providerReadKeyed, providerCloseFile },
+   { "status", "status", 0, FIELDS(voluntaryCtxt, involuntaryCtxt), "voluntary_ctxt_switches,nonvoluntary_ctxt_switches",
+      { FIELD(voluntaryCtxt), FIELD(involuntaryCtxt) },
+      providerOpenFile, providerReadKeyed, providerCloseFile },
+   { "sched", "schedstat", 0, FIELDS(runNsec, timeslices), NULL, { 0 },
+      providerOpenFile, providerReadSched, providerCloseFile },
+   { "smaps", "smaps_rollup", 1, FIELDS(pss, swapPss), "Pss,Pss_Anon,Pss_File,Pss_Shmem,Swap,SwapPss",
+      { FIELD(pss), FIELD(pssAnon), FIELD(pssFile), FIELD(pssShmem), FIELD(swap), FIELD(swapPss) },
+      providerOpenFile, providerReadKeyed, providerCloseFile },
+   { "fd", "fd", 1, FIELDS(openFds, openFds), NULL, { 0 },
+      providerOpenDir, providerReadFds, providerCloseDir },
+};
+
+
+/*
+ * Turns "io,sched,smaps:fast,..." (or "all") into a provider mask and the
+ * mask of those in the slow tier.  A ":fast" or ":slow" suffix overrides
+ * the default tier of the provider.
+ *
+ * Return: 0 on success, -1 if a name or tier is unknown
+ */
+int providersParse(const char *list, unsigned int *mask, unsigned int *slowMask) {
+   const char *start = list, *end = NULL, *tier = NULL;
+   size_t len = 0;
+   int i = 0, id = -1;
+
+   *mask = 0;
+   *slowMask = 0;
+
+   if (strcmp(list, "all") == 0) {
+      *mask = PROVIDER_ALL;
+      for (i = 0; i < PROVIDERS; i++) {
+         *slowMask |= (providerOps[i].slow != 0) ? PROVIDER_BIT(i) : 0;
+      }
+      return 0;
+   }
+
+   while (*start != '\0') {
+      if ((end = strchr(start, ',')) == NULL) {
+         end = start + strlen(start);
+      }
+      if ((tier = memchr(start, ':', end - start)) == NULL) {
+         tier = end;
+      }
+      len = tier - start;
+
+      for (i = 0, id = -1; i < PROVIDERS; i++) {
+         if (strlen(providerOps[i].name) == len && strncmp(providerOps[i].name, start, len) == 0) {
+            id = i;
+         }
+      }
+
+      if (id == -1) {
+         if (len > 0) {
+            return -1;
+         }
+      } else if (tier == end) {
+         *mask |= PROVIDER_BIT(id);
+         *slowMask |= (providerOps[id].slow != 0) ? PROVIDER_BIT(id) : 0;
+      } else if (end - tier == 5 && strncmp(tier, ":fast", 5) == 0) {
+         *mask |= PROVIDER_BIT(id);
+         *slowMask &= ~PROVIDER_BIT(id);
+      } else if (end - tier == 5 && strncmp(tier, ":slow", 5) == 0) {
+         *mask |= PROVIDER_BIT(id);
+         *slowMask |= PROVIDER_BIT(id);
+      } else {
+         return -1;
+      }
+
+      start = (*end == ',') ? end + 1 : end;
+   }
+
+   return 0;
+}
+
+void providersInit(ProcessProviders *providers, pid_t pid, unsigned int mask, unsigned int slowMask,
+      unsigned long slowInterval) {
+   ProviderState *state = NULL;
+   int i = 0;
+
+   memset(providers, 0, sizeof (ProcessProviders));
+   providers->pid = pid;
+   providers->mask = mask & PROVIDER_ALL;
+   providers->slowMask = slowMask & providers->mask;
+   providers->slowInterval = slowInterval;
+   bufferInit(&(providers->raw));
+
+   for (i = 0; i < PROVIDERS; i++) {
+      state = &(providers->state[i]);
+      state->fd = -1;
+
+      if ((providers->mask & PROVIDER_BIT(i)) != 0 && providerOps[i].keys != NULL) {
+         keyedStatsInit(&(state->keyed));
+         keyedStatsAddList(&(state->keyed), providerOps[i].keys);
+         keyedStatsBuild(&(state->keyed));
+      }
+   }
+
+   return;
+}
+
+void providersDestroy(ProcessProviders *providers) {
+   int i = 0;
+
+   for (i = 0; i < PROVIDERS; i++) {
+      if ((providers->mask & PROVIDER_BIT(i)) == 0) {
+         continue;
+      }
+
+      providerOps[i].close(&(providers->state[i]));
+      if (providerOps[i].keys != NULL) {
+         keyedStatsDestroy(&(providers->state[i].keyed));
+      }
+   }
+
+   bufferFree(&(providers->raw));
+   providers->mask = 0;
+
+   return;
+}
+
+/*
+ * Reads every chosen provider that is due into the sample and sets its bit
+ * in sample->providers when it could be read.  A slow provider that is not
+ * due yet has its last values copied in and its bit set in sample->carried
+ * too.
+ */
+void providersSample(ProcessProviders *providers, ProcessSample *sample) {
+   char path[MAX_INPUT_LEN] = "";
+   ProviderState *state = NULL;
+   const ProviderOps *ops = NULL;
+   int i = 0;
+
+   for (i = 0; i < PROVIDERS; i++) {
+      state = &(providers->state[i]);
+      ops = &(providerOps[i]);
+      if ((providers->mask & PROVIDER_BIT(i)) == 0 || state->failed != 0) {
+         continue;
+      }
+
+      if ((providers->slowMask & PROVIDER_BIT(i)) != 0) {
+         if (sample->timeUsec < state->nextUsec) {
+            if ((providers->last.providers & PROVIDER_BIT(i)) != 0) {
+               memcpy((char *)sample + ops->first, (char *)&(providers->last) + ops->first, ops->size);
+               sample->providers |= PROVIDER_BIT(i);
+               sample->carried |= PROVIDER_BIT(i);
+            }
+            continue;
+         }
+
+         // keep the slow reads on their own grid unless a tick ran late
+         state->nextUsec += providers->slowInterval;
+         if (state->nextUsec <= sample->timeUsec) {
+            state->nextUsec = sample->timeUsec + providers->slowInterval;
+         }
+      }
+
+      snprintf(path, sizeof (path), "/proc/%d/%s", (int)providers->pid, ops->file);
+      if (state->fd == -1 && state->dir == NULL && ops->open(state, path) == -1) {
+         state->failed = 1;
+         continue;
+      }
+
+      // files bound to the address space (io, smaps_rollup) stop reading
+      // once the process execs, they are opened again for the new image
+      if (ops->read(providers, state, sample) != 0) {
+         ops->close(state);
+         if (ops->open(state, path) == -1 || ops->read(providers, state, sample) != 0) {
+            continue;
+         }
+      }
+
+      sample->providers |= PROVIDER_BIT(i);
+      memcpy((char *)&(providers->last) + ops->first, (char *)sample + ops->first, ops->size);
+      providers->last.providers |= PROVIDER_BIT(i);
+   }
+
+   return;
+}
+
+void providersPrint(FILE *fLogFile, ProcessSample *sample) {
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_IO)) != 0) {
+      fprintf(fLogFile, " [IO] rchar %llu wchar %llu syscr %llu syscw %llu readbytes %llu"
+            " writebytes %llu cancelledwritebytes %llu",
+            sample->readChars, sample->writeChars, sample->readCalls, sample->writeCalls,
+            sample->readBytes, sample->writeBytes, sample->cancelledWriteBytes);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_STATUS)) != 0) {
+      fprintf(fLogFile, " [CTXT] voluntary %llu involuntary %llu",
+            sample->voluntaryCtxt, sample->involuntaryCtxt);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_SCHED)) != 0) {
+      fprintf(fLogFile, " [SCHED] runns %llu waitns %llu timeslices %llu",
+            sample->runNsec, sample->waitNsec, sample->timeslices);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_SMAPS)) != 0) {
+      fprintf(fLogFile, " [SMAPS] pss %llu pssanon %llu pssfile %llu pssshmem %llu swap %llu swappss %llu",
+            sample->pss, sample->pssAnon, sample->pssFile, sample->pssShmem, sample->swap,
+            sample->swapPss);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_FDS)) != 0) {
+      fprintf(fLogFile, " [FDS] open %llu", sample->openFds);
+   }
+
+   return;
+}
+
+const char *providerName(ProviderId id) {
+   return providerOps[id].name;
+}
+
+int providerOpenFile(ProviderState *state, const char *path) {
+   state->fd = open(path, O_RDONLY);
+
+   return (state->fd == -1) ? -1 : 0;
+}
+
+int providerOpenDir(ProviderState *state, const char *path) {
+   state->dir = opendir(path);
+
+   return (state->dir == NULL) ? -1 : 0;
+}
+
+/*
+ * Note: the keys of the provider are added in the order of its fields, so
+ * field i of the keyed stats is ops->fields[i]
+ */
+int providerReadKeyed(ProcessProviders *providers, ProviderState *state, ProcessSample *sample) {
+   const ProviderOps *ops = &(providerOps[state - providers->state]);
+   int i = 0;
+
+   if (keyedStatsUpdate(&(state->keyed), state->fd, sample->timeUsec) != 0) {
+      return -1;
+   }
+
+   for (i = 0; i < state->keyed.count; i++) {
+      *(unsigned long long *)((char *)sample + ops->fields[i]) = state->keyed.fields[i].value;
+   }
+
+   return 0;
+}
+
+/*
+ * Note: schedstat is "run ns, run queue wait ns, timeslices"
+ */
+int providerReadSched(ProcessProviders *providers, ProviderState *state, ProcessSample *sample) {
+   const char *cursor = NULL;
+
+   if (readProcBuffer(state->fd, &(providers->raw)) <= 0) {
+      return -1;
+   }
+
+   cursor = providers->raw.data;
+   sample->runNsec = parseUnsigned(&cursor);
+   sample->waitNsec = parseUnsigned(&cursor);
+   sample->timeslices = parseUnsigned(&cursor);
+
+   return 0;
+}
+
+int providerReadFds(ProcessProviders *providers, ProviderState *state, ProcessSample *sample) {
+   struct dirent *entry = NULL;
+   unsigned long long count = 0;
+
+   // rewinding makes the next read list the directory again
+   rewinddir(state->dir);
+
+   while ((entry = readdir(state->dir)) != NULL) {
+      if (entry->d_name[0] != '.') {
+         count++;
+      }
+   }
+
+   sample->openFds = count;
+
+   return 0;
+}
+
+void providerCloseFile(ProviderState *state) {
+   if (state->fd != -1) {
+      close(state->fd);
+      state->fd = -1;
+   }
+
+   return;
+}
+
+void providerCloseDir(ProviderState *state) {
+   if (state->dir != NULL) {
+      closedir(state->dir);
+      state->dir = NULL;
+   }
+
+   return;
+}
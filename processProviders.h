@@ -0,0 +1,63 @@
+#ifndef __PROCESS_PROVIDERS_H_
+#define __PROCESS_PROVIDERS_H_
+
+#include <stdio.h>
+#include <dirent.h>
+#include <sys/types.h>
+
+#include "buffer.h"
+#include "keyedStats.h"
+#include "samples.h"
+
+typedef enum {
+   PROVIDER_IO = 0,
+   PROVIDER_STATUS = 1,
+   PROVIDER_SCHED = 2,
+   PROVIDER_SMAPS = 3,
+   PROVIDER_FDS = 4,
+   PROVIDERS = 5
+} ProviderId;
+
+#define PROVIDER_BIT(id) (1u << (id))
+#define PROVIDER_ALL (PROVIDER_BIT(PROVIDERS) - 1)
+#define PROVIDER_SLOW_INTERVAL 30000000    // usec, default of add -t
+
+/*
+ * What one provider keeps between ticks.  The file (or directory) is opened
+ * on the first tick and stays open for the life of the monitor; a provider
+ * the kernel refuses (no permission, no such file on this kernel) is marked
+ * failed and never tried again.
+ */
+typedef struct {
+   int fd;
+   DIR *dir;
+   int failed;
+   long long nextUsec;        // slow tier: when it is read again
+   KeyedStats keyed;
+} ProviderState;
+
+/*
+ * The providers chosen for one process monitor with 'add ... -m'.  Only
+ * the chosen ones hold any state.  Providers in the slow tier are read
+ * every slowInterval instead of every tick; in between, the values they
+ * read last are carried into each sample.
+ */
+typedef struct {
+   pid_t pid;
+   unsigned int mask;
+   unsigned int slowMask;
+   unsigned long slowInterval;
+   ProviderState state[PROVIDERS];
+   ProcessSample last;        // the values each provider read last
+   Buffer raw;
+} ProcessProviders;
+
+int providersParse(const char *list, unsigned int *mask, unsigned int *slowMask);
+void providersInit(ProcessProviders *providers, pid_t pid, unsigned int mask, unsigned int slowMask,
+      unsigned long slowInterval);
+void providersDestroy(ProcessProviders *providers);
+void providersSample(ProcessProviders *providers, ProcessSample *sample);
+void providersPrint(FILE *fLogFile, ProcessSample *sample);
+const char *providerName(ProviderId id);
+
+#endif // __PROCESS_PROVIDERS_H_
@@ -0,0 +1,428 @@
+/*
+ * Prometheus text format exposition of the monitors
+ *
+ * The page is kept between scrapes.  Every series of every monitor has its
+ * own cached line; on a scrape only monitors with new samples are looked at,
+ * only series whose value changed are formatted again, and the page is only
+ * reassembled (by copying lines) if anything changed at all.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "mond.h"
+#include "promExport.h"
+#include "samples.h"
+#include "processProviders.h"
+
+typedef enum {
+   PROM_PROCESS = 0,
+   PROM_SYSTEM = 1,
+   PROM_CGROUP = 2,
+} PromSource;
+
+typedef enum {
+   PROM_ULL = 0,
+   PROM_LL = 1,
+   PROM_DOUBLE = 2,
+} PromFieldType;
+
+typedef enum {
+   PROM_SCALE_NONE = 0,
+   PROM_SCALE_PAGES = 1,
+   PROM_SCALE_TICKS = 2,
+   PROM_SCALE_KB = 3,
+   PROM_SCALE_USEC = 4,
+   PROM_SCALE_NSEC = 5,
+} PromScale;
+
+typedef struct {
+   PromSource source;
+   const char *family;
+   const char *type;
+   const char *help;
+   const char *label;
+   size_t offset;
+   PromFieldType fieldType;
+   PromScale scale;
+   unsigned int field;        // process series only there with this field
+   unsigned int provider;     // or with this provider
+} PromSeries;
+
+#define PROC(id, name, type, help, label, field, ftype, scale) \
+   { PROM_PROCESS, name, type, help, label, offsetof(ProcessSample, field), ftype, scale, FIELD_BIT(id), 0 }
+#define PROV(id, name, type, help, label, field, ftype, scale) \
+   { PROM_PROCESS, name, type, help, label, offsetof(ProcessSample, field), ftype, scale, 0, PROVIDER_BIT(id) }
+#define SYS(name, type, help, label, field, ftype, scale) \
+   { PROM_SYSTEM, name, type, help, label, offsetof(SystemSample, field), ftype, scale, 0, 0 }
+#define CG(name, type, help, label, field, ftype, scale) \
+   { PROM_CGROUP, name, type, help, label, offsetof(CgroupSample, field), ftype, scale, 0, 0 }
+
+/*
+ * Series of the same family must stay next to each other
+ */
+static const PromSeries promSeries[] = {
+   PROC(FIELD_MINFLT, "mond_process_minor_faults_total", "counter", "Minor page faults.", NULL, minorFaults, PROM_ULL, PROM_SCALE_NONE),
+   PROC(FIELD_MAJFLT, "mond_process_major_faults_total", "counter", "Major page faults.", NULL, majorFaults, PROM_ULL, PROM_SCALE_NONE),
+   PROC(FIELD_UTIME, "mond_process_cpu_seconds_total", "counter", "CPU time by mode.", "mode=\"user\"", userTime, PROM_ULL, PROM_SCALE_TICKS),
+   PROC(FIELD_STIME, "mond_process_cpu_seconds_total", "counter", "CPU time by mode.", "mode=\"system\"", kernelTime, PROM_ULL, PROM_SCALE_TICKS),
+   PROC(FIELD_PRIORITY, "mond_process_priority", "gauge", "Scheduling priority.", NULL, priority, PROM_LL, PROM_SCALE_NONE),
+   PROC(FIELD_NICE, "mond_process_nice", "gauge", "Nice value.", NULL, nice, PROM_LL, PROM_SCALE_NONE),
+   PROC(FIELD_THREADS, "mond_process_threads", "gauge", "Number of threads.", NULL, numThreads, PROM_LL, PROM_SCALE_NONE),
+   PROC(FIELD_VSIZE, "mond_process_virtual_memory_bytes", "gauge", "Virtual memory size.", NULL, vsize, PROM_ULL, PROM_SCALE_NONE),
+   PROC(FIELD_RSS, "mond_process_resident_memory_bytes", "gauge", "Resident set size.", NULL, rss, PROM_LL, PROM_SCALE_PAGES),
+   PROC(FIELD_SHARED, "mond_process_shared_memory_bytes", "gauge", "Resident shared pages.", NULL, share, PROM_ULL, PROM_SCALE_PAGES),
+   PROC(FIELD_TEXT, "mond_process_text_bytes", "gauge", "Text (code) size.", NULL, text, PROM_ULL, PROM_SCALE_PAGES),
+   PROC(FIELD_DATA, "mond_process_data_bytes", "gauge", "Data and stack size.", NULL, data, PROM_ULL, PROM_SCALE_PAGES),
+   PROV(PROVIDER_IO, "mond_process_io_chars_total", "counter", "Bytes passed to read and write calls.", "direction=\"read\"", readChars, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_IO, "mond_process_io_chars_total", "counter", "Bytes passed to read and write calls.", "direction=\"write\"", writeChars, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_IO, "mond_process_io_syscalls_total", "counter", "Read and write calls.", "direction=\"read\"", readCalls, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_IO, "mond_process_io_syscalls_total", "counter", "Read and write calls.", "direction=\"write\"", writeCalls, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_IO, "mond_process_io_storage_bytes_total", "counter", "Bytes fetched from or sent to storage.", "direction=\"read\"", readBytes, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_IO, "mond_process_io_storage_bytes_total", "counter", "Bytes fetched from or sent to storage.", "direction=\"write\"", writeBytes, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_STATUS, "mond_process_context_switches_total", "counter", "Context switches.", "kind=\"voluntary\"", voluntaryCtxt, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_STATUS, "mond_process_context_switches_total", "counter", "Context switches.", "kind=\"involuntary\"", involuntaryCtxt, PROM_ULL, PROM_SCALE_NONE),
+   PROV(PROVIDER_SCHED, "mond_process_run_seconds_total", "counter", "Time on a cpu.", NULL, runNsec, PROM_ULL, PROM_SCALE_NSEC),
+   PROV(PROVIDER_SCHED, "mond_process_runqueue_wait_seconds_total", "counter", "Time runnable but waiting for a cpu.", NULL, waitNsec, PROM_ULL, PROM_SCALE_NSEC),
+   PROV(PROVIDER_SMAPS, "mond_process_pss_bytes", "gauge", "Proportional set size by kind.", "kind=\"total\"", pss, PROM_ULL, PROM_SCALE_KB),
+   PROV(PROVIDER_SMAPS, "mond_process_pss_bytes", "gauge", "Proportional set size by kind.", "kind=\"anon\"", pssAnon, PROM_ULL, PROM_SCALE_KB),
+   PROV(PROVIDER_SMAPS, "mond_process_pss_bytes", "gauge", "Proportional set size by kind.", "kind=\"file\"", pssFile, PROM_ULL, PROM_SCALE_KB),
+   PROV(PROVIDER_SMAPS, "mond_process_pss_bytes", "gauge", "Proportional set size by kind.", "kind=\"shmem\"", pssShmem, PROM_ULL, PROM_SCALE_KB),
+   PROV(PROVIDER_SMAPS, "mond_process_swap_bytes", "gauge", "Swapped out memory.", NULL, swap, PROM_ULL, PROM_SCALE_KB),
+   PROV(PROVIDER_FDS, "mond_process_open_fds", "gauge", "Open file descriptors.", NULL, openFds, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_cpu_seconds_total", "counter", "System CPU time by mode.", "mode=\"user\"", cpuUser, PROM_ULL, PROM_SCALE_TICKS),
+   SYS("mond_system_cpu_seconds_total", "counter", "System CPU time by mode.", "mode=\"system\"", cpuSystem, PROM_ULL, PROM_SCALE_TICKS),
+   SYS("mond_system_cpu_seconds_total", "counter", "System CPU time by mode.", "mode=\"idle\"", cpuIdle, PROM_ULL, PROM_SCALE_TICKS),
+   SYS("mond_system_cpu_seconds_total", "counter", "System CPU time by mode.", "mode=\"iowait\"", cpuIowait, PROM_ULL, PROM_SCALE_TICKS),
+   SYS("mond_system_cpu_seconds_total", "counter", "System CPU time by mode.", "mode=\"irq\"", cpuIrq, PROM_ULL, PROM_SCALE_TICKS),
+   SYS("mond_system_cpu_seconds_total", "counter", "System CPU time by mode.", "mode=\"softirq\"", cpuSoftirq, PROM_ULL, PROM_SCALE_TICKS),
+   SYS("mond_system_interrupts_total", "counter", "Interrupts serviced.", NULL, intr, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_context_switches_total", "counter", "Context switches.", NULL, ctxt, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_forks_total", "counter", "Processes created.", NULL, forks, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_procs_running", "gauge", "Runnable processes.", NULL, runnable, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_procs_blocked", "gauge", "Processes blocked on I/O.", NULL, blocked, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_memory_bytes", "gauge", "Memory by kind.", "kind=\"total\"", memTotal, PROM_ULL, PROM_SCALE_KB),
+   SYS("mond_system_memory_bytes", "gauge", "Memory by kind.", "kind=\"free\"", memFree, PROM_ULL, PROM_SCALE_KB),
+   SYS("mond_system_memory_bytes", "gauge", "Memory by kind.", "kind=\"cached\"", cached, PROM_ULL, PROM_SCALE_KB),
+   SYS("mond_system_memory_bytes", "gauge", "Memory by kind.", "kind=\"swapcached\"", swapCached, PROM_ULL, PROM_SCALE_KB),
+   SYS("mond_system_memory_bytes", "gauge", "Memory by kind.", "kind=\"active\"", active, PROM_ULL, PROM_SCALE_KB),
+   SYS("mond_system_memory_bytes", "gauge", "Memory by kind.", "kind=\"inactive\"", inactive, PROM_ULL, PROM_SCALE_KB),
+   SYS("mond_system_load1", "gauge", "1 minute load average.", NULL, load1, PROM_DOUBLE, PROM_SCALE_NONE),
+   SYS("mond_system_load5", "gauge", "5 minute load average.", NULL, load5, PROM_DOUBLE, PROM_SCALE_NONE),
+   SYS("mond_system_load15", "gauge", "15 minute load average.", NULL, load15, PROM_DOUBLE, PROM_SCALE_NONE),
+   SYS("mond_system_network_bytes_total", "counter", "Bytes through physical interfaces.", "direction=\"rx\"", netRxBytes, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_network_bytes_total", "counter", "Bytes through physical interfaces.", "direction=\"tx\"", netTxBytes, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_network_packets_total", "counter", "Packets through physical interfaces.", "direction=\"rx\"", netRxPackets, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_network_packets_total", "counter", "Packets through physical interfaces.", "direction=\"tx\"", netTxPackets, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_network_drops_total", "counter", "Packets dropped on physical interfaces.", "direction=\"rx\"", netRxDrops, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_network_drops_total", "counter", "Packets dropped on physical interfaces.", "direction=\"tx\"", netTxDrops, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_network_errors_total", "counter", "Errors on physical interfaces.", "direction=\"rx\"", netRxErrors, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_network_errors_total", "counter", "Errors on physical interfaces.", "direction=\"tx\"", netTxErrors, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_tcp_retransmitted_segments_total", "counter", "TCP segments retransmitted.", NULL, tcpRetransSegs, PROM_ULL, PROM_SCALE_NONE),
+   SYS("mond_system_pressure_stalled_seconds_total", "counter", "Time tasks stalled on a resource.", "resource=\"cpu\",kind=\"some\"", psiCpuSome, PROM_ULL, PROM_SCALE_USEC),
+   SYS("mond_system_pressure_stalled_seconds_total", "counter", "Time tasks stalled on a resource.", "resource=\"memory\",kind=\"some\"", psiMemorySome, PROM_ULL, PROM_SCALE_USEC),
+   SYS("mond_system_pressure_stalled_seconds_total", "counter", "Time tasks stalled on a resource.", "resource=\"memory\",kind=\"full\"", psiMemoryFull, PROM_ULL, PROM_SCALE_USEC),
+   SYS("mond_system_pressure_stalled_seconds_total", "counter", "Time tasks stalled on a resource.", "resource=\"io\",kind=\"some\"", psiIoSome, PROM_ULL, PROM_SCALE_USEC),
+   SYS("mond_system_pressure_stalled_seconds_total", "counter", "Time tasks stalled on a resource.", "resource=\"io\",kind=\"full\"", psiIoFull, PROM_ULL, PROM_SCALE_USEC),
+   CG("mond_cgroup_cpu_seconds_total", "counter", "Cgroup CPU time by mode.", "mode=\"user\"", userUsec, PROM_ULL, PROM_SCALE_USEC),
+   CG("mond_cgroup_cpu_seconds_total", "counter", "Cgroup CPU time by mode.", "mode=\"system\"", systemUsec, PROM_ULL, PROM_SCALE_USEC),
+   CG("mond_cgroup_cpu_periods_total", "counter", "Elapsed cpu.max enforcement periods.", NULL, nrPeriods, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_cpu_throttled_periods_total", "counter", "Periods the cgroup was throttled in.", NULL, nrThrottled, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_cpu_throttled_seconds_total", "counter", "Time the cgroup was throttled.", NULL, throttledUsec, PROM_ULL, PROM_SCALE_USEC),
+   CG("mond_cgroup_memory_bytes", "gauge", "Cgroup memory by kind.", "kind=\"current\"", memoryCurrent, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_memory_bytes", "gauge", "Cgroup memory by kind.", "kind=\"anon\"", anon, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_memory_bytes", "gauge", "Cgroup memory by kind.", "kind=\"file\"", file, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_memory_bytes", "gauge", "Cgroup memory by kind.", "kind=\"kernel\"", kernel, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_memory_bytes", "gauge", "Cgroup memory by kind.", "kind=\"shmem\"", shmem, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_page_faults_total", "counter", "Cgroup page faults.", "kind=\"minor\"", pgfault, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_page_faults_total", "counter", "Cgroup page faults.", "kind=\"major\"", pgmajfault, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_io_bytes_total", "counter", "Cgroup block i/o bytes.", "direction=\"read\"", ioReadBytes, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_io_bytes_total", "counter", "Cgroup block i/o bytes.", "direction=\"write\"", ioWriteBytes, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_io_operations_total", "counter", "Cgroup block i/o operations.", "direction=\"read\"", ioReads, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_io_operations_total", "counter", "Cgroup block i/o operations.", "direction=\"write\"", ioWrites, PROM_ULL, PROM_SCALE_NONE),
+   CG("mond_cgroup_pids", "gauge", "Tasks in the cgroup.", NULL, pidsCurrent, PROM_ULL, PROM_SCALE_NONE),
+};
+
+#define PROM_SERIES_COUNT ((int)(sizeof (promSeries) / sizeof (promSeries[0])))
+
+void promRefresh(PromCache *cache, PromMonitorCache *mcache, ThreadTable *line, PromSource source);
+void promResetMonitor(PromMonitorCache *mcache);
+void promBuildLabels(PromMonitorCache *mcache, ThreadTable *line, PromSource source);
+void promEscape(char *out, size_t len, const char *str);
+double promValue(const PromSeries *series, const void *sample);
+void promAssemble(PromCache *cache);
+
+static double promPageSize = 0;
+static double promClockTicks = 0;
+
+extern ThreadTable threadTable[THREAD_TABLE_SIZE];
+extern ThreadTable systemThreadTable;
+
+
+void promInit(PromCache *cache) {
+   memset(cache, 0, sizeof (PromCache));
+   bufferInit(&(cache->page));
+   cache->dirty = 1;
+
+   if (PROM_SERIES_COUNT > PROM_MAX_SERIES) {
+      fprintf(stderr, "too many prometheus series\n");
+      exit(-1);
+   }
+
+   promPageSize = sysconf(_SC_PAGESIZE);
+   promClockTicks = sysconf(_SC_CLK_TCK);
+
+   return;
+}
+
+void promDestroy(PromCache *cache) {
+   bufferFree(&(cache->page));
+
+   return;
+}
+
+/*
+ * GET /metrics
+ */
+void promMetrics(HttpConn *conn, HttpRequest *req, PromCache *cache) {
+   int i = 0;
+
+   promRefresh(cache, &(cache->system), &systemThreadTable, PROM_SYSTEM);
+   for (i = 0; i < THREAD_TABLE_SIZE; i++) {
+      promRefresh(cache, &(cache->monitors[i]), &(threadTable[i]), PROM_PROCESS);
+   }
+
+   if (cache->dirty != 0) {
+      promAssemble(cache);
+      cache->dirty = 0;
+   }
+
+   httpRespond(conn, req, 200, "text/plain; version=0.0.4; charset=utf-8",
+         cache->page.data, cache->page.len);
+
+   return;
+}
+
+/*
+ * Brings the cached lines of one monitor up to date with its latest sample
+ */
+void promRefresh(PromCache *cache, PromMonitorCache *mcache, ThreadTable *line, PromSource source) {
+   Sample *latest = NULL;
+   double value = 0;
+   size_t pos = 0;
+   int i = 0;
+
+   /*
+    *  What threads use this critical section:
+    *    Only the webmon thread uses this critical section.
+    *
+    *  What shared resources are being protected:
+    *    The table row that is passed in is locked so that its history is
+    *    not written while we read the latest sample.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except loop control flow) must
+    *    use the shared resources and therefore, must be locked.  Rows whose
+    *    sample count did not move since the last scrape are released right
+    *    away and only changed values are formatted while the lock is held.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (line->startTime == 0 || line->history == NULL) {
+      if (mcache->tid != 0) {
+         promResetMonitor(mcache);
+         cache->dirty = 1;
+      }
+   } else {
+      // the process rows of the table also hold the cgroup monitors
+      if (source == PROM_PROCESS && line->pid == CGROUP_THREAD_ID) {
+         source = PROM_CGROUP;
+      }
+
+      if (pthread_equal(mcache->tid, line->tid) == 0 || mcache->labels[0] == '\0' ||
+            mcache->pid != line->pid || strcmp(mcache->executable, line->executable) != 0) {
+         promResetMonitor(mcache);
+         promBuildLabels(mcache, line, source);
+         mcache->tid = line->tid;
+         mcache->pid = line->pid;
+         cache->dirty = 1;
+      }
+
+      if (mcache->total != line->history->total &&
+            (latest = historyLatest(line->history)) != NULL) {
+         mcache->total = line->history->total;
+
+         for (i = 0; i < PROM_SERIES_COUNT; i++) {
+            if (promSeries[i].source != source ||
+                  (promSeries[i].field != 0 && (latest->proc.fields & promSeries[i].field) == 0) ||
+                  (promSeries[i].provider != 0 && (latest->proc.providers & promSeries[i].provider) == 0)) {
+               continue;
+            }
+
+            value = promValue(&promSeries[i], latest);
+            if (mcache->lines[i].valid != 0 && mcache->lines[i].value == value) {
+               continue;
+            }
+
+            pos = snprintf(mcache->lines[i].text, PROM_LINE_LEN, "%s{%s%s%s} %.17g\n",
+                  promSeries[i].family, mcache->labels,
+                  (promSeries[i].label != NULL) ? "," : "",
+                  (promSeries[i].label != NULL) ? promSeries[i].label : "",
+                  value);
+            mcache->lines[i].len = (pos < PROM_LINE_LEN) ? pos : PROM_LINE_LEN - 1;
+            mcache->lines[i].value = value;
+            mcache->lines[i].valid = 1;
+            cache->dirty = 1;
+         }
+      }
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+void promResetMonitor(PromMonitorCache *mcache) {
+   int i = 0;
+
+   mcache->tid = 0;
+   mcache->pid = 0;
+   mcache->total = 0;
+   mcache->labels[0] = '\0';
+   mcache->executable[0] = '\0';
+   for (i = 0; i < PROM_MAX_SERIES; i++) {
+      mcache->lines[i].valid = 0;
+      mcache->lines[i].len = 0;
+   }
+
+   return;
+}
+
+void promBuildLabels(PromMonitorCache *mcache, ThreadTable *line, PromSource source) {
+   char executable[MAX_EXE_LEN * 2] = "";
+   char fileName[MAX_INPUT_LEN * 2] = "";
+   char cgroup[MAX_INPUT_LEN * 2] = "";
+   char bare[MAX_EXE_LEN] = "";
+   size_t len = strlen(line->executable);
+
+   // the executable is kept as "(name)" like /proc/<pid>/stat shows it
+   if (len >= 2 && line->executable[0] == '(' && line->executable[len - 1] == ')') {
+      memcpy(bare, line->executable + 1, len - 2);
+      bare[len - 2] = '\0';
+   } else {
+      memcpy(bare, line->executable, len + 1);
+   }
+
+   promEscape(executable, sizeof (executable), bare);
+   promEscape(fileName, sizeof (fileName), line->fileName);
+
+   if (source == PROM_SYSTEM) {
+      snprintf(mcache->labels, PROM_LABEL_LEN, "log_file=\"%s\"", fileName);
+   } else if (source == PROM_CGROUP) {
+      promEscape(cgroup, sizeof (cgroup), line->cgroup);
+      snprintf(mcache->labels, PROM_LABEL_LEN, "cgroup=\"%s\",log_file=\"%s\"", cgroup, fileName);
+   } else {
+      snprintf(mcache->labels, PROM_LABEL_LEN, "pid=\"%d\",executable=\"%s\",log_file=\"%s\"",
+            (int)line->pid, executable, fileName);
+   }
+
+   memcpy(mcache->executable, line->executable, MAX_EXE_LEN);
+
+   return;
+}
+
+/*
+ * Copies str escaping '\\', '"' and newlines as the label syntax requires
+ */
+void promEscape(char *out, size_t len, const char *str) {
+   size_t pos = 0;
+
+   for (; *str != '\0' && pos < len - 2; str++) {
+      if (*str == '\\' || *str == '"') {
+         out[pos++] = '\\';
+         out[pos++] = *str;
+      } else if (*str == '\n') {
+         out[pos++] = '\\';
+         out[pos++] = 'n';
+      } else {
+         out[pos++] = *str;
+      }
+   }
+   out[pos] = '\0';
+
+   return;
+}
+
+double promValue(const PromSeries *series, const void *sample) {
+   const char *field = (const char *)sample + series->offset;
+   double value = 0;
+
+   switch (series->fieldType) {
+      case PROM_ULL: value = (double)*(const unsigned long long *)field; break;
+      case PROM_LL: value = (double)*(const long long *)field; break;
+      case PROM_DOUBLE: value = *(const double *)field; break;
+   }
+
+   switch (series->scale) {
+      case PROM_SCALE_PAGES: value *= promPageSize; break;
+      case PROM_SCALE_TICKS: value /= promClockTicks; break;
+      case PROM_SCALE_KB: value *= 1024; break;
+      case PROM_SCALE_USEC: value /= 1000000; break;
+      case PROM_SCALE_NSEC: value /= 1000000000; break;
+      default: break;
+   }
+
+   return value;
+}
+
+/*
+ * Lays the cached lines out family by family
+ */
+void promAssemble(PromCache *cache) {
+   int i = 0, m = 0;
+
+   bufferReset(&(cache->page));
+
+   for (i = 0; i < PROM_SERIES_COUNT; i++) {
+      if (i == 0 || strcmp(promSeries[i].family, promSeries[i - 1].family) != 0) {
+         bufferPrintf(&(cache->page), "# HELP %s %s\n# TYPE %s %s\n",
+               promSeries[i].family, promSeries[i].help,
+               promSeries[i].family, promSeries[i].type);
+      }
+
+      if (promSeries[i].source == PROM_SYSTEM) {
+         if (cache->system.lines[i].valid != 0) {
+            bufferAppend(&(cache->page), cache->system.lines[i].text, cache->system.lines[i].len);
+         }
+         continue;
+      }
+
+      for (m = 0; m < THREAD_TABLE_SIZE; m++) {
+         if (cache->monitors[m].lines[i].valid != 0) {
+            bufferAppend(&(cache->page), cache->monitors[m].lines[i].text,
+                  cache->monitors[m].lines[i].len);
+         }
+      }
+   }
+
+   return;
+}
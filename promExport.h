@@ -0,0 +1,47 @@
+
+#ifndef __PROM_EXPORT_H_
+#define __PROM_EXPORT_H_
+
+#include <pthread.h>
+
+#include "mond.h"
+#include "buffer.h"
+#include "httpServer.h"
+
+#define PROM_METRICS_PATH "/metrics"
+#define PROM_MAX_SERIES 96
+#define PROM_LINE_LEN 768
+#define PROM_LABEL_LEN 640
+
+typedef struct {
+   char text[PROM_LINE_LEN];
+   int len;
+   double value;
+   int valid;
+} PromLine;
+
+/*
+ * Serialized series of one monitor.  A line is only formatted again when its
+ * value changed since the previous scrape.
+ */
+typedef struct {
+   pthread_t tid;
+   pid_t pid;
+   unsigned long total;
+   char labels[PROM_LABEL_LEN];
+   char executable[MAX_EXE_LEN];
+   PromLine lines[PROM_MAX_SERIES];
+} PromMonitorCache;
+
+typedef struct {
+   PromMonitorCache system;
+   PromMonitorCache monitors[THREAD_TABLE_SIZE];
+   Buffer page;
+   int dirty;
+} PromCache;
+
+void promInit(PromCache *cache);
+void promDestroy(PromCache *cache);
+void promMetrics(HttpConn *conn, HttpRequest *req, PromCache *cache);
+
+#endif // __PROM_EXPORT_H_
@@ -0,0 +1,273 @@
+/*
+ * Pressure stall information sampling and poll triggers
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include "psiStats.h"
+#include "logLibrary.h"
+
+#define PSI_TRIGGER_LEN 64
+
+int psiArmResource(PsiResource resource, unsigned long stallUsec, unsigned long windowUsec);
+void psiParseLine(const char *line, PsiLine *psi);
+double psiField(const char **cursor);
+
+static const char *psiPaths[PSI_RESOURCES] = {
+   "/proc/pressure/cpu",
+   "/proc/pressure/memory",
+   "/proc/pressure/io"
+};
+
+static const char *psiNames[PSI_RESOURCES] = { "cpu", "memory", "io" };
+
+
+/*
+ * Note: psi is optional (CONFIG_PSI, psi=0 on the command line), the
+ * resources whose file does not open are left out
+ */
+void psiStatsInit(PsiStats *stats) {
+   int i = 0;
+
+   memset(stats, 0, sizeof (PsiStats));
+   bufferInit(&(stats->raw));
+
+   for (i = 0; i < PSI_RESOURCES; i++) {
+      stats->fd[i] = open(psiPaths[i], O_RDONLY);
+      stats->triggerFd[i] = -1;
+   }
+
+   return;
+}
+
+void psiStatsDestroy(PsiStats *stats) {
+   int i = 0;
+
+   for (i = 0; i < PSI_RESOURCES; i++) {
+      if (stats->fd[i] != -1) {
+         close(stats->fd[i]);
+         stats->fd[i] = -1;
+      }
+      if (stats->triggerFd[i] != -1) {
+         close(stats->triggerFd[i]);
+         stats->triggerFd[i] = -1;
+      }
+   }
+
+   bufferFree(&(stats->raw));
+
+   return;
+}
+
+/*
+ * Registers a "some" trigger on every resource.  The kernel wants the
+ * window within [500ms, 10s] and, without CAP_SYS_RESOURCE, a multiple of
+ * 2s; such windows are retried rounded up with the same stall share.
+ *
+ * Return: the number of resources armed
+ */
+int psiStatsArm(PsiStats *stats, unsigned long stallUsec, unsigned long windowUsec) {
+   unsigned long userWindow = 0;
+   int armed = 0;
+   int i = 0;
+
+   if (stallUsec == 0 || stallUsec > windowUsec ||
+         windowUsec < PSI_MIN_WINDOW_USEC || windowUsec > PSI_MAX_WINDOW_USEC) {
+      return 0;
+   }
+
+   userWindow = (windowUsec + PSI_USER_WINDOW_USEC - 1) / PSI_USER_WINDOW_USEC * PSI_USER_WINDOW_USEC;
+
+   for (i = 0; i < PSI_RESOURCES; i++) {
+      if (stats->fd[i] == -1) {
+         continue;
+      }
+
+      stats->triggerFd[i] = psiArmResource((PsiResource)i, stallUsec, windowUsec);
+      if (stats->triggerFd[i] == -1 && userWindow != windowUsec && userWindow <= PSI_MAX_WINDOW_USEC) {
+         stats->triggerFd[i] = psiArmResource((PsiResource)i,
+               (unsigned long)((double)stallUsec * userWindow / windowUsec), userWindow);
+      }
+
+      if (stats->triggerFd[i] != -1) {
+         armed++;
+      }
+   }
+
+   return armed;
+}
+
+/*
+ * Return: the descriptor holding the trigger (it lives as long as the
+ *         descriptor), -1 if the kernel refused it
+ */
+int psiArmResource(PsiResource resource, unsigned long stallUsec, unsigned long windowUsec) {
+   char trigger[PSI_TRIGGER_LEN] = "";
+   int len = snprintf(trigger, sizeof (trigger), "some %lu %lu", stallUsec, windowUsec);
+   int fd = -1;
+
+   if ((fd = open(psiPaths[resource], O_RDWR | O_NONBLOCK)) == -1) {
+      return -1;
+   }
+
+   // the kernel parses the trigger as a string, the terminator is written too
+   if (write(fd, trigger, len + 1) == -1) {
+      close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+void psiStatsUpdate(PsiStats *stats) {
+   const char *full = NULL;
+   int i = 0;
+
+   for (i = 0; i < PSI_RESOURCES; i++) {
+      stats->valid[i] = 0;
+
+      if (stats->fd[i] == -1 || readProcBuffer(stats->fd[i], &(stats->raw)) <= 0) {
+         continue;
+      }
+
+      psiParseLine(findLineByKey(stats->raw.data, "some"), &(stats->some[i]));
+      // cpu has no "full" line before 5.13
+      full = findLineByKey(stats->raw.data, "full");
+      if (full != NULL) {
+         psiParseLine(full, &(stats->full[i]));
+      } else {
+         memset(&(stats->full[i]), 0, sizeof (PsiLine));
+      }
+
+      stats->valid[i] = 1;
+   }
+
+   return;
+}
+
+/*
+ * Sleeps up to timeoutUsec, returning early when a trigger fires.  Without
+ * triggers this is a plain sleep.
+ *
+ * Return: bit (1 << resource) set for each resource that fired, 0 on timeout
+ */
+int psiStatsWait(PsiStats *stats, long timeoutUsec) {
+   struct pollfd fds[PSI_RESOURCES];
+   PsiResource resources[PSI_RESOURCES];
+   int nfds = 0, fired = 0;
+   int i = 0;
+
+   if (timeoutUsec <= 0) {
+      return 0;
+   }
+
+   for (i = 0; i < PSI_RESOURCES; i++) {
+      if (stats->triggerFd[i] != -1) {
+         fds[nfds].fd = stats->triggerFd[i];
+         fds[nfds].events = POLLPRI;
+         fds[nfds].revents = 0;
+         resources[nfds] = (PsiResource)i;
+         nfds++;
+      }
+   }
+
+   if (nfds == 0) {
+      longSleep(timeoutUsec);
+      return 0;
+   }
+
+   // round up, a zero timeout would spin for the last sub-millisecond
+   if (poll(fds, nfds, (int)((timeoutUsec + 999) / 1000)) == -1) {
+      if (errno != EINTR) {
+         perror("poll failed");
+         exit(-1);
+      }
+      return 0;
+   }
+
+   for (i = 0; i < nfds; i++) {
+      if ((fds[i].revents & POLLERR) != 0) {
+         // the pressure file went away, stop watching it
+         close(stats->triggerFd[resources[i]]);
+         stats->triggerFd[resources[i]] = -1;
+      } else if ((fds[i].revents & POLLPRI) != 0) {
+         stats->triggers[resources[i]]++;
+         fired |= 1 << resources[i];
+      }
+   }
+
+   return fired;
+}
+
+const char *psiResourceName(PsiResource resource) {
+   return psiNames[resource];
+}
+
+void psiStatsPrint(FILE *fLogFile, PsiStats *stats) {
+   int i = 0;
+
+   for (i = 0; i < PSI_RESOURCES; i++) {
+      if (stats->valid[i] == 0) {
+         continue;
+      }
+
+      fprintf(fLogFile, " [PSI(%s)] someavg10 %.2f someavg60 %.2f someavg300 %.2f sometotal %llu"
+            " fullavg10 %.2f fullavg60 %.2f fullavg300 %.2f fulltotal %llu triggers %lu",
+            psiNames[i], stats->some[i].avg10, stats->some[i].avg60, stats->some[i].avg300,
+            stats->some[i].total, stats->full[i].avg10, stats->full[i].avg60,
+            stats->full[i].avg300, stats->full[i].total, stats->triggers[i]);
+   }
+
+   return;
+}
+
+/*
+ * Note: line is "some avg10=0.00 avg60=0.00 avg300=0.00 total=0"
+ */
+void psiParseLine(const char *line, PsiLine *psi) {
+   const char *cursor = line;
+
+   memset(psi, 0, sizeof (PsiLine));
+
+   if (cursor == NULL) {
+      return;
+   }
+
+   psi->avg10 = psiField(&cursor);
+   psi->avg60 = psiField(&cursor);
+   psi->avg300 = psiField(&cursor);
+   if ((cursor = strchr(cursor, '=')) != NULL) {
+      cursor++;
+      psi->total = parseUnsigned(&cursor);
+   }
+
+   return;
+}
+
+/*
+ * Return: the value after the next '=' on the line, 0 if there is none
+ */
+double psiField(const char **cursor) {
+   const char *p = *cursor;
+
+   while (*p != '=' && *p != '\n' && *p != '\0') {
+      p++;
+   }
+
+   if (*p != '=') {
+      *cursor = p;
+      return 0.0;
+   }
+
+   p++;
+   *cursor = p;
+
+   return parseDouble(cursor);
+}
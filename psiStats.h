@@ -0,0 +1,50 @@
+#ifndef __PSI_STATS_H_
+#define __PSI_STATS_H_
+
+#include <stdio.h>
+
+#include "buffer.h"
+
+#define PSI_MIN_WINDOW_USEC 500000
+#define PSI_MAX_WINDOW_USEC 10000000
+#define PSI_USER_WINDOW_USEC 2000000    // unprivileged windows are multiples of this
+
+typedef enum {
+   PSI_CPU = 0,
+   PSI_MEMORY = 1,
+   PSI_IO = 2,
+   PSI_RESOURCES = 3
+} PsiResource;
+
+typedef struct {
+   double avg10;              // percent of the time some (or all) tasks stalled
+   double avg60;
+   double avg300;
+   unsigned long long total;  // usec stalled since boot
+} PsiLine;
+
+/*
+ * Pressure stall information of /proc/pressure.  Besides the files read
+ * every tick, each resource can hold a trigger: a second descriptor the
+ * kernel wakes with POLLPRI when "some" tasks stalled for stallUsec within
+ * a window, so contention shows up between ticks.
+ */
+typedef struct {
+   int fd[PSI_RESOURCES];           // -1 when the kernel has no psi
+   int triggerFd[PSI_RESOURCES];    // -1 when not armed
+   int valid[PSI_RESOURCES];
+   PsiLine some[PSI_RESOURCES];
+   PsiLine full[PSI_RESOURCES];
+   unsigned long triggers[PSI_RESOURCES];   // notifications since the start
+   Buffer raw;
+} PsiStats;
+
+void psiStatsInit(PsiStats *stats);
+void psiStatsDestroy(PsiStats *stats);
+int psiStatsArm(PsiStats *stats, unsigned long stallUsec, unsigned long windowUsec);
+void psiStatsUpdate(PsiStats *stats);
+int psiStatsWait(PsiStats *stats, long timeoutUsec);
+const char *psiResourceName(PsiResource resource);
+void psiStatsPrint(FILE *fLogFile, PsiStats *stats);
+
+#endif // __PSI_STATS_H_
@@ -0,0 +1,276 @@
+/*
+ * Streaming quantile sketches of the key metrics of every monitor
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "quantiles.h"
+
+void sketchAddKey(Sketch *sketch, int key, unsigned long long count);
+void sketchShift(Sketch *sketch, int base);
+int sketchKey(double value);
+double sketchValue(int key);
+
+// the metrics each kind of monitor keeps sketches of
+static const char *quantileMetrics[ALERT_KINDS][QUANTILE_METRICS] = {
+   { "cpu%", "rss", "faults" },        // ALERT_PROCESS
+   { "cpu%", "mem%", "load" },         // ALERT_SYSTEM
+   { "cpu%", "mem", "faults" }         // ALERT_CGROUP
+};
+
+
+void sketchInit(Sketch *sketch) {
+   memset(sketch, 0, sizeof (Sketch));
+
+   return;
+}
+
+void sketchAdd(Sketch *sketch, double value) {
+   if (value > sketch->max || sketch->count == 0) {
+      sketch->max = value;
+   }
+
+   if (value < SKETCH_ZERO) {
+      sketch->zeros++;
+      sketch->count++;
+      return;
+   }
+
+   sketchAddKey(sketch, sketchKey(value), 1);
+
+   return;
+}
+
+/*
+ * Adds the values of from to into, as if into had seen them itself
+ */
+void sketchMerge(Sketch *into, const Sketch *from) {
+   int i = 0;
+
+   if (from->count == 0) {
+      return;
+   }
+
+   if (from->max > into->max || into->count == 0) {
+      into->max = from->max;
+   }
+
+   for (i = 0; i < SKETCH_BUCKETS; i++) {
+      if (from->buckets[i] != 0) {
+         sketchAddKey(into, from->base + i, from->buckets[i]);
+      }
+   }
+
+   into->zeros += from->zeros;
+   into->count += from->zeros;
+
+   return;
+}
+
+/*
+ * Return: the value of rank q (0 to 1) among the values added, 0 if none
+ */
+double sketchQuantile(const Sketch *sketch, double q) {
+   unsigned long long rank = 0, seen = 0;
+   double value = 0.0;
+   int i = 0;
+
+   if (sketch->count == 0) {
+      return 0.0;
+   }
+
+   rank = (unsigned long long)(q * (sketch->count - 1));
+   if (rank < sketch->zeros) {
+      return 0.0;
+   }
+
+   seen = sketch->zeros;
+   for (i = 0; i < SKETCH_BUCKETS; i++) {
+      seen += sketch->buckets[i];
+      if (seen > rank) {
+         value = sketchValue(sketch->base + i);
+         return (value > sketch->max) ? sketch->max : value;
+      }
+   }
+
+   return sketch->max;
+}
+
+void sketchSummary(const Sketch *sketch, QuantileSummary *summary) {
+   summary->count = sketch->count;
+   summary->p50 = sketchQuantile(sketch, 0.50);
+   summary->p95 = sketchQuantile(sketch, 0.95);
+   summary->p99 = sketchQuantile(sketch, 0.99);
+   summary->max = sketch->max;
+
+   return;
+}
+
+/*
+ * Sets up empty sketches of the metrics kind keeps
+ */
+void quantileInit(QuantileSet *set, AlertKind kind) {
+   int i = 0, metric = -1;
+
+   memset(set, 0, sizeof (QuantileSet));
+   set->kind = kind;
+
+   for (i = 0; i < QUANTILE_METRICS; i++) {
+      if ((metric = alertMetric(quantileMetrics[kind][i], kind)) != -1) {
+         set->metrics[set->count++].metric = metric;
+      }
+   }
+
+   return;
+}
+
+/*
+ * Adds the newest sample of history to every sketch, starting a new window
+ * once the current one is QUANTILE_WINDOW old.  The caller holds the table
+ * row lock.
+ */
+void quantileUpdate(QuantileSet *set, SampleHistory *history) {
+   const Sample *now = NULL, *prev = NULL;
+   QuantileMetric *metric = NULL;
+   long long timeUsec = 0;
+   double value = 0.0;
+   int i = 0;
+
+   if (history == NULL || history->count == 0) {
+      return;
+   }
+
+   now = historyLatest(history);
+   prev = (history->count >= 2) ? historyGet(history, history->count - 2) : NULL;
+   timeUsec = alertSampleTime(set->kind, now);
+
+   if (set->windowUsec == 0) {
+      set->windowUsec = timeUsec;
+   } else if (timeUsec - set->windowUsec >= QUANTILE_WINDOW) {
+      for (i = 0; i < set->count; i++) {
+         metric = &(set->metrics[i]);
+         // after a gap of over a window the current one is not recent either
+         if (timeUsec - set->windowUsec >= 2 * QUANTILE_WINDOW) {
+            sketchInit(&(metric->previous));
+         } else {
+            metric->previous = metric->current;
+         }
+         sketchInit(&(metric->current));
+      }
+      set->windowUsec = timeUsec;
+   }
+
+   for (i = 0; i < set->count; i++) {
+      metric = &(set->metrics[i]);
+      if (alertMetricValue(metric->metric, now, prev, &value) == 0) {
+         sketchAdd(&(metric->lifetime), value);
+         sketchAdd(&(metric->current), value);
+      }
+   }
+
+   return;
+}
+
+const char *quantileName(const QuantileSet *set, int idx) {
+   return alertMetricName(set->metrics[idx].metric);
+}
+
+void quantileLifetime(const QuantileSet *set, int idx, QuantileSummary *summary) {
+   sketchSummary(&(set->metrics[idx].lifetime), summary);
+
+   return;
+}
+
+/*
+ * Summarizes the previous and current windows merged
+ */
+void quantileRecent(const QuantileSet *set, int idx, QuantileSummary *summary) {
+   Sketch recent = set->metrics[idx].previous;
+
+   sketchMerge(&recent, &(set->metrics[idx].current));
+   sketchSummary(&recent, summary);
+
+   return;
+}
+
+/*
+ * Counts count values of key, moving or folding the buckets when key is
+ * outside of the array
+ */
+void sketchAddKey(Sketch *sketch, int key, unsigned long long count) {
+   int lowest = 0;
+
+   if (sketch->count == sketch->zeros) {
+      // first value in a bucket, center the array on it
+      memset(sketch->buckets, 0, sizeof (sketch->buckets));
+      sketch->base = key - SKETCH_BUCKETS / 2;
+      sketch->high = key;
+   } else if (key < sketch->base) {
+      // move down as far as the highest key allows, fold what is still lower
+      lowest = sketch->high - SKETCH_BUCKETS + 1;
+      if (lowest < key) {
+         lowest = key;
+      }
+      if (lowest < sketch->base) {
+         sketchShift(sketch, lowest);
+      }
+      if (key < sketch->base) {
+         key = sketch->base;
+      }
+   } else if (key >= sketch->base + SKETCH_BUCKETS) {
+      sketchShift(sketch, key - SKETCH_BUCKETS + 1);
+   }
+
+   sketch->buckets[key - sketch->base] += count;
+   sketch->count += count;
+   if (key > sketch->high) {
+      sketch->high = key;
+   }
+
+   return;
+}
+
+/*
+ * Moves buckets[0] to key base; moving up folds the buckets that fall off
+ * the bottom into the new lowest one
+ */
+void sketchShift(Sketch *sketch, int base) {
+   unsigned int count = 0;
+   int by = base - sketch->base, i = 0, to = 0;
+
+   if (by > 0) {
+      for (i = 0; i < SKETCH_BUCKETS; i++) {
+         count = sketch->buckets[i];
+         sketch->buckets[i] = 0;
+         to = (i - by < 0) ? 0 : i - by;
+         sketch->buckets[to] += count;
+      }
+   } else if (by < 0) {
+      for (i = SKETCH_BUCKETS - 1; i >= 0; i--) {
+         count = sketch->buckets[i];
+         sketch->buckets[i] = 0;
+         if (count != 0) {
+            sketch->buckets[i - by] = count;
+         }
+      }
+   }
+
+   sketch->base = base;
+
+   return;
+}
+
+int sketchKey(double value) {
+   return (int)ceil(log(value) / log(SKETCH_GAMMA));
+}
+
+/*
+ * Return: the middle (relatively) of the bucket of key
+ */
+double sketchValue(int key) {
+   return 2.0 * pow(SKETCH_GAMMA, key) / (SKETCH_GAMMA + 1.0);
+}
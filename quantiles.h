@@ -0,0 +1,67 @@
+#ifndef __QUANTILES_H_
+#define __QUANTILES_H_
+
+#include "samples.h"
+#include "alerts.h"
+
+#define SKETCH_BUCKETS 256
+#define SKETCH_GAMMA 1.0408           // bucket growth, about 2% relative error
+#define SKETCH_ZERO 1e-6              // values below this count as 0
+#define QUANTILE_METRICS 3
+#define QUANTILE_WINDOW 300000000     // usec, the recent sketches cover 1-2 of these
+
+/*
+ * Log bucketed histogram (DDSketch): bucket i of the array counts the
+ * values in (GAMMA^(base + i - 1), GAMMA^(base + i)], so any quantile is
+ * within 2% of the true value.  When the values span more than the array
+ * the lowest buckets are folded together, which keeps the upper quantiles
+ * exact to the same error.  Two sketches add up bucket by bucket.
+ */
+typedef struct {
+   unsigned long long count;
+   unsigned long long zeros;
+   double max;
+   int base;                          // key of buckets[0]
+   int high;                          // highest key in use
+   unsigned int buckets[SKETCH_BUCKETS];
+} Sketch;
+
+typedef struct {
+   unsigned long long count;
+   double p50;
+   double p95;
+   double p99;
+   double max;
+} QuantileSummary;
+
+/*
+ * The distributions one monitor keeps of its key metrics, over its life
+ * and over the current and the previous QUANTILE_WINDOW
+ */
+typedef struct {
+   int metric;                        // in the alert metric table
+   Sketch lifetime;
+   Sketch current;
+   Sketch previous;
+} QuantileMetric;
+
+typedef struct {
+   AlertKind kind;
+   int count;
+   long long windowUsec;              // start of the current window
+   QuantileMetric metrics[QUANTILE_METRICS];
+} QuantileSet;
+
+void sketchInit(Sketch *sketch);
+void sketchAdd(Sketch *sketch, double value);
+void sketchMerge(Sketch *into, const Sketch *from);
+double sketchQuantile(const Sketch *sketch, double q);
+void sketchSummary(const Sketch *sketch, QuantileSummary *summary);
+
+void quantileInit(QuantileSet *set, AlertKind kind);
+void quantileUpdate(QuantileSet *set, SampleHistory *history);
+const char *quantileName(const QuantileSet *set, int idx);
+void quantileLifetime(const QuantileSet *set, int idx, QuantileSummary *summary);
+void quantileRecent(const QuantileSet *set, int idx, QuantileSummary *summary);
+
+#endif // __QUANTILES_H_
@@ -0,0 +1,65 @@
+/*
+ * Ring buffer of recent samples kept for every monitor
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "samples.h"
+
+SampleHistory *historyCreate() {
+   SampleHistory *history = NULL;
+
+   if ((history = (SampleHistory *)calloc(1, sizeof (SampleHistory))) == NULL) {
+      perror("calloc failed");
+      exit(-1);
+   }
+
+   return history;
+}
+
+void historyDestroy(SampleHistory **history) {
+   if (*history != NULL && (*history)->chart != NULL) {
+      chartDestroy(&((*history)->chart));
+   }
+
+   free(*history);
+   *history = NULL;
+
+   return;
+}
+
+/*
+ * Return: the slot for the new sample (overwrites the oldest when full)
+ */
+Sample *historyPush(SampleHistory *history) {
+   Sample *slot = &(history->samples[history->next]);
+
+   history->next = (history->next + 1) % SAMPLE_HISTORY_LEN;
+   if (history->count < SAMPLE_HISTORY_LEN) {
+      history->count++;
+   }
+   history->total++;
+
+   return slot;
+}
+
+/*
+ * Note: idx 0 is the oldest sample still kept
+ */
+Sample *historyGet(SampleHistory *history, int idx) {
+   int start = 0;
+
+   if (idx < 0 || idx >= history->count) {
+      return NULL;
+   }
+
+   start = (history->next - history->count + SAMPLE_HISTORY_LEN) % SAMPLE_HISTORY_LEN;
+
+   return &(history->samples[(start + idx) % SAMPLE_HISTORY_LEN]);
+}
+
+Sample *historyLatest(SampleHistory *history) {
+   return historyGet(history, history->count - 1);
+}
@@ -0,0 +1,143 @@
+
+#ifndef __SAMPLES_H_
+#define __SAMPLES_H_
+
+#include "chart.h"
+
+#define SAMPLE_HISTORY_LEN 60
+#define MAX_EXE_LEN 64
+
+typedef struct {
+   long long timeUsec;
+   char state;
+   unsigned long long minorFaults;
+   unsigned long long majorFaults;
+   unsigned long long userTime;      // clock ticks
+   unsigned long long kernelTime;    // clock ticks
+   long long priority;
+   long long nice;
+   long long numThreads;
+   unsigned long long vsize;         // bytes
+   long long rss;                    // pages
+   unsigned long long program;       // statm, pages
+   unsigned long long residentSet;
+   unsigned long long share;
+   unsigned long long text;
+   unsigned long long data;
+   unsigned int fields;              // bit (1 << FieldId) per stat/statm field read
+   unsigned int providers;           // bit (1 << ProviderId) per provider read
+   unsigned int carried;             // of those, slow ones repeated from an earlier read
+   unsigned long long readChars;     // io
+   unsigned long long writeChars;
+   unsigned long long readCalls;
+   unsigned long long writeCalls;
+   unsigned long long readBytes;
+   unsigned long long writeBytes;
+   unsigned long long cancelledWriteBytes;
+   unsigned long long voluntaryCtxt;     // status
+   unsigned long long involuntaryCtxt;
+   unsigned long long runNsec;       // schedstat
+   unsigned long long waitNsec;
+   unsigned long long timeslices;
+   unsigned long long pss;           // smaps_rollup, kB
+   unsigned long long pssAnon;
+   unsigned long long pssFile;
+   unsigned long long pssShmem;
+   unsigned long long swap;
+   unsigned long long swapPss;
+   unsigned long long openFds;       // fd
+} ProcessSample;
+
+typedef struct {
+   long long timeUsec;
+   unsigned long long cpuUser;
+   unsigned long long cpuSystem;
+   unsigned long long cpuIdle;
+   unsigned long long cpuIowait;
+   unsigned long long cpuIrq;
+   unsigned long long cpuSoftirq;
+   unsigned long long intr;
+   unsigned long long ctxt;
+   unsigned long long forks;
+   unsigned long long runnable;
+   unsigned long long blocked;
+   unsigned long long memTotal;
+   unsigned long long memFree;
+   unsigned long long cached;
+   unsigned long long swapCached;
+   unsigned long long active;
+   unsigned long long inactive;
+   double load1;
+   double load5;
+   double load15;
+   unsigned long long diskReads;
+   unsigned long long diskSectorsRead;
+   unsigned long long diskMsRead;
+   unsigned long long diskWrites;
+   unsigned long long diskSectorsWritten;
+   unsigned long long diskMsWritten;
+   double diskBusy;                    // percent, busiest whole device
+   unsigned long long netRxBytes;
+   unsigned long long netRxPackets;
+   unsigned long long netRxErrors;
+   unsigned long long netRxDrops;
+   unsigned long long netTxBytes;
+   unsigned long long netTxPackets;
+   unsigned long long netTxErrors;
+   unsigned long long netTxDrops;
+   unsigned long long tcpRetransSegs;
+   unsigned long long psiCpuSome;      // usec some tasks stalled
+   unsigned long long psiMemorySome;
+   unsigned long long psiMemoryFull;   // usec all tasks stalled
+   unsigned long long psiIoSome;
+   unsigned long long psiIoFull;
+} SystemSample;
+
+typedef struct {
+   long long timeUsec;
+   unsigned long long usageUsec;       // cpu.stat
+   unsigned long long userUsec;
+   unsigned long long systemUsec;
+   unsigned long long nrPeriods;
+   unsigned long long nrThrottled;
+   unsigned long long throttledUsec;
+   unsigned long long memoryCurrent;   // bytes
+   unsigned long long anon;            // memory.stat, bytes
+   unsigned long long file;
+   unsigned long long kernel;
+   unsigned long long shmem;
+   unsigned long long pgfault;
+   unsigned long long pgmajfault;
+   unsigned long long ioReadBytes;     // io.stat, summed over the devices
+   unsigned long long ioWriteBytes;
+   unsigned long long ioReads;
+   unsigned long long ioWrites;
+   unsigned long long pidsCurrent;
+} CgroupSample;
+
+typedef union {
+   ProcessSample proc;
+   SystemSample sys;
+   CgroupSample cgroup;
+} Sample;
+
+/*
+ * Fixed size ring of the most recent samples of one monitor.  total counts
+ * every sample ever pushed so readers can tell which ones they have seen.
+ * chart (created on first use) keeps the downsampled whole-lifetime series.
+ */
+typedef struct {
+   int next;
+   int count;
+   unsigned long total;
+   Sample samples[SAMPLE_HISTORY_LEN];
+   ChartSeries *chart;
+} SampleHistory;
+
+SampleHistory *historyCreate();
+void historyDestroy(SampleHistory **history);
+Sample *historyPush(SampleHistory *history);
+Sample *historyGet(SampleHistory *history, int idx);
+Sample *historyLatest(SampleHistory *history);
+
+#endif // __SAMPLES_H_
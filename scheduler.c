@@ -0,0 +1,322 @@
+/*
+ * Hands out sampling slots to due ticks, by priority class and then earliest
+ * deadline first
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+
+#include "mond.h"
+#include "scheduler.h"
+#include "logLibrary.h"
+
+#define SCHEDULER_MAX_WAITERS (THREAD_TABLE_SIZE + 1)   // and the system thread
+
+int waiterBefore(const SchedulerWaiter *a, const SchedulerWaiter *b);
+void waiterPush(SchedulerWaiter *waiter);
+SchedulerWaiter *waiterPop();
+
+static const char *priorityNames[PRIORITIES] = { "normal", "critical", "bulk" };
+static const int priorityRanks[PRIORITIES] = { 1, 0, 2 };
+
+pthread_mutex_t schedulerMutex;
+int schedulerSlots = 0;       // ticks that may sample right now
+SchedulerWaiter *schedulerQueue[SCHEDULER_MAX_WAITERS];   // binary heap
+int schedulerWaiting = 0;
+unsigned long long schedulerSeq = 0;
+PriorityStats schedulerClasses[PRIORITIES];
+
+
+/*
+ * One tick samples per online cpu at a time, and never more than
+ * SCHEDULER_MAX_SLOTS; the rest queue.  There are at most
+ * SCHEDULER_MAX_WAITERS sampling threads, so slots for every cpu of a
+ * larger host would leave the queue (and its ordering) unused while mond
+ * spreads over that many cores.
+ */
+void initScheduler() {
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+   if (pthread_mutex_init(&schedulerMutex, NULL) != 0) {
+      perror("pthread_mutex_init failed");
+      exit(-1);
+   }
+
+   schedulerSlots = (cpus <= 0) ? 1 : (cpus > SCHEDULER_MAX_SLOTS) ? SCHEDULER_MAX_SLOTS : (int)cpus;
+   schedulerWaiting = 0;
+   memset(schedulerClasses, 0, sizeof (schedulerClasses));
+
+   return;
+}
+
+void destroyScheduler() {
+   if (pthread_mutex_destroy(&schedulerMutex) != 0) {
+      perror("pthread_mutex_destroy failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * Return: 0 if name is critical, normal or bulk, -1 otherwise
+ */
+int priorityParse(const char *name, PriorityClass *priority) {
+   int i = 0;
+
+   for (i = 0; i < PRIORITIES; i++) {
+      if (strcmp(name, priorityNames[i]) == 0) {
+         *priority = (PriorityClass)i;
+         return 0;
+      }
+   }
+
+   return -1;
+}
+
+const char *priorityName(PriorityClass priority) {
+   return priorityNames[priority];
+}
+
+/*
+ * Blocks until the tick due at dueUsec (0 for a first tick, which is never
+ * late) may sample, then counts how late it starts.  Every call must be
+ * followed by schedulerLeave once the tick is sampled.
+ */
+void schedulerEnter(PriorityClass priority, long long dueUsec, unsigned long interval) {
+   SchedulerWaiter waiter;
+   PriorityStats *stats = &(schedulerClasses[priority]);
+   long long lateness = 0;
+
+   /*
+    *  What threads use this critical section:
+    *    Every monitor thread (process, cgroup and system) at the start of
+    *    each tick.
+    *
+    *  What shared resources are being protected:
+    *    The free slots, the queue of waiting ticks and the class counters.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling and the
+    *    setup of the waiter) must use the shared resources and therefore,
+    *    must be locked.  A queued tick sleeps on its own condition variable,
+    *    which releases the mutex, and is woken alone when schedulerLeave
+    *    hands it a slot, so no thread spins or wakes for nothing.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex with a condition variable per waiter was used instead of a
+    *    counting semaphore because a semaphore wakes its waiters in no
+    *    particular order and the queue must be served by class and deadline.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&schedulerMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (schedulerSlots > 0 && schedulerWaiting == 0) {
+      schedulerSlots--;
+   } else {
+      waiter.rank = priorityRanks[priority];
+      waiter.dueUsec = dueUsec;
+      waiter.seq = schedulerSeq++;
+      waiter.granted = 0;
+      if (pthread_cond_init(&(waiter.cond), NULL) != 0) {
+         perror("pthread_cond_init failed");
+         exit(-1);
+      }
+
+      waiterPush(&waiter);
+      while (waiter.granted == 0) {
+         if (pthread_cond_wait(&(waiter.cond), &schedulerMutex) != 0) {
+            perror("pthread_cond_wait failed");
+            exit(-1);
+         }
+      }
+
+      if (pthread_cond_destroy(&(waiter.cond)) != 0) {
+         perror("pthread_cond_destroy failed");
+         exit(-1);
+      }
+   }
+
+   if (dueUsec != 0 && (lateness = currentTimeUsec() - dueUsec) < 0) {
+      lateness = 0;
+   }
+   stats->ticks++;
+   stats->latenessUsec += lateness;
+   if (dueUsec != 0 && lateness * 10 > (long long)interval) {
+      stats->late++;
+   }
+   if (lateness > stats->maxLatenessUsec) {
+      stats->maxLatenessUsec = lateness;
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&schedulerMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * Passes the slot straight to the first queued tick, if any
+ */
+void schedulerLeave() {
+   SchedulerWaiter *next = NULL;
+
+   // lock
+   if (pthread_mutex_lock(&schedulerMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if ((next = waiterPop()) != NULL) {
+      next->granted = 1;
+      if (pthread_cond_signal(&(next->cond)) != 0) {
+         perror("pthread_cond_signal failed");
+         exit(-1);
+      }
+   } else {
+      schedulerSlots++;
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&schedulerMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * Copies the counters of every class into stats[PRIORITIES]
+ */
+void schedulerStats(PriorityStats *stats) {
+   // lock
+   if (pthread_mutex_lock(&schedulerMutex) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   memcpy(stats, schedulerClasses, sizeof (schedulerClasses));
+
+   // unlock
+   if (pthread_mutex_unlock(&schedulerMutex) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * 'set align on': every monitor with the same interval wakes on the same
+ * wall clock multiple of it, so they share one wakeup, their ticks reach
+ * the queue together and their log lines carry comparable times.
+ *
+ * Return: the time (usec) of the next multiple of interval
+ */
+long long schedulerAlign(unsigned long interval) {
+   long long now = currentTimeUsec();
+
+   return (now / (long long)interval + 1) * (long long)interval;
+}
+
+/*
+ * Lets the kernel defer the wakeups of a bulk monitor by a tenth of its
+ * interval, so they coalesce with other timers, and keeps those of a
+ * critical one exact.  Applies to the calling thread.
+ */
+void schedulerSlack(PriorityClass priority, unsigned long interval) {
+   unsigned long slack = 0;
+
+   if (priority == PRIORITY_BULK) {
+      slack = (interval / 10 > SCHEDULER_MAX_SLACK / 1000) ? SCHEDULER_MAX_SLACK : interval / 10 * 1000;
+   } else if (priority == PRIORITY_CRITICAL) {
+      slack = 1;
+   } else {
+      return;
+   }
+
+   if (prctl(PR_SET_TIMERSLACK, slack, 0, 0, 0) == -1) {
+      perror("prctl failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+/*
+ * Return: 1 if a is served before b, 0 otherwise
+ */
+int waiterBefore(const SchedulerWaiter *a, const SchedulerWaiter *b) {
+   if (a->rank != b->rank) {
+      return (a->rank < b->rank) ? 1 : 0;
+   }
+   if (a->dueUsec != b->dueUsec) {
+      return (a->dueUsec < b->dueUsec) ? 1 : 0;
+   }
+
+   return (a->seq < b->seq) ? 1 : 0;
+}
+
+/*
+ * Must be called with the scheduler locked
+ */
+void waiterPush(SchedulerWaiter *waiter) {
+   int i = schedulerWaiting++;
+   int parent = 0;
+
+   while (i > 0 && waiterBefore(waiter, schedulerQueue[(parent = (i - 1) / 2)]) != 0) {
+      schedulerQueue[i] = schedulerQueue[parent];
+      i = parent;
+   }
+   schedulerQueue[i] = waiter;
+
+   return;
+}
+
+/*
+ * Must be called with the scheduler locked
+ *
+ * Return: the first waiter, NULL if none is queued
+ */
+SchedulerWaiter *waiterPop() {
+   SchedulerWaiter *first = NULL, *last = NULL;
+   int i = 0, child = 0;
+
+   if (schedulerWaiting == 0) {
+      return NULL;
+   }
+
+   first = schedulerQueue[0];
+   last = schedulerQueue[--schedulerWaiting];
+
+   while ((child = 2 * i + 1) < schedulerWaiting) {
+      if (child + 1 < schedulerWaiting && waiterBefore(schedulerQueue[child + 1], schedulerQueue[child]) != 0) {
+         child++;
+      }
+      if (waiterBefore(schedulerQueue[child], last) == 0) {
+         break;
+      }
+      schedulerQueue[i] = schedulerQueue[child];
+      i = child;
+   }
+   schedulerQueue[i] = last;
+
+   return first;
+}
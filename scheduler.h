@@ -0,0 +1,48 @@
+#ifndef __SCHEDULER_H_
+#define __SCHEDULER_H_
+
+#include <pthread.h>
+
+#define SCHEDULER_MAX_SLACK 100000000   // nsec, timer slack of a bulk monitor at most
+#define SCHEDULER_MAX_SLOTS 4           // ticks sampling at once, whatever the cpu count
+
+typedef enum {
+   PRIORITY_NORMAL = 0,
+   PRIORITY_CRITICAL = 1,
+   PRIORITY_BULK = 2,
+   PRIORITIES = 3
+} PriorityClass;
+
+/*
+ * How the ticks of one class kept to their schedule.  A tick is late when it
+ * starts sampling more than a tenth of its interval after it was due.
+ */
+typedef struct {
+   unsigned long long ticks;
+   unsigned long long late;
+   unsigned long long latenessUsec;   // summed over all ticks
+   long long maxLatenessUsec;
+} PriorityStats;
+
+/*
+ * A tick waiting for a sampling slot, on the stack of its monitor thread
+ */
+typedef struct {
+   int rank;                  // of its class, critical first
+   long long dueUsec;         // the deadline the queue is ordered by
+   unsigned long long seq;    // ties go to the one that came first
+   int granted;
+   pthread_cond_t cond;
+} SchedulerWaiter;
+
+void initScheduler();
+void destroyScheduler();
+int priorityParse(const char *name, PriorityClass *priority);
+const char *priorityName(PriorityClass priority);
+void schedulerEnter(PriorityClass priority, long long dueUsec, unsigned long interval);
+void schedulerLeave();
+void schedulerStats(PriorityStats *stats);
+long long schedulerAlign(unsigned long interval);
+void schedulerSlack(PriorityClass priority, unsigned long interval);
+
+#endif // __SCHEDULER_H_
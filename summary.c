@@ -0,0 +1,165 @@
+/*
+ * Lifetime summary of a monitor, carried into its completed record
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "summary.h"
+#include "fieldPlan.h"
+
+
+void summaryInit(MonitorSummary *summary, AlertKind kind) {
+   memset(summary, 0, sizeof (MonitorSummary));
+   summary->kind = kind;
+
+   return;
+}
+
+/*
+ * Folds the newest sample of history in.  interval is how long the monitor
+ * meant to sleep before it; a gap of more than one and a half intervals
+ * counts the ticks that never happened.  The caller holds the table row
+ * lock.
+ */
+void summaryUpdate(MonitorSummary *summary, SampleHistory *history, unsigned long interval) {
+   const Sample *now = NULL;
+   unsigned int cpu = FIELD_BIT(FIELD_UTIME) | FIELD_BIT(FIELD_STIME);
+   unsigned int faultFields = FIELD_BIT(FIELD_MINFLT) | FIELD_BIT(FIELD_MAJFLT);
+   unsigned long long memory = 0, cpuUsec = 0, faults = 0;
+   long long timeUsec = 0, gap = 0;
+
+   if (history == NULL || history->count == 0) {
+      return;
+   }
+
+   now = historyLatest(history);
+   timeUsec = alertSampleTime(summary->kind, now);
+
+   if (summary->samples != 0 && interval != 0 &&
+         (gap = timeUsec - summary->lastUsec) > (long long)interval * 3 / 2) {
+      summary->missedTicks += (gap + interval / 2) / interval - 1;
+   }
+
+   // the field plan of a monitor never changes, so neither does have
+   if (summary->kind == ALERT_PROCESS) {
+      summary->have = 0;
+      if ((now->proc.fields & FIELD_BIT(FIELD_RSS)) != 0) {
+         memory = (unsigned long long)now->proc.rss * sysconf(_SC_PAGESIZE);
+         summary->have |= SUMMARY_MEMORY;
+      } else if ((now->proc.fields & FIELD_BIT(FIELD_RESIDENT)) != 0) {
+         memory = now->proc.residentSet * sysconf(_SC_PAGESIZE);
+         summary->have |= SUMMARY_MEMORY;
+      }
+      if ((now->proc.fields & cpu) == cpu) {
+         cpuUsec = (now->proc.userTime + now->proc.kernelTime) * 1000000ULL / sysconf(_SC_CLK_TCK);
+         summary->have |= SUMMARY_CPU;
+      }
+      if ((now->proc.fields & faultFields) == faultFields) {
+         faults = now->proc.minorFaults + now->proc.majorFaults;
+         summary->have |= SUMMARY_FAULTS;
+      }
+   } else if (summary->kind == ALERT_CGROUP) {
+      memory = now->cgroup.memoryCurrent;
+      cpuUsec = now->cgroup.usageUsec;
+      faults = now->cgroup.pgfault;
+      summary->have = SUMMARY_MEMORY | SUMMARY_CPU | SUMMARY_FAULTS;
+   }
+
+   if (summary->samples == 0) {
+      summary->firstUsec = timeUsec;
+      summary->firstCpuUsec = cpuUsec;
+   }
+   if (memory > summary->peakMemory) {
+      summary->peakMemory = memory;
+   }
+   summary->cpuUsec = cpuUsec;
+   summary->faults = faults;
+   summary->lastUsec = timeUsec;
+   summary->samples++;
+
+   return;
+}
+
+void summaryReaped(MonitorSummary *summary, int status, const struct rusage *usage) {
+   summary->reaped = 1;
+   summary->exitStatus = status;
+   summary->usage = *usage;
+
+   return;
+}
+
+/*
+ * Return: cpu use between the first and last sample in percent of one cpu
+ */
+double summaryCpuPercent(const MonitorSummary *summary) {
+   if (summary->lastUsec <= summary->firstUsec) {
+      return 0.0;
+   }
+
+   return 100.0 * (summary->cpuUsec - summary->firstCpuUsec) / (summary->lastUsec - summary->firstUsec);
+}
+
+/*
+ * Prints the summary as indented rows of a listcompleted table
+ */
+void summaryPrint(FILE *out, const MonitorSummary *summary) {
+   fprintf(out, "|    samples %llu missed ticks %llu", summary->samples, summary->missedTicks);
+   if ((summary->have & SUMMARY_MEMORY) != 0) {
+      fprintf(out, " peak memory %llu", summary->peakMemory);
+   }
+   if ((summary->have & SUMMARY_CPU) != 0) {
+      fprintf(out, " cpu %.2fs (avg %.2f%%)", summary->cpuUsec / 1000000.0, summaryCpuPercent(summary));
+   }
+   if ((summary->have & SUMMARY_FAULTS) != 0) {
+      fprintf(out, " faults %llu", summary->faults);
+   }
+   fprintf(out, "\n");
+
+   if (summary->reaped != 0) {
+      if (WIFSIGNALED(summary->exitStatus)) {
+         fprintf(out, "|    killed by signal %d", WTERMSIG(summary->exitStatus));
+      } else {
+         fprintf(out, "|    exit code %d", WEXITSTATUS(summary->exitStatus));
+      }
+      fprintf(out, " user %ld.%06lds system %ld.%06lds maxrss %ld kB faults %ld/%ld ctxt %ld/%ld\n",
+            (long)summary->usage.ru_utime.tv_sec, (long)summary->usage.ru_utime.tv_usec,
+            (long)summary->usage.ru_stime.tv_sec, (long)summary->usage.ru_stime.tv_usec,
+            summary->usage.ru_maxrss, summary->usage.ru_minflt, summary->usage.ru_majflt,
+            summary->usage.ru_nvcsw, summary->usage.ru_nivcsw);
+   }
+
+   return;
+}
+
+/*
+ * Fills text with the values summaryPrint prints, for the webmon page
+ */
+void summaryFormat(const MonitorSummary *summary, SummaryText *text) {
+   snprintf(text->peakMemory, SUMMARY_TEXT_LEN, "-");
+   snprintf(text->cpu, SUMMARY_TEXT_LEN, "-");
+   snprintf(text->faults, SUMMARY_TEXT_LEN, "-");
+   snprintf(text->exit, SUMMARY_TEXT_LEN, "-");
+
+   if ((summary->have & SUMMARY_MEMORY) != 0) {
+      snprintf(text->peakMemory, SUMMARY_TEXT_LEN, "%llu", summary->peakMemory);
+   }
+   if ((summary->have & SUMMARY_CPU) != 0) {
+      snprintf(text->cpu, SUMMARY_TEXT_LEN, "%.2fs (avg %.2f%%)", summary->cpuUsec / 1000000.0,
+            summaryCpuPercent(summary));
+   }
+   if ((summary->have & SUMMARY_FAULTS) != 0) {
+      snprintf(text->faults, SUMMARY_TEXT_LEN, "%llu", summary->faults);
+   }
+   if (summary->reaped != 0 && WIFSIGNALED(summary->exitStatus)) {
+      snprintf(text->exit, SUMMARY_TEXT_LEN, "signal %d", WTERMSIG(summary->exitStatus));
+   } else if (summary->reaped != 0) {
+      snprintf(text->exit, SUMMARY_TEXT_LEN, "code %d", WEXITSTATUS(summary->exitStatus));
+   }
+
+   return;
+}
@@ -0,0 +1,57 @@
+#ifndef __SUMMARY_H_
+#define __SUMMARY_H_
+
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "samples.h"
+#include "alerts.h"
+
+#define SUMMARY_MEMORY 0x1
+#define SUMMARY_CPU 0x2
+#define SUMMARY_FAULTS 0x4
+#define SUMMARY_TEXT_LEN 48
+
+/*
+ * Lifetime totals of one monitor, kept up to date on every sample so the
+ * completed record answers "what was the peak" without reading the log.
+ * Memory, cpu and faults are the process' (rss, utime + stime, minflt +
+ * majflt) or the cgroup's (memory.current, usage_usec, pgfault); have
+ * says which of them the process' field plan collects.
+ */
+typedef struct {
+   AlertKind kind;
+   unsigned int have;                 // SUMMARY_* bits
+   unsigned long long samples;
+   unsigned long long missedTicks;    // intervals that passed without a sample
+   long long firstUsec;
+   long long lastUsec;
+   unsigned long long peakMemory;     // bytes
+   unsigned long long firstCpuUsec;   // cpu time used before the first sample
+   unsigned long long cpuUsec;        // total cpu time at the last sample
+   unsigned long long faults;         // total at the last sample
+
+   int reaped;                        // an 'add -e' child that was waited for
+   int exitStatus;                    // of wait4
+   struct rusage usage;
+} MonitorSummary;
+
+/*
+ * The cells of a completed row, "-" for what was not collected
+ */
+typedef struct {
+   char peakMemory[SUMMARY_TEXT_LEN];
+   char cpu[SUMMARY_TEXT_LEN];
+   char faults[SUMMARY_TEXT_LEN];
+   char exit[SUMMARY_TEXT_LEN];
+} SummaryText;
+
+void summaryInit(MonitorSummary *summary, AlertKind kind);
+void summaryUpdate(MonitorSummary *summary, SampleHistory *history, unsigned long interval);
+void summaryReaped(MonitorSummary *summary, int status, const struct rusage *usage);
+double summaryCpuPercent(const MonitorSummary *summary);
+void summaryPrint(FILE *out, const MonitorSummary *summary);
+void summaryFormat(const MonitorSummary *summary, SummaryText *text);
+
+#endif // __SUMMARY_H_
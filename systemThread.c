@@ -10,28 +10,106 @@
 #include "mond.h"
 #include "systemThread.h"
 #include "logLibrary.h"
+#include "governor.h"
+#include "scheduler.h"
+#include "eventStream.h"
+#include "diskStats.h"
+#include "cpuStats.h"
+#include "netStats.h"
+#include "psiStats.h"
+#include "keyedStats.h"
 #include "singlyLinkedList.h"
 
-void openSysFiles(int *fdStat, int *fdMem, int *fdLoad, int *fdDisk);
-void printSysLogs(FILE *fLogFile, int fdStat, int fdMem, int fdLoad, int fdDisk);
-void closeSysFiles(int fdStat, int fdMem, int fdLoad, int fdDisk);
+#define SYS_READ_LEN 65536
+
+// the meminfo fields every sample keeps, in the order of MemField
+#define MEMINFO_SAMPLE_FIELDS "MemTotal,MemFree,Cached,SwapCached,Active,Inactive"
+
+typedef enum {
+   MEM_TOTAL = 0,
+   MEM_FREE = 1,
+   MEM_CACHED = 2,
+   MEM_SWAP_CACHED = 3,
+   MEM_ACTIVE = 4,
+   MEM_INACTIVE = 5,
+   MEM_SAMPLE_FIELDS = 6
+} MemField;
+
+/*
+ * Sampler state the system thread keeps between ticks
+ */
+typedef struct {
+   int fdStat;
+   int fdMem;
+   int fdLoad;
+   int fdDisk;
+   int fdNet;
+   int fdSnmp;                // -1 when there is no net/snmp
+   int fdVm;
+   Buffer stat;
+   CpuStats cpus;
+   DiskStats disks;
+   NetStats nets;
+   PsiStats psi;
+   KeyedStats memory;
+   KeyedStats vm;
+} SystemStats;
+
+void openSysFiles(SystemStats *stats);
+void sampleSystem(ThreadTable *line, SystemStats *stats, SystemSample *sample);
+void chartSystem(SampleHistory *history, SystemSample *sample);
+unsigned long long keyedValue(const char *buf, const char *key);
+void printSysLogs(FILE *fLogFile, SystemSample *sample, SystemStats *stats);
+void waitSystem(ThreadTable *handle, SystemStats *stats, long sleepTime);
+void logPsiStall(ThreadTable *handle, SystemStats *stats, int fired);
+void closeSysFiles(SystemStats *stats);
 
 extern int systemThreadState;
 extern LinkedList *completedList;
+extern int alignTicks;
+extern DiskFilter diskFilter;
+extern float cpuThreshold;
+extern NetFilter netFilter;
+extern unsigned long psiStallUsec;
+extern unsigned long psiWindowUsec;
+extern char meminfoFields[MAX_INPUT_LEN];
+extern char vmstatFields[MAX_INPUT_LEN];
 
 
 void *systemThread(void *args) {
-   int fdStat = -1, fdMem = -1, fdLoad = -1, fdDisk = -1;
    int stop = 0;
    ThreadTable *threadTableLine = NULL;
    int value = -1;
    unsigned long sleepTime = -1;
+   long long cpuStart = 0;
+   long long dueUsec = 0;
+   PriorityClass priority = PRIORITY_NORMAL;
+   GovernorState governed = { 1.0, 0.0, 0.0 };
    struct timeval startTime, endTime;
    unsigned long offsetTime = -1;
+   SystemSample sample;
+   SystemStats stats;
 
    ThreadTable *threadTableHandle = (ThreadTable *)args;
 
-   openSysFiles(&fdStat, &fdMem, &fdLoad, &fdDisk);
+   // set before the thread starts and never changed
+   priority = threadTableHandle->priority;
+   schedulerSlack(priority, threadTableHandle->interval);
+
+   openSysFiles(&stats);
+   bufferInit(&(stats.stat));
+   cpuStatsInit(&(stats.cpus));
+   diskStatsInit(&(stats.disks));
+   netStatsInit(&(stats.nets));
+   psiStatsInit(&(stats.psi));
+   psiStatsArm(&(stats.psi), psiStallUsec, psiWindowUsec);
+   keyedStatsInit(&(stats.memory));
+   keyedStatsAddList(&(stats.memory), MEMINFO_SAMPLE_FIELDS);
+   keyedStatsAddList(&(stats.memory), meminfoFields);
+   keyedStatsBuild(&(stats.memory));
+   keyedStatsInit(&(stats.vm));
+   keyedStatsAddList(&(stats.vm), vmstatFields);
+   keyedStatsBuild(&(stats.vm));
 
    if ((threadTableLine = (ThreadTable *)calloc(1, sizeof (ThreadTable))) == NULL) {
       perror("calloc failed");
@@ -44,6 +122,8 @@ void *systemThread(void *args) {
          perror("gettimeofday failed");
          exit(-1);
       }
+      cpuStart = governorThreadCpu();
+      schedulerEnter(priority, dueUsec, sleepTime);
 
       /*
        *  What threads use this critical section:
@@ -108,7 +188,17 @@ void *systemThread(void *args) {
       }
 
       // critical section
-      printSysLogs(threadTableHandle->fTable->filep, fdStat, fdMem, fdLoad, fdDisk);
+      sampleSystem(threadTableHandle, &stats, &sample);
+      printSysLogs(threadTableHandle->fTable->filep, &sample, &stats);
+      alertEvaluate(threadTableHandle->alerts, threadTableHandle->fTable->filep, SYSTEM_THREAD_ID, NULL,
+            threadTableHandle->history);
+      anomalyEvaluate(threadTableHandle->anomalies, threadTableHandle->fTable->filep, SYSTEM_THREAD_ID, NULL,
+            threadTableHandle->history);
+      quantileUpdate(&(threadTableHandle->quantiles), threadTableHandle->history);
+      summaryUpdate(&(threadTableHandle->summary), threadTableHandle->history, sleepTime);
+      if (governorChanged(&governed) != 0) {
+         governorPrint(threadTableHandle->fTable->filep, &governed);
+      }
 
       // unlock inner
       if (pthread_mutex_unlock(&(threadTableHandle->fTable->mutex)) != 0) {
@@ -122,6 +212,11 @@ void *systemThread(void *args) {
          exit(-1);
       }
 
+      schedulerLeave();
+
+      // only this thread touches its alert state
+      alertActions(threadTableHandle->alerts, threadTableHandle->pid);
+
       /*
        *  What threads use this critical section:
        *    Only the system thread uses this critical section.
@@ -197,6 +292,7 @@ void *systemThread(void *args) {
          }
 
          // critical section
+         alertEnd(threadTableHandle->alerts, threadTableHandle->fTable->filep, SYSTEM_THREAD_ID, NULL);
          if (sem_wait(&(threadTableHandle->fTable->count)) == -1) {
             perror("sem_wait failed");
             exit(-1);
@@ -226,9 +322,17 @@ void *systemThread(void *args) {
          threadTableHandle->pid = 0;
          threadTableHandle->fTable = NULL;
          threadTableHandle->interval = 0;
+         threadTableHandle->priority = PRIORITY_NORMAL;
          threadTableHandle->startTime = 0;
          threadTableHandle->endTime = 0;
          threadTableHandle->endStatus = RUNNING;
+         threadTableHandle->executable[0] = '\0';
+         historyDestroy(&(threadTableHandle->history));
+         threadTableLine->history = NULL;
+         alertSetDestroy(&(threadTableHandle->alerts));
+         threadTableLine->alerts = NULL;
+         anomalySetDestroy(&(threadTableHandle->anomalies));
+         threadTableLine->anomalies = NULL;
 
          stop = 1;
       }
@@ -245,6 +349,9 @@ void *systemThread(void *args) {
          break;
       }
 
+      sleepTime = governorCharge(governorThreadCpu() - cpuStart, sleepTime, priority);
+      dueUsec = startTime.tv_sec * CONVERT_SEC_TO_USEC + startTime.tv_usec + sleepTime;
+
       if (gettimeofday(&endTime, NULL) == -1) {
          perror("gettimeofday failed");
          exit(-1);
@@ -253,11 +360,25 @@ void *systemThread(void *args) {
       offsetTime = (endTime.tv_sec * CONVERT_SEC_TO_USEC + endTime.tv_usec) -
          (startTime.tv_sec * CONVERT_SEC_TO_USEC + startTime.tv_usec);
 
-      // wait interval time
-      longSleep(sleepTime - offsetTime);
+      // wait interval time (woken early to log psi stalls)
+      if (alignTicks != 0) {
+         dueUsec = schedulerAlign(sleepTime);
+         waitSystem(threadTableHandle, &stats, dueUsec - currentTimeUsec());
+      } else {
+         waitSystem(threadTableHandle, &stats, sleepTime - offsetTime);
+      }
 
    }
 
+   closeSysFiles(&stats);
+   bufferFree(&(stats.stat));
+   cpuStatsDestroy(&(stats.cpus));
+   diskStatsDestroy(&(stats.disks));
+   netStatsDestroy(&(stats.nets));
+   psiStatsDestroy(&(stats.psi));
+   keyedStatsDestroy(&(stats.memory));
+   keyedStatsDestroy(&(stats.vm));
+
    threadTableLine->endTime = time(NULL);
 
    /*
@@ -303,81 +424,295 @@ void *systemThread(void *args) {
       exit(-1);
    }
 
+   // the list owns the copy from here on and never changes it
+   eventCompleted(threadTableLine);
+   eventFiles();
+
    systemThreadState = SYSTEM_THREAD_NOT_RUNNING;
 
    return NULL;
 }
 
-void openSysFiles(int *fdStat, int *fdMem, int *fdLoad, int *fdDisk) {
+void openSysFiles(SystemStats *stats) {
+
+   if ((stats->fdStat = open("/proc/stat", O_RDONLY)) == -1) {
+      perror("open failed");
+      exit(-1);
+   }
 
-   if ((*fdStat = open("/proc/stat", O_RDONLY)) == -1) {
+   if ((stats->fdMem = open("/proc/meminfo", O_RDONLY)) == -1) {
       perror("open failed");
       exit(-1);
    }
 
-   if ((*fdMem = open("/proc/meminfo", O_RDONLY)) == -1) {
+   if ((stats->fdLoad = open("/proc/loadavg", O_RDONLY)) == -1) {
       perror("open failed");
       exit(-1);
    }
 
-   if ((*fdLoad = open("/proc/loadavg", O_RDONLY)) == -1) {
+   if ((stats->fdDisk = open("/proc/diskstats", O_RDONLY)) == -1) {
       perror("open failed");
       exit(-1);
    }
 
-   if ((*fdDisk = open("/proc/diskstats", O_RDONLY)) == -1) {
+   if ((stats->fdNet = open("/proc/net/dev", O_RDONLY)) == -1) {
       perror("open failed");
       exit(-1);
    }
 
+   if ((stats->fdVm = open("/proc/vmstat", O_RDONLY)) == -1) {
+      perror("open failed");
+      exit(-1);
+   }
+
+   // the snmp counters are an extra, go on without them
+   stats->fdSnmp = open("/proc/net/snmp", O_RDONLY);
+
+   return;
+}
+
+/*
+ * Reads every system file once and records the values in the history.  The
+ * caller holds the systemThreadTable lock.
+ */
+void sampleSystem(ThreadTable *line, SystemStats *stats, SystemSample *sample) {
+   char buf[SYS_READ_LEN];
+   const char *cursor = NULL;
+   DiskCounters totals;
+   NetCounters netTotals;
+
+   memset(sample, 0, sizeof (SystemSample));
+   sample->timeUsec = currentTimeUsec();
+
+   // stat - the per cpu rows move everything after them, so look up by key
+   // (read whole, intr alone can pass 64k on large machines)
+   if (readProcBuffer(stats->fdStat, &(stats->stat)) > 0) {
+      cursor = skipFields(stats->stat.data, 1);
+      sample->cpuUser = parseUnsigned(&cursor);
+      cursor = skipFields(cursor, 1);
+      sample->cpuSystem = parseUnsigned(&cursor);
+      sample->cpuIdle = parseUnsigned(&cursor);
+      sample->cpuIowait = parseUnsigned(&cursor);
+      sample->cpuIrq = parseUnsigned(&cursor);
+      sample->cpuSoftirq = parseUnsigned(&cursor);
+      sample->intr = keyedValue(stats->stat.data, "intr");
+      sample->ctxt = keyedValue(stats->stat.data, "ctxt");
+      sample->forks = keyedValue(stats->stat.data, "processes");
+      sample->runnable = keyedValue(stats->stat.data, "procs_running");
+      sample->blocked = keyedValue(stats->stat.data, "procs_blocked");
+      cpuStatsUpdate(&(stats->cpus), stats->stat.data);
+   }
+
+   // meminfo and vmstat - by key, kernels add and reorder rows
+   if (keyedStatsUpdate(&(stats->memory), stats->fdMem, sample->timeUsec) == 0) {
+      sample->memTotal = stats->memory.fields[MEM_TOTAL].value;
+      sample->memFree = stats->memory.fields[MEM_FREE].value;
+      sample->cached = stats->memory.fields[MEM_CACHED].value;
+      sample->swapCached = stats->memory.fields[MEM_SWAP_CACHED].value;
+      sample->active = stats->memory.fields[MEM_ACTIVE].value;
+      sample->inactive = stats->memory.fields[MEM_INACTIVE].value;
+   }
+   keyedStatsUpdate(&(stats->vm), stats->fdVm, sample->timeUsec);
+
+   if (readProcFile(stats->fdLoad, buf, sizeof (buf)) > 0) {
+      cursor = buf;
+      sample->load1 = parseDouble(&cursor);
+      sample->load5 = parseDouble(&cursor);
+      sample->load15 = parseDouble(&cursor);
+   }
+
+   // diskstats - every device, the sample keeps the whole device totals
+   if (diskStatsUpdate(&(stats->disks), stats->fdDisk, sample->timeUsec) == 0) {
+      diskStatsTotals(&(stats->disks), &totals);
+      sample->diskReads = totals.reads;
+      sample->diskSectorsRead = totals.sectorsRead;
+      sample->diskMsRead = totals.msRead;
+      sample->diskWrites = totals.writes;
+      sample->diskSectorsWritten = totals.sectorsWritten;
+      sample->diskMsWritten = totals.msWritten;
+      sample->diskBusy = diskStatsBusiest(&(stats->disks));
+   }
+
+   // net/dev - every interface, the sample keeps the physical totals
+   if (netStatsUpdate(&(stats->nets), stats->fdNet, sample->timeUsec) == 0) {
+      netStatsTotals(&(stats->nets), &netTotals);
+      sample->netRxBytes = netTotals.rxBytes;
+      sample->netRxPackets = netTotals.rxPackets;
+      sample->netRxErrors = netTotals.rxErrors;
+      sample->netRxDrops = netTotals.rxDrops;
+      sample->netTxBytes = netTotals.txBytes;
+      sample->netTxPackets = netTotals.txPackets;
+      sample->netTxErrors = netTotals.txErrors;
+      sample->netTxDrops = netTotals.txDrops;
+   }
+   netStatsUpdateSnmp(&(stats->nets), stats->fdSnmp);
+   sample->tcpRetransSegs = stats->nets.snmp.tcpRetransSegs;
+
+   // pressure - the sample keeps the stall totals
+   psiStatsUpdate(&(stats->psi));
+   sample->psiCpuSome = stats->psi.some[PSI_CPU].total;
+   sample->psiMemorySome = stats->psi.some[PSI_MEMORY].total;
+   sample->psiMemoryFull = stats->psi.full[PSI_MEMORY].total;
+   sample->psiIoSome = stats->psi.some[PSI_IO].total;
+   sample->psiIoFull = stats->psi.full[PSI_IO].total;
+
+   if (line->history != NULL) {
+      Sample *slot = historyPush(line->history);
+      slot->sys = *sample;
+      chartSystem(line->history, sample);
+      eventSample(line, slot);
+   }
+
    return;
 }
 
-void printSysLogs(FILE *fLogFile, int fdStat, int fdMem, int fdLoad, int fdDisk) {
+/*
+ * Adds the load averages of the newest sample to the monitor's chart
+ */
+void chartSystem(SampleHistory *history, SystemSample *sample) {
+   float values[CHART_MAX_LINES] = { 0 };
+
+   if (history->chart == NULL) {
+      history->chart = chartCreate();
+   }
+
+   values[0] = (float)sample->load1;
+   values[1] = (float)sample->load5;
+   values[2] = (float)sample->load15;
+   chartPush(history->chart, sample->timeUsec, values);
+
+   return;
+}
+
+/*
+ * Return: the first value on the line starting with key, 0 if missing
+ */
+unsigned long long keyedValue(const char *buf, const char *key) {
+   const char *cursor = findLineByKey(buf, key);
+
+   if (cursor == NULL) {
+      return 0;
+   }
+
+   cursor = skipFields(cursor, 1);
+
+   return parseUnsigned(&cursor);
+}
+
+void printSysLogs(FILE *fLogFile, SystemSample *sample, SystemStats *stats) {
    char timeStr[MAX_TIME_LEN] = "";
 
    // log statistics
    fprintf(fLogFile, "[%s] System ", generateLogTime(timeStr));
-   fprintf(fLogFile, " [PROCESS]");
-   printQuery(fLogFile, fdStat, " cpuusermode", 0, 1);
-   printQuery(fLogFile, fdStat, " cpusystemmode", 0, 3);
-   printQuery(fLogFile, fdStat, " idletaskrunning", 0, 4);
-   printQuery(fLogFile, fdStat, " iowaittime", 0, 5);
-   printQuery(fLogFile, fdStat, " irqservicetime", 0, 6);
-   printQuery(fLogFile, fdStat, " softirqservicetime", 0, 7);
-   printQuery(fLogFile, fdStat, " intr", 2, 1);
-   printQuery(fLogFile, fdStat, " ctxt", 3, 1);
-   printQuery(fLogFile, fdStat, " forks", 5, 1);
-   printQuery(fLogFile, fdStat, " runnable", 6, 1);
-   printQuery(fLogFile, fdStat, " blocked", 7, 1);
-   fprintf(fLogFile, " [MEMORY]");
-   printQuery(fLogFile, fdMem, " memtotal", 0, 1);
-   printQuery(fLogFile, fdMem, " memfree", 1, 1);
-   printQuery(fLogFile, fdMem, " cached", 3, 1);
-   printQuery(fLogFile, fdMem, " swapcached", 4, 1);
-   printQuery(fLogFile, fdMem, " active", 5, 1);
-   printQuery(fLogFile, fdMem, " inactive", 6, 1);
-   fprintf(fLogFile, " [LOADAVG]");
-   printQuery(fLogFile, fdLoad, " 1min", 0, 0);
-   printQuery(fLogFile, fdLoad, " 5min", 0, 1);
-   printQuery(fLogFile, fdLoad, " 15min", 0, 2);
-   fprintf(fLogFile, " [DISKSTATS(sda)]");
-   printQuery(fLogFile, fdDisk, " totalnoreads", 16, 3);
-   printQuery(fLogFile, fdDisk, " totalsectorsread", 16, 5);
-   printQuery(fLogFile, fdDisk, " nomsread", 16, 6);
-   printQuery(fLogFile, fdDisk, " totalnowrites", 16, 7);
-   printQuery(fLogFile, fdDisk, " nosectorswritten", 16, 9);
-   printQuery(fLogFile, fdDisk, " nomswritten", 16, 10);
+   fprintf(fLogFile, " [PROCESS] cpuusermode %llu cpusystemmode %llu idletaskrunning %llu"
+         " iowaittime %llu irqservicetime %llu softirqservicetime %llu intr %llu"
+         " ctxt %llu forks %llu runnable %llu blocked %llu",
+         sample->cpuUser, sample->cpuSystem, sample->cpuIdle, sample->cpuIowait,
+         sample->cpuIrq, sample->cpuSoftirq, sample->intr, sample->ctxt,
+         sample->forks, sample->runnable, sample->blocked);
+   fprintf(fLogFile, " [MEMORY] memtotal %llu memfree %llu cached %llu swapcached %llu"
+         " active %llu inactive %llu",
+         sample->memTotal, sample->memFree, sample->cached, sample->swapCached,
+         sample->active, sample->inactive);
+   keyedStatsPrint(fLogFile, &(stats->memory), MEM_SAMPLE_FIELDS, 0);
+   if (stats->vm.count > 0) {
+      fprintf(fLogFile, " [VMSTAT]");
+      keyedStatsPrint(fLogFile, &(stats->vm), 0, 1);
+   }
+   fprintf(fLogFile, " [LOADAVG] 1min %.2f 5min %.2f 15min %.2f",
+         sample->load1, sample->load5, sample->load15);
+   cpuStatsPrint(fLogFile, &(stats->cpus), cpuThreshold);
+   diskStatsPrint(fLogFile, &(stats->disks), diskFilter);
+   netStatsPrint(fLogFile, &(stats->nets), netFilter);
+   psiStatsPrint(fLogFile, &(stats->psi));
    fprintf(fLogFile, "\n") ;
 
    return;
 }
 
-void closeSysFiles(int fdStat, int fdMem, int fdLoad, int fdDisk) {
-   close(fdStat);
-   close(fdMem);
-   close(fdLoad);
-   close(fdDisk);
+/*
+ * Sleeps sleepTime, logging a line for every psi trigger that fires on the
+ * way.  The stalls are between ticks so they are not part of the history.
+ */
+void waitSystem(ThreadTable *handle, SystemStats *stats, long sleepTime) {
+   long long deadline = currentTimeUsec() + sleepTime;
+   int fired = 0;
+
+   while (sleepTime > 0) {
+      if ((fired = psiStatsWait(&(stats->psi), sleepTime)) != 0) {
+         logPsiStall(handle, stats, fired);
+      }
+      sleepTime = deadline - currentTimeUsec();
+   }
+
+   return;
+}
+
+void logPsiStall(ThreadTable *handle, SystemStats *stats, int fired) {
+   char timeStr[MAX_TIME_LEN] = "";
+   FILE *fLogFile = NULL;
+   int i = 0;
+
+   psiStatsUpdate(&(stats->psi));
+
+   /*
+    *  What threads use this critical section:
+    *    Only the system thread uses this critical section.
+    *
+    *  What shared resources are being protected:
+    *    This thread's line of the fileTable is the only resource locked.
+    *    We lock the whole line of the fileTable, but are interested in
+    *    the file pointer.  The fileTable reference itself only changes
+    *    when this thread stops so the threadTable line is not locked.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except error handling) must
+    *    use the shared resources and therefore, must be locked.  The
+    *    kernel fires a trigger at most once per window, so this lock is
+    *    taken at most a few times a second on top of the ticks.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&(handle->fTable->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   fLogFile = handle->fTable->filep;
+   fprintf(fLogFile, "[%s] System  [PSISTALL]", generateLogTime(timeStr));
+   for (i = 0; i < PSI_RESOURCES; i++) {
+      if ((fired & (1 << i)) != 0) {
+         fprintf(fLogFile, " %s", psiResourceName((PsiResource)i));
+      }
+   }
+   psiStatsPrint(fLogFile, &(stats->psi));
+   fprintf(fLogFile, "\n");
+
+   // unlock
+   if (pthread_mutex_unlock(&(handle->fTable->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+void closeSysFiles(SystemStats *stats) {
+   close(stats->fdStat);
+   close(stats->fdMem);
+   close(stats->fdLoad);
+   close(stats->fdDisk);
+   close(stats->fdNet);
+   close(stats->fdVm);
+   if (stats->fdSnmp != -1) {
+      close(stats->fdSnmp);
+   }
 
    return;
 }
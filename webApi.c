@@ -0,0 +1,646 @@
+/*
+ * Machine readable JSON / NDJSON views of the monitors, streamed with
+ * chunked transfer encoding from the webmon http server.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+#include "mond.h"
+#include "webApi.h"
+#include "logLibrary.h"
+#include "processProviders.h"
+#include "singlyLinkedList.h"
+
+#define API_PARAM_LEN 32
+
+void apiChunkSink(void *ctx, const char *data, size_t len);
+void apiWriteRow(JsonWriter *w, ThreadTable *line, int completed);
+int apiWriteActive(JsonWriter *w, ThreadTable *line);
+void apiWriteCompleted(JsonWriter *w);
+void apiWriteFiles(JsonWriter *w);
+void apiWriteHistory(JsonWriter *w, ThreadTable *line, long limit);
+void apiWriteQuantiles(JsonWriter *w, QuantileSet *quantiles, int recent);
+void apiWriteSummary(JsonWriter *w, QuantileSummary *summary);
+void apiWriteLifetime(JsonWriter *w, MonitorSummary *summary);
+const char *apiEndStatus(TerminationStatus status);
+
+extern FileTable fileTable[FILE_TABLE_SIZE];
+extern ThreadTable threadTable[THREAD_TABLE_SIZE];
+extern ThreadTable systemThreadTable;
+extern int systemThreadState;
+extern LinkedList *completedList;
+
+
+void apiChunkSink(void *ctx, const char *data, size_t len) {
+   httpSendChunk((HttpConn *)ctx, data, len);
+
+   return;
+}
+
+/*
+ * GET /api/v1/monitors
+ *
+ * One JSON document with the system monitor, the active and completed
+ * tables (active rows carry their latest sample) and the file table.
+ */
+void apiMonitors(HttpConn *conn, HttpRequest *req) {
+   JsonWriter w;
+   int i = 0;
+
+   httpBeginStream(conn, req, 200, "application/json");
+   jsonInit(&w, apiChunkSink, conn);
+
+   jsonBeginObject(&w);
+   jsonFieldSigned(&w, "time", currentTimeUsec());
+
+   jsonKey(&w, "system");
+   if (systemThreadState != SYSTEM_THREAD_RUNNING || apiWriteActive(&w, &systemThreadTable) == 0) {
+      jsonNull(&w);
+   }
+
+   jsonKey(&w, "active");
+   jsonBeginArray(&w);
+   for (i = 0; i < THREAD_TABLE_SIZE; i++) {
+      apiWriteActive(&w, &(threadTable[i]));
+   }
+   jsonEndArray(&w);
+
+   jsonKey(&w, "completed");
+   apiWriteCompleted(&w);
+
+   jsonKey(&w, "files");
+   apiWriteFiles(&w);
+
+   jsonEndObject(&w);
+   jsonEndRecord(&w);
+
+   jsonFlush(&w);
+   httpEndStream(conn);
+
+   return;
+}
+
+/*
+ * GET /api/v1/samples[?pid=<pid>][&limit=<n>]
+ *
+ * NDJSON, one line per recorded sample of every active monitor (the system
+ * monitor uses pid -1, cgroup monitors -2), oldest first per monitor.
+ */
+void apiSamples(HttpConn *conn, HttpRequest *req) {
+   JsonWriter w;
+   char param[API_PARAM_LEN] = "";
+   long pid = 0, limit = SAMPLE_HISTORY_LEN;
+   int filter = 0;
+   int i = 0;
+
+   if (httpQueryParam(req->query, "pid", param, sizeof (param)) == 0) {
+      errno = 0;
+      pid = strtol(param, NULL, 10);
+      if (errno != 0 || pid == 0) {
+         httpRespond(conn, req, 400, "text/plain", "bad pid\n", 8);
+         return;
+      }
+      filter = 1;
+   }
+
+   if (httpQueryParam(req->query, "limit", param, sizeof (param)) == 0) {
+      errno = 0;
+      limit = strtol(param, NULL, 10);
+      if (errno != 0 || limit <= 0) {
+         httpRespond(conn, req, 400, "text/plain", "bad limit\n", 10);
+         return;
+      }
+   }
+
+   httpBeginStream(conn, req, 200, "application/x-ndjson");
+   jsonInit(&w, apiChunkSink, conn);
+
+   if (systemThreadState == SYSTEM_THREAD_RUNNING && (filter == 0 || pid == -1)) {
+      apiWriteHistory(&w, &systemThreadTable, limit);
+   }
+
+   for (i = 0; i < THREAD_TABLE_SIZE; i++) {
+      apiWriteHistory(&w, &(threadTable[i]), (filter == 0 || threadTable[i].pid == pid) ? limit : 0);
+   }
+
+   jsonFlush(&w);
+   httpEndStream(conn);
+
+   return;
+}
+
+/*
+ * Writes the fields shared by active and completed rows
+ */
+void apiWriteRow(JsonWriter *w, ThreadTable *line, int completed) {
+   jsonFieldUnsigned(w, "tid", (unsigned long)line->tid);
+   jsonFieldSigned(w, "pid", line->pid);
+   jsonFieldString(w, "type", (line->pid == SYSTEM_THREAD_ID) ? "system" :
+         (line->pid == CGROUP_THREAD_ID) ? "cgroup" : (line->isChild != 0) ? "exec" : "process");
+   if (line->pid == CGROUP_THREAD_ID) {
+      jsonFieldString(w, "cgroup", line->cgroup);
+   }
+   jsonFieldString(w, "executable", line->executable);
+   jsonFieldSigned(w, "startTime", line->startTime);
+   if (completed != 0) {
+      jsonFieldSigned(w, "endTime", line->endTime);
+      jsonFieldString(w, "endStatus", apiEndStatus(line->endStatus));
+   }
+   jsonFieldUnsigned(w, "interval", line->interval);
+   jsonFieldString(w, "priority", priorityName(line->priority));
+   if (line->minInterval != 0) {
+      jsonFieldUnsigned(w, "minInterval", line->minInterval);
+      jsonFieldUnsigned(w, "maxInterval", line->maxInterval);
+      jsonFieldUnsigned(w, "effectiveInterval", line->effectiveInterval);
+   }
+   jsonFieldString(w, "logFile", line->fileName);
+
+   jsonKey(w, "quantiles");
+   apiWriteQuantiles(w, &(line->quantiles), completed == 0);
+
+   jsonKey(w, "summary");
+   apiWriteLifetime(w, &(line->summary));
+
+   if (line->leak != NULL) {
+      jsonKey(w, "leak");
+      jsonBeginObject(w);
+      jsonFieldString(w, "metric", alertMetricName(line->leak->metric));
+      jsonFieldSigned(w, "windowUsec", line->leak->windowUsec);
+      if (line->leak->fitted != 0) {
+         jsonFieldDouble(w, "bytesPerHour", line->leak->slope);
+         jsonFieldDouble(w, "r2", line->leak->r2);
+         jsonFieldSigned(w, "leaking", line->leak->leaking);
+         if (line->leak->leaking != 0 && line->leak->oomHours >= 0.0) {
+            jsonFieldDouble(w, "oomHours", line->leak->oomHours);
+         }
+      }
+      jsonEndObject(w);
+   }
+
+   return;
+}
+
+/*
+ * The lifetime summary, with the wait4 result of a reaped 'add -e' child
+ */
+void apiWriteLifetime(JsonWriter *w, MonitorSummary *summary) {
+   jsonBeginObject(w);
+   jsonFieldUnsigned(w, "samples", summary->samples);
+   jsonFieldUnsigned(w, "missedTicks", summary->missedTicks);
+   if ((summary->have & SUMMARY_MEMORY) != 0) {
+      jsonFieldUnsigned(w, "peakMemory", summary->peakMemory);
+   }
+   if ((summary->have & SUMMARY_CPU) != 0) {
+      jsonFieldUnsigned(w, "cpuUsec", summary->cpuUsec);
+      jsonFieldDouble(w, "cpuPercent", summaryCpuPercent(summary));
+   }
+   if ((summary->have & SUMMARY_FAULTS) != 0) {
+      jsonFieldUnsigned(w, "faults", summary->faults);
+   }
+   if (summary->reaped != 0) {
+      if (WIFSIGNALED(summary->exitStatus)) {
+         jsonFieldSigned(w, "signal", WTERMSIG(summary->exitStatus));
+      } else {
+         jsonFieldSigned(w, "exitCode", WEXITSTATUS(summary->exitStatus));
+      }
+      jsonFieldUnsigned(w, "userUsec",
+            summary->usage.ru_utime.tv_sec * 1000000ULL + summary->usage.ru_utime.tv_usec);
+      jsonFieldUnsigned(w, "systemUsec",
+            summary->usage.ru_stime.tv_sec * 1000000ULL + summary->usage.ru_stime.tv_usec);
+      jsonFieldSigned(w, "maxRssKb", summary->usage.ru_maxrss);
+      jsonFieldSigned(w, "minorFaults", summary->usage.ru_minflt);
+      jsonFieldSigned(w, "majorFaults", summary->usage.ru_majflt);
+      jsonFieldSigned(w, "voluntaryCtxt", summary->usage.ru_nvcsw);
+      jsonFieldSigned(w, "involuntaryCtxt", summary->usage.ru_nivcsw);
+   }
+   jsonEndObject(w);
+
+   return;
+}
+
+/*
+ * {"<metric>": {"count", "p50", "p95", "p99", "max", "recent": {...}}, ...}
+ */
+void apiWriteQuantiles(JsonWriter *w, QuantileSet *quantiles, int recent) {
+   QuantileSummary summary;
+   int i = 0;
+
+   jsonBeginObject(w);
+   for (i = 0; i < quantiles->count; i++) {
+      jsonKey(w, quantileName(quantiles, i));
+      jsonBeginObject(w);
+      quantileLifetime(quantiles, i, &summary);
+      apiWriteSummary(w, &summary);
+      if (recent != 0) {
+         jsonKey(w, "recent");
+         jsonBeginObject(w);
+         quantileRecent(quantiles, i, &summary);
+         apiWriteSummary(w, &summary);
+         jsonEndObject(w);
+      }
+      jsonEndObject(w);
+   }
+   jsonEndObject(w);
+
+   return;
+}
+
+void apiWriteSummary(JsonWriter *w, QuantileSummary *summary) {
+   jsonFieldUnsigned(w, "count", summary->count);
+   jsonFieldDouble(w, "p50", summary->p50);
+   jsonFieldDouble(w, "p95", summary->p95);
+   jsonFieldDouble(w, "p99", summary->p99);
+   jsonFieldDouble(w, "max", summary->max);
+
+   return;
+}
+
+/*
+ * Return: 1 if the row is in use and was written, 0 otherwise
+ */
+int apiWriteActive(JsonWriter *w, ThreadTable *line) {
+   Sample *latest = NULL;
+   int written = 0;
+
+   /*
+    *  What threads use this critical section:
+    *    Only the webmon thread uses this critical section.
+    *
+    *  What shared resources are being protected:
+    *    The table row that is passed in is locked so that it cannot be
+    *    modified while we are serializing it and its latest sample.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section must use the shared resources
+    *    and therefore, must be locked.  Serializing only copies into the
+    *    writer buffer and queues on a non-blocking socket, so the owning
+    *    monitor thread waits at most a few microseconds.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (line->startTime != 0) {
+      jsonBeginObject(w);
+      apiWriteRow(w, line, 0);
+
+      if (line->history != NULL) {
+         jsonFieldUnsigned(w, "samples", line->history->total);
+         latest = historyLatest(line->history);
+      }
+
+      jsonKey(w, "latest");
+      if (latest == NULL) {
+         jsonNull(w);
+      } else {
+         apiWriteSample(w, line->pid, latest);
+      }
+
+      jsonEndObject(w);
+      written = 1;
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return written;
+}
+
+void apiWriteCompleted(JsonWriter *w) {
+   NodeEntry *cur = NULL;
+
+   jsonBeginArray(w);
+
+   /*
+    *  What threads use this critical section:
+    *    Only the webmon thread uses this critical section.
+    *
+    *  What shared resources are being protected:
+    *    The linked list of completed tasks is the only resource locked.
+    *
+    *  Line justification and performance concerns:
+    *    Every line in this critical section (except loop control flow) must
+    *    use the shared resources and therefore, must be locked.  The list is
+    *    walked by node instead of LLGet so a long list stays linear.  Only
+    *    exiting monitor threads would wait on it, which is of little concern
+    *    since they are dead.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&(completedList->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   for (cur = completedList->head; cur != NULL; cur = cur->next) {
+      jsonBeginObject(w);
+      apiWriteRow(w, (ThreadTable *)cur->data, 1);
+      jsonEndObject(w);
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&(completedList->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   jsonEndArray(w);
+
+   return;
+}
+
+void apiWriteFiles(JsonWriter *w) {
+   int value = 0;
+   int i = 0;
+
+   jsonBeginArray(w);
+
+   for (i = 0; i < FILE_TABLE_SIZE; i++) {
+      // lock
+      if (pthread_mutex_lock(&(fileTable[i].mutex)) != 0) {
+         perror("pthread_mutex_lock failed");
+         exit(-1);
+      }
+
+      // critical section
+      if (fileTable[i].dev != 0 && fileTable[i].inode != 0) {
+         if (sem_getvalue(&(fileTable[i].count), &value) == -1) {
+            perror("sem_getvalue failed");
+            exit(-1);
+         }
+
+         jsonBeginObject(w);
+         jsonFieldUnsigned(w, "dev", (unsigned long)fileTable[i].dev);
+         jsonFieldUnsigned(w, "inode", (unsigned long)fileTable[i].inode);
+         jsonFieldSigned(w, "count", value);
+         jsonEndObject(w);
+      }
+
+      // unlock
+      if (pthread_mutex_unlock(&(fileTable[i].mutex)) != 0) {
+         perror("pthread_mutex_unlock failed");
+         exit(-1);
+      }
+   }
+
+   jsonEndArray(w);
+
+   return;
+}
+
+/*
+ * Writes the last limit samples of one monitor, one NDJSON record each
+ */
+void apiWriteHistory(JsonWriter *w, ThreadTable *line, long limit) {
+   Sample *sample = NULL;
+   unsigned long seq = 0;
+   int first = 0;
+   int i = 0;
+
+   if (limit <= 0) {
+      return;
+   }
+
+   // lock
+   if (pthread_mutex_lock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (line->startTime != 0 && line->history != NULL) {
+      first = (line->history->count > limit) ? line->history->count - limit : 0;
+      seq = line->history->total - line->history->count;
+
+      for (i = first; i < line->history->count; i++) {
+         sample = historyGet(line->history, i);
+
+         jsonBeginObject(w);
+         jsonFieldUnsigned(w, "tid", (unsigned long)line->tid);
+         jsonFieldSigned(w, "pid", line->pid);
+         jsonFieldUnsigned(w, "seq", seq + i + 1);
+         jsonKey(w, "sample");
+         apiWriteSample(w, line->pid, sample);
+         jsonEndObject(w);
+         jsonEndRecord(w);
+      }
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+void apiWriteProcessSample(JsonWriter *w, ProcessSample *sample) {
+   char state[2] = "";
+
+   state[0] = sample->state;
+
+   jsonBeginObject(w);
+   jsonFieldSigned(w, "time", sample->timeUsec);
+   if ((sample->fields & FIELD_BIT(FIELD_STATE)) != 0) {
+      jsonFieldString(w, "state", state);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_MINFLT)) != 0) {
+      jsonFieldUnsigned(w, "minorFaults", sample->minorFaults);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_MAJFLT)) != 0) {
+      jsonFieldUnsigned(w, "majorFaults", sample->majorFaults);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_UTIME)) != 0) {
+      jsonFieldUnsigned(w, "userTime", sample->userTime);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_STIME)) != 0) {
+      jsonFieldUnsigned(w, "kernelTime", sample->kernelTime);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_PRIORITY)) != 0) {
+      jsonFieldSigned(w, "priority", sample->priority);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_NICE)) != 0) {
+      jsonFieldSigned(w, "nice", sample->nice);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_THREADS)) != 0) {
+      jsonFieldSigned(w, "threads", sample->numThreads);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_VSIZE)) != 0) {
+      jsonFieldUnsigned(w, "vsize", sample->vsize);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_RSS)) != 0) {
+      jsonFieldSigned(w, "rss", sample->rss);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_SIZE)) != 0) {
+      jsonFieldUnsigned(w, "program", sample->program);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_RESIDENT)) != 0) {
+      jsonFieldUnsigned(w, "residentSet", sample->residentSet);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_SHARED)) != 0) {
+      jsonFieldUnsigned(w, "share", sample->share);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_TEXT)) != 0) {
+      jsonFieldUnsigned(w, "text", sample->text);
+   }
+   if ((sample->fields & FIELD_BIT(FIELD_DATA)) != 0) {
+      jsonFieldUnsigned(w, "data", sample->data);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_IO)) != 0) {
+      jsonFieldUnsigned(w, "readChars", sample->readChars);
+      jsonFieldUnsigned(w, "writeChars", sample->writeChars);
+      jsonFieldUnsigned(w, "readCalls", sample->readCalls);
+      jsonFieldUnsigned(w, "writeCalls", sample->writeCalls);
+      jsonFieldUnsigned(w, "readBytes", sample->readBytes);
+      jsonFieldUnsigned(w, "writeBytes", sample->writeBytes);
+      jsonFieldUnsigned(w, "cancelledWriteBytes", sample->cancelledWriteBytes);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_STATUS)) != 0) {
+      jsonFieldUnsigned(w, "voluntaryCtxt", sample->voluntaryCtxt);
+      jsonFieldUnsigned(w, "involuntaryCtxt", sample->involuntaryCtxt);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_SCHED)) != 0) {
+      jsonFieldUnsigned(w, "runNsec", sample->runNsec);
+      jsonFieldUnsigned(w, "waitNsec", sample->waitNsec);
+      jsonFieldUnsigned(w, "timeslices", sample->timeslices);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_SMAPS)) != 0) {
+      jsonFieldUnsigned(w, "pss", sample->pss);
+      jsonFieldUnsigned(w, "pssAnon", sample->pssAnon);
+      jsonFieldUnsigned(w, "pssFile", sample->pssFile);
+      jsonFieldUnsigned(w, "pssShmem", sample->pssShmem);
+      jsonFieldUnsigned(w, "swap", sample->swap);
+      jsonFieldUnsigned(w, "swapPss", sample->swapPss);
+   }
+   if ((sample->providers & PROVIDER_BIT(PROVIDER_FDS)) != 0) {
+      jsonFieldUnsigned(w, "openFds", sample->openFds);
+   }
+   if (sample->carried != 0) {
+      jsonFieldUnsigned(w, "carried", sample->carried);
+   }
+   jsonEndObject(w);
+
+   return;
+}
+
+void apiWriteSystemSample(JsonWriter *w, SystemSample *sample) {
+   jsonBeginObject(w);
+   jsonFieldSigned(w, "time", sample->timeUsec);
+   jsonFieldUnsigned(w, "cpuUser", sample->cpuUser);
+   jsonFieldUnsigned(w, "cpuSystem", sample->cpuSystem);
+   jsonFieldUnsigned(w, "cpuIdle", sample->cpuIdle);
+   jsonFieldUnsigned(w, "cpuIowait", sample->cpuIowait);
+   jsonFieldUnsigned(w, "cpuIrq", sample->cpuIrq);
+   jsonFieldUnsigned(w, "cpuSoftirq", sample->cpuSoftirq);
+   jsonFieldUnsigned(w, "intr", sample->intr);
+   jsonFieldUnsigned(w, "ctxt", sample->ctxt);
+   jsonFieldUnsigned(w, "forks", sample->forks);
+   jsonFieldUnsigned(w, "runnable", sample->runnable);
+   jsonFieldUnsigned(w, "blocked", sample->blocked);
+   jsonFieldUnsigned(w, "memTotal", sample->memTotal);
+   jsonFieldUnsigned(w, "memFree", sample->memFree);
+   jsonFieldUnsigned(w, "cached", sample->cached);
+   jsonFieldUnsigned(w, "swapCached", sample->swapCached);
+   jsonFieldUnsigned(w, "active", sample->active);
+   jsonFieldUnsigned(w, "inactive", sample->inactive);
+   jsonFieldDouble(w, "load1", sample->load1);
+   jsonFieldDouble(w, "load5", sample->load5);
+   jsonFieldDouble(w, "load15", sample->load15);
+   jsonFieldUnsigned(w, "diskReads", sample->diskReads);
+   jsonFieldUnsigned(w, "diskSectorsRead", sample->diskSectorsRead);
+   jsonFieldUnsigned(w, "diskMsRead", sample->diskMsRead);
+   jsonFieldUnsigned(w, "diskWrites", sample->diskWrites);
+   jsonFieldUnsigned(w, "diskSectorsWritten", sample->diskSectorsWritten);
+   jsonFieldUnsigned(w, "diskMsWritten", sample->diskMsWritten);
+   jsonFieldUnsigned(w, "netRxBytes", sample->netRxBytes);
+   jsonFieldUnsigned(w, "netRxPackets", sample->netRxPackets);
+   jsonFieldUnsigned(w, "netRxErrors", sample->netRxErrors);
+   jsonFieldUnsigned(w, "netRxDrops", sample->netRxDrops);
+   jsonFieldUnsigned(w, "netTxBytes", sample->netTxBytes);
+   jsonFieldUnsigned(w, "netTxPackets", sample->netTxPackets);
+   jsonFieldUnsigned(w, "netTxErrors", sample->netTxErrors);
+   jsonFieldUnsigned(w, "netTxDrops", sample->netTxDrops);
+   jsonFieldUnsigned(w, "tcpRetransSegs", sample->tcpRetransSegs);
+   jsonFieldUnsigned(w, "psiCpuSome", sample->psiCpuSome);
+   jsonFieldUnsigned(w, "psiMemorySome", sample->psiMemorySome);
+   jsonFieldUnsigned(w, "psiMemoryFull", sample->psiMemoryFull);
+   jsonFieldUnsigned(w, "psiIoSome", sample->psiIoSome);
+   jsonFieldUnsigned(w, "psiIoFull", sample->psiIoFull);
+   jsonEndObject(w);
+
+   return;
+}
+
+void apiWriteCgroupSample(JsonWriter *w, CgroupSample *sample) {
+   jsonBeginObject(w);
+   jsonFieldSigned(w, "time", sample->timeUsec);
+   jsonFieldUnsigned(w, "usageUsec", sample->usageUsec);
+   jsonFieldUnsigned(w, "userUsec", sample->userUsec);
+   jsonFieldUnsigned(w, "systemUsec", sample->systemUsec);
+   jsonFieldUnsigned(w, "nrPeriods", sample->nrPeriods);
+   jsonFieldUnsigned(w, "nrThrottled", sample->nrThrottled);
+   jsonFieldUnsigned(w, "throttledUsec", sample->throttledUsec);
+   jsonFieldUnsigned(w, "memoryCurrent", sample->memoryCurrent);
+   jsonFieldUnsigned(w, "anon", sample->anon);
+   jsonFieldUnsigned(w, "file", sample->file);
+   jsonFieldUnsigned(w, "kernel", sample->kernel);
+   jsonFieldUnsigned(w, "shmem", sample->shmem);
+   jsonFieldUnsigned(w, "pgfault", sample->pgfault);
+   jsonFieldUnsigned(w, "pgmajfault", sample->pgmajfault);
+   jsonFieldUnsigned(w, "ioReadBytes", sample->ioReadBytes);
+   jsonFieldUnsigned(w, "ioWriteBytes", sample->ioWriteBytes);
+   jsonFieldUnsigned(w, "ioReads", sample->ioReads);
+   jsonFieldUnsigned(w, "ioWrites", sample->ioWrites);
+   jsonFieldUnsigned(w, "pidsCurrent", sample->pidsCurrent);
+   jsonEndObject(w);
+
+   return;
+}
+
+/*
+ * Writes a sample of a monitor, the pid of the monitor tells its kind
+ */
+void apiWriteSample(JsonWriter *w, pid_t pid, Sample *sample) {
+   if (pid == SYSTEM_THREAD_ID) {
+      apiWriteSystemSample(w, &(sample->sys));
+   } else if (pid == CGROUP_THREAD_ID) {
+      apiWriteCgroupSample(w, &(sample->cgroup));
+   } else {
+      apiWriteProcessSample(w, &(sample->proc));
+   }
+
+   return;
+}
+
+const char *apiEndStatus(TerminationStatus status) {
+   switch (status) {
+      case KILLED: return "killed";
+      case STOPPED: return "stopped";
+      case EXITED: return "exited";
+      default: return "running";
+   }
+}
@@ -0,0 +1,22 @@
+
+#ifndef __WEB_API_H_
+#define __WEB_API_H_
+
+#include <sys/types.h>
+
+#include "httpServer.h"
+#include "jsonWriter.h"
+#include "samples.h"
+
+#define API_MONITORS_PATH "/api/v1/monitors"
+#define API_SAMPLES_PATH "/api/v1/samples"
+
+void apiMonitors(HttpConn *conn, HttpRequest *req);
+void apiSamples(HttpConn *conn, HttpRequest *req);
+
+void apiWriteProcessSample(JsonWriter *w, ProcessSample *sample);
+void apiWriteSystemSample(JsonWriter *w, SystemSample *sample);
+void apiWriteCgroupSample(JsonWriter *w, CgroupSample *sample);
+void apiWriteSample(JsonWriter *w, pid_t pid, Sample *sample);
+
+#endif // __WEB_API_H_
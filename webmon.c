@@ -1,4 +1,3 @@
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,24 +6,53 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "mond.h"
 #include "webmon.h"
+#include "webApi.h"
+#include "promExport.h"
+#include "eventStream.h"
+#include "htmlTemplate.h"
+#include "chart.h"
+#include "buffer.h"
 #include "logLibrary.h"
 #include "singlyLinkedList.h"
 
-#define GRAPH_HISTORY_LEN 10
-
-void webmonHeader(FILE *file, int refreshSec, LinkedList *loadList);
-void webmonSettings(FILE *file, int intervalSec, int refreshSec);
-void webmonActiveThreads(FILE *file);
-void webmonCompletedThreads(FILE *file);
-void webmonFileTable(FILE *file);
-void webmonGraph(FILE *file);
-void webmonFooter(FILE *file);
-void printRunningWebmon(FILE *file, ThreadTable *line);
-void updateLoadList(LinkedList *loadList);
-char *generateWebmonTime(time_t *timep, char *timeStr);
+#define CHART_WIDTH 900
+#define CHART_HEIGHT 220
+#define PROCESS_CHART_WIDTH 450
+#define PROCESS_CHART_HEIGHT 180
+#define CONVERT_SEC_TO_MSEC 1000
+
+typedef struct {
+   WebmonParams params;
+   Buffer page;
+   Buffer charts;
+   TimeCache times;
+   PromCache prom;
+   time_t lastPing;
+} WebmonState;
+
+void webmonFileLoop(WebmonState *state);
+void webmonServerLoop(WebmonState *state);
+void webmonRender(WebmonState *state);
+void webmonWriteFile(WebmonState *state);
+long long webmonNowMsec();
+void webmonHeader(WebmonState *state, int live, unsigned long liveSeq);
+void webmonSettings(WebmonState *state, int live);
+void webmonActiveThreads(WebmonState *state);
+void webmonCompletedThreads(WebmonState *state);
+void webmonFileTable(WebmonState *state);
+void webmonGraph(WebmonState *state);
+void webmonFooter(WebmonState *state);
+void printRunningWebmon(WebmonState *state, ThreadTable *line);
+void webmonAppendPid(Buffer *page, pid_t pid);
+char *generateSampleSummary(ThreadTable *line, char *summary);
+void webmonCharts(WebmonState *state);
+void printProcessCharts(WebmonState *state, ThreadTable *line);
+void printSystemChart(WebmonState *state);
 
 extern FileTable fileTable[FILE_TABLE_SIZE];
 extern ThreadTable threadTable[THREAD_TABLE_SIZE];
@@ -32,39 +60,334 @@ extern ThreadTable systemThreadTable;
 extern int systemThreadState;
 extern LinkedList *completedList;
 
+/*
+ * Page templates, each row is the static html around its slots (see
+ * htmlTemplate.h).  Values are listed next to the template that uses them.
+ */
+
+static const Fragment headTemplate[] = {
+   FRAGMENT("\n\
+<html>\n\
+   <head>\n\
+      <title>System Monitor - Web Extension</title>\n", SLOT_END)
+};
+
+// refreshSec
+static const Fragment refreshTemplate[] = {
+   FRAGMENT("\
+      <meta http-equiv=\"refresh\" content=\"", SLOT_SIGNED),
+   FRAGMENT("\">\n", SLOT_END)
+};
+
+// events path, sequence the page was rendered at, charts path, interval (ms)
+static const Fragment liveTemplate[] = {
+   FRAGMENT("\
+      <script type=\"text/javascript\">\n\
+      var source = new EventSource('", SLOT_RAW),
+   FRAGMENT("?since=", SLOT_UNSIGNED),
+   FRAGMENT("');\n\
+      setInterval(function () {\n\
+         fetch('", SLOT_RAW),
+   FRAGMENT("').then(function (r) { return r.text(); }).then(function (t) {\n\
+            document.getElementById('charts').innerHTML = t;\n\
+         });\n\
+      }, ", SLOT_SIGNED),
+   FRAGMENT(");\n\
+      function addCell(row, text) { row.insertCell(-1).textContent = text; }\n\
+      function summary(d) {\n\
+         var s = d.sample;\n\
+         var t = new Date(s.time / 1000).toLocaleTimeString();\n\
+         if (d.pid == -2) { return t + ' memory ' + s.memoryCurrent + ' cpu ' + s.usageUsec; }\n\
+         return (d.pid == -1) ? t + ' load ' + s.load1 : t + ' rss ' + s.rss + ' cpu ' + (s.userTime + s.kernelTime);\n\
+      }\n\
+      source.addEventListener('sample', function (e) {\n\
+         var d = JSON.parse(e.data);\n\
+         var cell = document.getElementById('last-' + d.tid);\n\
+         if (cell) { cell.textContent = summary(d); }\n\
+      });\n\
+      source.addEventListener('added', function (e) {\n\
+         var d = JSON.parse(e.data);\n\
+         if (document.getElementById('row-' + d.tid)) { return; }\n\
+         var row = document.getElementById('active').insertRow(-1);\n\
+         row.id = 'row-' + d.tid;\n\
+         addCell(row, d.tid);\n\
+         addCell(row, (d.pid == -1) ? 'system' : (d.pid == -2) ? 'cgroup' : d.pid);\n\
+         addCell(row, new Date(d.startTime * 1000).toString());\n\
+         addCell(row, d.interval);\n\
+         addCell(row, d.logFile);\n\
+         row.insertCell(-1).id = 'last-' + d.tid;\n\
+      });\n\
+      source.addEventListener('completed', function (e) {\n\
+         var d = JSON.parse(e.data);\n\
+         var old = document.getElementById('row-' + d.tid);\n\
+         if (old) { old.parentNode.removeChild(old); }\n\
+         if (document.getElementById('done-' + d.tid + '-' + d.endTime)) { return; }\n\
+         var row = document.getElementById('completed').insertRow(-1);\n\
+         row.id = 'done-' + d.tid + '-' + d.endTime;\n\
+         addCell(row, d.tid);\n\
+         addCell(row, (d.pid == -1) ? 'system' : (d.pid == -2) ? 'cgroup' : d.pid);\n\
+         addCell(row, new Date(d.startTime * 1000).toString());\n\
+         addCell(row, new Date(d.endTime * 1000).toString());\n\
+         addCell(row, d.endStatus);\n\
+         addCell(row, d.interval);\n\
+         addCell(row, d.logFile);\n\
+         addCell(row, d.samples);\n\
+         addCell(row, d.missedTicks);\n\
+         addCell(row, d.peakMemory);\n\
+         addCell(row, d.cpu);\n\
+         addCell(row, d.faults);\n\
+         addCell(row, d.exit);\n\
+      });\n\
+      source.addEventListener('files', function (e) {\n\
+         var table = document.getElementById('files');\n\
+         while (table.rows.length > 1) { table.deleteRow(1); }\n\
+         JSON.parse(e.data).forEach(function (f) {\n\
+            var row = table.insertRow(-1);\n\
+            addCell(row, f.dev);\n\
+            addCell(row, f.inode);\n\
+            addCell(row, f.count);\n\
+         });\n\
+      });\n\
+      source.addEventListener('reset', function () { location.reload(); });\n\
+      </script>\n", SLOT_END)
+};
+
+static const Fragment bodyTemplate[] = {
+   FRAGMENT("\
+   </head>\n\
+   <body>\n\
+      <h2>\n\
+         System Monitor - Web Extension\n\
+      </h2>\n\
+      <p>\n\
+         By Douglas Brandt & Kerry S.\n\
+      </p>\n\
+      ", SLOT_END)
+};
+
+// intervalSec, html refresh rate
+static const Fragment settingsTemplate[] = {
+   FRAGMENT("\n\
+      <h3>\n\
+         Settings\n\
+      </h3>\n\
+      <ul>\n\
+         <li>\n\
+            webmon refresh rate = ", SLOT_SIGNED),
+   FRAGMENT(" seconds\n\
+         </li>\n\
+         <li>\n\
+            html refresh rate = ", SLOT_RAW),
+   FRAGMENT("\n\
+         </li>\n\
+      </ul>\n", SLOT_END)
+};
+
+static const Fragment activeHeadTemplate[] = {
+   FRAGMENT("\n\
+      <h3>\n\
+         Active Threads\n\
+      </h3>\n\
+      <table id=\"active\" border=\"1\", cellpadding=\"2\">\n\
+         <tr>\n\
+            <td>Thread Id</td>\n\
+            <td>Process Id</td>\n\
+            <td>Start Time</td>\n\
+            <td>Interval (&#956sec)</td>\n\
+            <td>Log File</td>\n\
+            <td>Last Sample</td>\n\
+         </tr>\n", SLOT_END)
+};
+
+// tid, tid (followed by the pid)
+static const Fragment activeRowHeadTemplate[] = {
+   FRAGMENT("\
+         <tr id=\"row-", SLOT_UNSIGNED),
+   FRAGMENT("\">\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_END)
+};
+
+// start time, interval, log file, tid, last sample
+static const Fragment activeRowTailTemplate[] = {
+   FRAGMENT("</td>\n\
+            <td>", SLOT_TIME),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_TEXT),
+   FRAGMENT("</td>\n\
+            <td id=\"last-", SLOT_UNSIGNED),
+   FRAGMENT("\">", SLOT_TEXT),
+   FRAGMENT("</td>\n\
+         </tr>\n", SLOT_END)
+};
+
+static const Fragment completedHeadTemplate[] = {
+   FRAGMENT("\n\
+      <h3>\n\
+         Completed Threads\n\
+      </h3>\n\
+      <table id=\"completed\" border=\"1\", cellpadding=\"2\">\n\
+         <tr>\n\
+            <td>Thread Id</td>\n\
+            <td>Process Id</td>\n\
+            <td>Start Time</td>\n\
+            <td>End Time</td>\n\
+            <td>End Status</td>\n\
+            <td>Interval (&#956sec)</td>\n\
+            <td>Log File</td>\n\
+            <td>Samples</td>\n\
+            <td>Missed Ticks</td>\n\
+            <td>Peak Memory (bytes)</td>\n\
+            <td>CPU</td>\n\
+            <td>Faults</td>\n\
+            <td>Exit</td>\n\
+         </tr>\n", SLOT_END)
+};
+
+// tid, end time (as the id), tid (followed by the pid)
+static const Fragment completedRowHeadTemplate[] = {
+   FRAGMENT("\
+         <tr id=\"done-", SLOT_UNSIGNED),
+   FRAGMENT("-", SLOT_SIGNED),
+   FRAGMENT("\">\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_END)
+};
+
+// start time, end time, end status, interval, log file, samples, missed
+// ticks, peak memory, cpu, faults, exit
+static const Fragment completedRowTailTemplate[] = {
+   FRAGMENT("</td>\n\
+            <td>", SLOT_TIME),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_TIME),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_RAW),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_TEXT),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_RAW),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_RAW),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_RAW),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_RAW),
+   FRAGMENT("</td>\n\
+         </tr>\n", SLOT_END)
+};
+
+static const Fragment filesHeadTemplate[] = {
+   FRAGMENT("\n\
+      <h3>\n\
+         File Table\n\
+      </h3>\n\
+      <table id=\"files\" border=\"1\", cellpadding=\"2\">\n\
+         <tr>\n\
+            <td>Device Id</td>\n\
+            <td>Inode Id</td>\n\
+            <td>Count</td>\n\
+         </tr>\n", SLOT_END)
+};
+
+// dev, inode, count
+static const Fragment filesRowTemplate[] = {
+   FRAGMENT("\
+         <tr>\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_UNSIGNED),
+   FRAGMENT("</td>\n\
+            <td>", SLOT_SIGNED),
+   FRAGMENT("</td>\n\
+         </tr>\n", SLOT_END)
+};
+
+// (followed by the charts)
+static const Fragment graphTemplate[] = {
+   FRAGMENT("\n\
+      <h3> Utilization Graph</h3>\n\
+      <div id=\"charts\">\n", SLOT_END)
+};
+
+static const Fragment graphEndTemplate[] = {
+   FRAGMENT("\
+      </div>", SLOT_END)
+};
+
+// process id, executable
+static const Fragment processChartsTemplate[] = {
+   FRAGMENT("\
+      <h4>Process ", SLOT_SIGNED),
+   FRAGMENT(" ", SLOT_TEXT),
+   FRAGMENT("</h4>\n", SLOT_END)
+};
+
+static const Fragment cgroupChartsTemplate[] = {
+   FRAGMENT("\
+      <h4>Cgroup ", SLOT_TEXT),
+   FRAGMENT("</h4>\n", SLOT_END)
+};
+
+static const Fragment tableEndTemplate[] = {
+   FRAGMENT("\
+      </table>", SLOT_END)
+};
+
+static const Fragment footerTemplate[] = {
+   FRAGMENT("\n\
+   </body>\n\
+</html>\n", SLOT_END)
+};
+
 void *webmonThread(void *args) {
-   WebmonParams webmonParams;
-   FILE *file = NULL;
-   LinkedList *loadList = NULL;
+   WebmonState state;
 
-   memcpy(&webmonParams, args, sizeof (WebmonParams));
+   memset(&state, 0, sizeof (WebmonState));
+   memcpy(&(state.params), args, sizeof (WebmonParams));
    free(args);
    args = NULL;
 
-   InitLL(&loadList);
+   bufferInit(&(state.page));
+   timeCacheInit(&(state.times));
 
-   while (1) {
-      if ((file = fopen(webmonParams.file, "w")) == NULL) {
-         perror("fopen failed");
-         exit(-1);
-      }
+   bufferInit(&(state.charts));
 
-      updateLoadList(loadList);
+   if (state.params.server != NULL) {
+      state.params.server->ctx = &state;
+      promInit(&(state.prom));
+      webmonServerLoop(&state);
+      promDestroy(&(state.prom));
+   } else {
+      webmonFileLoop(&state);
+   }
 
-      webmonHeader(file, webmonParams.refreshSec, loadList);
-      webmonSettings(file, webmonParams.intervalSec, webmonParams.refreshSec);
-      webmonActiveThreads(file);
-      webmonCompletedThreads(file);
-      webmonFileTable(file);
-      webmonGraph(file);
-      webmonFooter(file);
+   bufferFree(&(state.page));
+   bufferFree(&(state.charts));
 
-      if (fclose(file) != 0) {
-         perror("fclose failed");
-         exit(-1);
-      }
+   return NULL;
+}
 
-      if (sleep(webmonParams.intervalSec) == -1) {
+/*
+ * Regenerates the html file every intervalSec for an external web server
+ */
+void webmonFileLoop(WebmonState *state) {
+
+   while (1) {
+      webmonRender(state);
+      webmonWriteFile(state);
+
+      if (sleep(state->params.intervalSec) == -1) {
          if (errno != EINTR) {
             perror("sleep failed");
             exit(-1);
@@ -72,173 +395,212 @@ void *webmonThread(void *args) {
       }
    }
 
-   DestroyLL(&loadList);
+   return;
+}
+
+/*
+ * Serves the page from memory with the embedded http server.  The page is
+ * regenerated every intervalSec and the time in between is spent waiting on
+ * client sockets, so a single thread handles every client.
+ */
+void webmonServerLoop(WebmonState *state) {
+   long long now = 0, nextRender = 0;
 
-   return NULL;
+   while (1) {
+      now = webmonNowMsec();
+
+      if (now >= nextRender) {
+         webmonRender(state);
+         nextRender = now + (long long)state->params.intervalSec * CONVERT_SEC_TO_MSEC;
+      }
+
+      httpServerPoll(state->params.server, (int)(nextRender - now));
+
+      if (time(NULL) - state->lastPing >= EVENT_PING_SEC) {
+         eventStreamPing(state->params.server);
+         state->lastPing = time(NULL);
+      }
+   }
+
+   return;
 }
 
+/*
+ * Renders the whole page into state->page, reusing its memory between
+ * renders
+ */
+void webmonRender(WebmonState *state) {
+   int live = (state->params.server != NULL) ? 1 : 0;
+
+   bufferReset(&(state->page));
+   webmonCharts(state);
+
+   // taken before the tables are read, the page replays anything after it
+   webmonHeader(state, live, (live != 0) ? eventLogSeq() : 0);
+   webmonSettings(state, live);
+   webmonActiveThreads(state);
+   webmonCompletedThreads(state);
+   webmonFileTable(state);
+   webmonGraph(state);
+   webmonFooter(state);
 
-void updateLoadList(LinkedList *loadList) {
+   return;
+}
+
+void webmonWriteFile(WebmonState *state) {
+   size_t written = 0;
+   ssize_t result = 0;
    int fd = -1;
-   char *line = NULL, *load_1 = NULL, *load_5 = NULL, *load_15 = NULL;
 
-   if ((fd = open("/proc/loadavg", O_RDONLY)) == -1) {
+   if ((fd = open(state->params.file, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1) {
       perror("open failed");
       exit(-1);
    }
 
-   load_1 = queryFileByLoc(fd, 0, 0);
-   load_5 = queryFileByLoc(fd, 0, 1);
-   load_15 = queryFileByLoc(fd, 0, 2);
+   while (written < state->page.len) {
+      if ((result = write(fd, state->page.data + written, state->page.len - written)) == -1) {
+         if (errno == EINTR) {
+            continue;
+         }
+         perror("write failed");
+         exit(-1);
+      }
+      written += result;
+   }
 
-   if ((line = calloc(1, sizeof (char) * MAX_INPUT_LEN)) == NULL) {
-      perror("calloc failed");
+   if (close(fd) == -1) {
+      perror("close failed");
       exit(-1);
    }
 
-   snprintf(line, MAX_TIME_LEN - 1, ", %s, %s, %s]", load_1, load_5, load_15);
+   return;
+}
+
+void webmonHandleRequest(HttpConn *conn, HttpRequest *req, void *ctx) {
+   WebmonState *state = (WebmonState *)ctx;
+
+   if (strcmp(req->method, "GET") != 0 && req->isHead == 0) {
+      httpRespond(conn, req, 405, "text/plain", "method not allowed\n", 19);
+      return;
+   }
+
+   if (strcmp(req->path, "/") == 0 || strcmp(req->path, "/index.html") == 0) {
+      httpRespond(conn, req, 200, "text/html; charset=utf-8", state->page.data, state->page.len);
+      return;
+   }
+
+   if (strcmp(req->path, CHARTS_PATH) == 0) {
+      httpRespond(conn, req, 200, "text/html; charset=utf-8", state->charts.data, state->charts.len);
+      return;
+   }
+
+   if (strcmp(req->path, API_MONITORS_PATH) == 0) {
+      apiMonitors(conn, req);
+      return;
+   }
 
-   if (LLSize(loadList) <= GRAPH_HISTORY_LEN) {
-      LLInsertTail(loadList, (void *)line);
+   if (strcmp(req->path, API_SAMPLES_PATH) == 0) {
+      apiSamples(conn, req);
+      return;
    }
-   else {
-      LLRemoveHead(loadList);
-      LLInsertTail(loadList, (void *)line);
+
+   if (strcmp(req->path, EVENTS_PATH) == 0) {
+      eventStreamOpen(conn, req);
+      return;
    }
 
-   free(load_1);
-   free(load_5);
-   free(load_15);
+   if (strcmp(req->path, PROM_METRICS_PATH) == 0) {
+      promMetrics(conn, req, &(state->prom));
+      return;
+   }
 
-   close(fd);
+   httpRespond(conn, req, 404, "text/plain", "not found\n", 10);
 
    return;
 }
 
-void webmonHeader(FILE *file, int refreshSec, LinkedList *loadList) {
+long long webmonNowMsec() {
+   struct timespec ts;
 
-   fprintf(file, "\n\
-<html>\n\
-   <head>\n\
-      <title>System Monitor - Web Extension</title>\n\
-      <meta http-equiv=\"refresh\" content=\"%d\">\n\
-      <script type=\"text/javascript\" src=\"https://www.google.com/jsapi\"></script>\n\
-      <script type=\"text/javascript\">\n\
-      google.load(\"visualization\", \"1\", {packages:[\"corechart\"]});\n\
-      google.setOnLoadCallback(drawChart);\n\
-      function drawChart() {\n\
-      var data = google.visualization.arrayToDataTable([\n\
-         ['Data Point', '1 Minute', '5 Minute', '15 Minute'],\n\
-      ", refreshSec);
+   if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+      perror("clock_gettime failed");
+      exit(-1);
+   }
 
-   int i = 0;
-   for (i = 0; i < LLSize(loadList); i++) {
-      fprintf(file, "\
-         ['%d' %s,\n\
-         ", i, (char *)LLGet(loadList, i));
-   }
-
-   fprintf(file, "\n\
-         ]);\n\
-\n\
-      var options = {\n\
-      title: 'Computer Load Averages'\n\
-      };\n\
-      var chart = new google.visualization.LineChart(document.getElementById('chart_div'));\n\
-      chart.draw(data, options);\n\
-      }\n\
-      </script>\n\
-\n\
-   </head>\n\
-   <body>\n\
-      <h2>\n\
-         System Monitor - Web Extension\n\
-      </h2>\n\
-      <p>\n\
-         By Douglas Brandt & Kerry S.\n\
-      </p>\n\
-      ");
+   return (long long)ts.tv_sec * CONVERT_SEC_TO_MSEC + ts.tv_nsec / 1000000;
+}
+
+
+/*
+ * Note: live pages (served by webmon itself) do not refresh; they follow the
+ * server-sent event stream starting after liveSeq instead
+ */
+void webmonHeader(WebmonState *state, int live, unsigned long liveSeq) {
+   SlotValue values[4];
+
+   templateRender(&(state->page), &(state->times), headTemplate, NULL);
+
+   if (live != 0) {
+      values[0].str = EVENTS_PATH;
+      values[1].u = liveSeq;
+      values[2].str = CHARTS_PATH;
+      values[3].s = (long)state->params.intervalSec * CONVERT_SEC_TO_MSEC;
+      templateRender(&(state->page), &(state->times), liveTemplate, values);
+   } else {
+      values[0].s = state->params.refreshSec;
+      templateRender(&(state->page), &(state->times), refreshTemplate, values);
+   }
+
+   templateRender(&(state->page), &(state->times), bodyTemplate, NULL);
 
    return;
 }
 
-void webmonSettings(FILE *file, int intervalSec, int refreshSec) {
-   fprintf(file, "\n\
-\
-      <h3>\n\
-         Settings\n\
-      </h3>\n\
-      <ul>\n\
-         <li>\n\
-            webmon refresh rate = %d seconds\n\
-         </li>\n\
-         <li>\n\
-            html refresh rate = %d seconds\n\
-         </li>\n\
-      </ul>\n\
-               ", intervalSec, refreshSec);
+void webmonSettings(WebmonState *state, int live) {
+   char refreshStr[MAX_INPUT_LEN] = "";
+   SlotValue values[2];
+
+   if (snprintf(refreshStr, MAX_INPUT_LEN, "%d seconds", state->params.refreshSec) < 0) {
+      perror("snprintf failed");
+      exit(-1);
+   }
+
+   values[0].s = state->params.intervalSec;
+   values[1].str = (live != 0) ? "live (server-sent events)" : refreshStr;
+   templateRender(&(state->page), &(state->times), settingsTemplate, values);
 
    return;
 }
 
-void webmonActiveThreads(FILE *file) {
+void webmonActiveThreads(WebmonState *state) {
+   int i = 0;
 
-   fprintf(file, "\n\
-\
-      <h3>\n\
-         Active Threads\n\
-      </h3>\n\
-      <table border=\"1\", cellpadding=\"2\">\n\
-         <tr>\n\
-            <td>Thread Id</td>\n\
-            <td>Process Id</td>\n\
-            <td>Start Time</td>\n\
-            <td>Interval (&#956sec)</td>\n\
-            <td>Log File</td>\n\
-         </tr>\n\
-               ");
+   templateRender(&(state->page), &(state->times), activeHeadTemplate, NULL);
 
    if (systemThreadState == SYSTEM_THREAD_RUNNING) {
-      printRunningWebmon(file, &systemThreadTable);
+      printRunningWebmon(state, &systemThreadTable);
    }
 
-   int i = 0;
    for (i = 0; i < THREAD_TABLE_SIZE; i++) {
-      printRunningWebmon(file, &(threadTable[i]));
+      printRunningWebmon(state, &(threadTable[i]));
    }
 
-   fprintf(file, "\n\
-      </table>");
+   templateRender(&(state->page), &(state->times), tableEndTemplate, NULL);
 
    return;
 }
 
-void webmonCompletedThreads(FILE *file) {
-   char pidStr[MAX_INPUT_LEN] = "";
-   char startTimeStr[MAX_INPUT_LEN] = "";
-   char endTimeStr[MAX_INPUT_LEN] = "";
-   int i = 0;
+void webmonCompletedThreads(WebmonState *state) {
+   SlotValue values[11];
+   NodeEntry *cur = NULL;
+   ThreadTable *line = NULL;
+   SummaryText text;
 
-   fprintf(file, "\n\
-\
-      <h3>\n\
-         Completed Threads\n\
-      </h3>\n\
-      <table border=\"1\", cellpadding=\"2\">\n\
-         <tr>\n\
-            <td>Thread Id</td>\n\
-            <td>Process Id</td>\n\
-            <td>Start Time</td>\n\
-            <td>End Time</td>\n\
-            <td>End Status</td>\n\
-            <td>Interval (&#956sec)</td>\n\
-            <td>Log File</td>\n\
-         </tr>\n\
-               ");
+   templateRender(&(state->page), &(state->times), completedHeadTemplate, NULL);
 
    /*
     *  What threads use this critical section:
-    *    Only the command thread uses this critical section.
+    *    Only the webmon thread uses this critical section.
     *
     *  What shared resources are being protected:
     *    The linked list of completed tasks is the only resource locked.
@@ -246,9 +608,9 @@ void webmonCompletedThreads(FILE *file) {
     *  Line justification and performance concerns:
     *    Every line in this critical section (except error handling and for
     *    loop control flow) must use the shared resources and therefore, must
-    *    be locked.  As for performance concerns none of the lines
-    *    should block for extended periods of time and all of the information
-    *    locked and used is absolutely necessary to proper functioning.  Also,
+    *    be locked.  The rows are only copied into the page buffer (the nodes
+    *    are walked directly, not looked up by index) so the list is held for
+    *    a few milliseconds even with tens of thousands of rows.  Also,
     *    only exiting monitoring threads would block waiting for access to the
     *    linked list which should be of little concern since they are dead.
     *
@@ -265,31 +627,29 @@ void webmonCompletedThreads(FILE *file) {
    }
 
    // critical section
-   for (i = 0; i < LLSize(completedList); i++) {
-      ThreadTable *line = (ThreadTable *)LLGet(completedList, i);
-      if (snprintf(pidStr, MAX_INPUT_LEN, "%lu", (unsigned long)line->pid) < 0) {
-         perror("snprintf failed");
-         exit(-1);
-      }
-
-      fprintf(file, "\n\
-\
-         <tr>\n\
-            <td>%11lu</td>\n\
-            <td>%10s</td>\n\
-            <td>%10s</td>\n\
-            <td>%10s</td>\n\
-            <td>%10s</td>\n\
-            <td>%10lu</td>\n\
-            <td>%-1s</td>\n\
-         </tr>\n",
-            (unsigned long)line->tid,
-            (line->pid == -1) ? "system" : pidStr,
-            generateWebmonTime(&(line->startTime), startTimeStr),
-            generateWebmonTime(&(line->endTime), endTimeStr),
-            (line->endStatus == KILLED) ? "killed" : (line->endStatus == STOPPED) ? "stopped" : "exited",
-            line->interval,
-            line->fileName);
+   for (cur = completedList->head; cur != NULL; cur = cur->next) {
+      line = (ThreadTable *)cur->data;
+
+      values[0].u = (unsigned long)line->tid;
+      values[1].s = (long)line->endTime;
+      values[2].u = (unsigned long)line->tid;
+      templateRender(&(state->page), &(state->times), completedRowHeadTemplate, values);
+
+      webmonAppendPid(&(state->page), line->pid);
+
+      values[0].t = line->startTime;
+      values[1].t = line->endTime;
+      values[2].str = (line->endStatus == KILLED) ? "killed" : (line->endStatus == STOPPED) ? "stopped" : "exited";
+      values[3].u = line->interval;
+      values[4].str = line->fileName;
+      summaryFormat(&(line->summary), &text);
+      values[5].u = line->summary.samples;
+      values[6].u = line->summary.missedTicks;
+      values[7].str = text.peakMemory;
+      values[8].str = text.cpu;
+      values[9].str = text.faults;
+      values[10].str = text.exit;
+      templateRender(&(state->page), &(state->times), completedRowTailTemplate, values);
    }
 
    // unlock
@@ -298,28 +658,17 @@ void webmonCompletedThreads(FILE *file) {
       exit(-1);
    }
 
-   fprintf(file, "\n\
-      </table>");
+   templateRender(&(state->page), &(state->times), tableEndTemplate, NULL);
 
    return;
 }
 
-void webmonFileTable(FILE *file) {
+void webmonFileTable(WebmonState *state) {
+   SlotValue values[3];
    int i = 0;
    int value = 0;
 
-   fprintf(file, "\n\
-\
-      <h3>\n\
-         File Table\n\
-      </h3>\n\
-      <table border=\"1\", cellpadding=\"2\">\n\
-         <tr>\n\
-            <td>Device Id</td>\n\
-            <td>Inode Id</td>\n\
-            <td>Count</td>\n\
-         </tr>\n\
-               ");
+   templateRender(&(state->page), &(state->times), filesHeadTemplate, NULL);
 
    for (i = 0; i < FILE_TABLE_SIZE; i++) {
       // lock
@@ -336,16 +685,10 @@ void webmonFileTable(FILE *file) {
             exit(-1);
          }
 
-         fprintf(file, "\n\
-         <tr>\n\
-            <td>%10lu</td>\n\
-            <td>%10lu</td>\n\
-            <td>%10d</td>\n\
-         </tr>\n",
-                  (unsigned long) fileTable[i].dev,
-                  (unsigned long)fileTable[i].inode,
-                  value);
-
+         values[0].u = (unsigned long)fileTable[i].dev;
+         values[1].u = (unsigned long)fileTable[i].inode;
+         values[2].s = value;
+         templateRender(&(state->page), &(state->times), filesRowTemplate, values);
       }
 
       // unlock
@@ -355,37 +698,153 @@ void webmonFileTable(FILE *file) {
       }
    }
 
-   fprintf(file, "\n\
-      </table>");
+   templateRender(&(state->page), &(state->times), tableEndTemplate, NULL);
 
    return;
 }
 
-void webmonGraph(FILE *file) {
-   fprintf(file, "\n\
-         <h3> Utilization Graph</h3>");
-   fprintf(file, "\n\
-         <div id=\"chart_div\" style=\"width: 900px; height: 500px;\"></div>");
+void webmonGraph(WebmonState *state) {
+   templateRender(&(state->page), &(state->times), graphTemplate, NULL);
+   bufferAppend(&(state->page), state->charts.data, state->charts.len);
+   templateRender(&(state->page), &(state->times), graphEndTemplate, NULL);
 
    return;
 }
 
-void webmonFooter(FILE *file) {
-   fprintf(file, "\n\
-   </body>\n\
-</html>\n\
-         ");
+/*
+ * Renders the load chart and the charts of every monitored process into
+ * state->charts (served on its own to refresh live pages)
+ */
+void webmonCharts(WebmonState *state) {
+   int i = 0;
+
+   bufferReset(&(state->charts));
+   printSystemChart(state);
+
+   for (i = 0; i < THREAD_TABLE_SIZE; i++) {
+      printProcessCharts(state, &(threadTable[i]));
+   }
 
    return;
 }
 
-void printRunningWebmon(FILE *file, ThreadTable *line) {
-   char pidStr[MAX_INPUT_LEN] = "";
-   char timeStr[MAX_INPUT_LEN] = "";
+/*
+ * The load chart is the system monitor's own series, so it matches its log
+ * and /api, and shows nothing while the system monitor is off
+ */
+void printSystemChart(WebmonState *state) {
+   ChartSpec spec = { "Load Average", 0, 3, { "1 minute", "5 minute", "15 minute" },
+      CHART_WIDTH, CHART_HEIGHT };
 
    /*
     *  What threads use this critical section:
-    *    Only the command thread uses this critical section.
+    *    Only the webmon thread uses this critical section.
+    *
+    *  What shared resources are being protected:
+    *    The system monitor's row and its sample history, the system thread
+    *    appends to the chart series while sampling.
+    *
+    *  Line justification and performance concerns:
+    *    The series is only read; downsampling touches each kept point once
+    *    and at most CHART_POINTS are kept, so the row is held briefly.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&(systemThreadTable.mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (systemThreadTable.startTime != 0 && systemThreadTable.history != NULL &&
+         systemThreadTable.history->chart != NULL) {
+      chartRender(&(state->charts), systemThreadTable.history->chart, &spec);
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&(systemThreadTable.mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+void printProcessCharts(WebmonState *state, ThreadTable *line) {
+   ChartSpec rss = { "Resident Memory (MB)", 0, 1, { "rss" },
+      PROCESS_CHART_WIDTH, PROCESS_CHART_HEIGHT };
+   ChartSpec memory = { "Memory (MB)", 0, 1, { "memory.current" },
+      PROCESS_CHART_WIDTH, PROCESS_CHART_HEIGHT };
+   ChartSpec cpu = { "CPU (% of one cpu)", 1, 1, { "user + system" },
+      PROCESS_CHART_WIDTH, PROCESS_CHART_HEIGHT };
+   SlotValue values[2];
+
+   /*
+    *  What threads use this critical section:
+    *    Only the webmon thread uses this critical section.
+    *
+    *  What shared resources are being protected:
+    *    The table row and its sample history, the monitor thread appends
+    *    to the chart series while sampling.
+    *
+    *  Line justification and performance concerns:
+    *    The series is only read; downsampling touches each kept point once
+    *    and at most CHART_POINTS are kept, so the row is held briefly.
+    *
+    *  Mutex vs. semaphore decision:
+    *    A mutex was used because we only had resources that were
+    *    mutually exclusive.  Either it was in use or it wasn't.
+    *
+    */
+
+   // lock
+   if (pthread_mutex_lock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_lock failed");
+      exit(-1);
+   }
+
+   // critical section
+   if (line->startTime != 0 && line->history != NULL && line->history->chart != NULL) {
+      if (line->pid == CGROUP_THREAD_ID) {
+         values[0].str = line->cgroup;
+         templateRender(&(state->charts), &(state->times), cgroupChartsTemplate, values);
+         chartRender(&(state->charts), line->history->chart, &memory);
+      } else {
+         values[0].s = line->pid;
+         values[1].str = line->executable;
+         templateRender(&(state->charts), &(state->times), processChartsTemplate, values);
+         chartRender(&(state->charts), line->history->chart, &rss);
+      }
+      chartRender(&(state->charts), line->history->chart, &cpu);
+   }
+
+   // unlock
+   if (pthread_mutex_unlock(&(line->mutex)) != 0) {
+      perror("pthread_mutex_unlock failed");
+      exit(-1);
+   }
+
+   return;
+}
+
+void webmonFooter(WebmonState *state) {
+   templateRender(&(state->page), &(state->times), footerTemplate, NULL);
+
+   return;
+}
+
+void printRunningWebmon(WebmonState *state, ThreadTable *line) {
+   char summary[MAX_INPUT_LEN] = "";
+   SlotValue values[5];
+
+   /*
+    *  What threads use this critical section:
+    *    Only the webmon thread uses this critical section.
     *
     *  What shared resources are being protected:
     *    The table row that is passed in is locked so that it cannot be
@@ -393,10 +852,10 @@ void printRunningWebmon(FILE *file, ThreadTable *line) {
     *
     *  Line justification and performance concerns:
     *    Every line in this critical section (except error handling) must use
-    *    the shared resources and therefore, must be locked.  As for
-    *    performance concerns, there are only 3 lines.  None of the lines
-    *    should block for extended periods of time and all of the information
-    *    locked and used is absolutely necessary to proper functioning.
+    *    the shared resources and therefore, must be locked.  The row is only
+    *    copied into the page buffer.  None of the lines should block for
+    *    extended periods of time and all of the information locked and used
+    *    is absolutely necessary to proper functioning.
     *
     *  Mutex vs. semaphore decision:
     *    A mutex was used because we only had resources that were
@@ -412,24 +871,18 @@ void printRunningWebmon(FILE *file, ThreadTable *line) {
 
    // critical section
    if (line->startTime != 0) {
-      if (snprintf(pidStr, MAX_INPUT_LEN, "%lu", (unsigned long)line->pid) < 0) {
-         perror("snprintf failed");
-         exit(-1);
-      }
-
-      fprintf(file, "\n\
-         <tr>\n\
-            <td>%11lu</td>\n\
-            <td>%10s</td>\n\
-            <td>%10s</td>\n\
-            <td>%10lu</td>\n\
-            <td>%-1s</td>\n\
-         </tr>\n",
-            (unsigned long)line->tid,
-            (line->pid == -1) ? "system" : pidStr,
-            generateWebmonTime(&(line->startTime), timeStr),
-            line->interval,
-            line->fileName);
+      values[0].u = (unsigned long)line->tid;
+      values[1].u = (unsigned long)line->tid;
+      templateRender(&(state->page), &(state->times), activeRowHeadTemplate, values);
+
+      webmonAppendPid(&(state->page), line->pid);
+
+      values[0].t = line->startTime;
+      values[1].u = line->interval;
+      values[2].str = line->fileName;
+      values[3].u = (unsigned long)line->tid;
+      values[4].str = generateSampleSummary(line, summary);
+      templateRender(&(state->page), &(state->times), activeRowTailTemplate, values);
    }
 
    // unlock
@@ -441,13 +894,48 @@ void printRunningWebmon(FILE *file, ThreadTable *line) {
    return;
 }
 
-char *generateWebmonTime(time_t *timep, char *timeStr) {
+void webmonAppendPid(Buffer *page, pid_t pid) {
+   if (pid == SYSTEM_THREAD_ID) {
+      bufferAppend(page, "system", 6);
+   } else if (pid == CGROUP_THREAD_ID) {
+      bufferAppend(page, "cgroup", 6);
+   } else {
+      bufferAppendUnsigned(page, (unsigned long)pid);
+   }
+
+   return;
+}
+
+/*
+ * Note: must be called with the row locked, matches summary() in the live
+ * page script
+ */
+char *generateSampleSummary(ThreadTable *line, char *summary) {
+   Sample *latest = NULL;
+   char timeStr[MAX_INPUT_LEN] = "";
    struct tm *tm;
+   time_t when;
 
-   memset(timeStr, 0, sizeof (char) * MAX_INPUT_LEN);
+   memset(summary, 0, sizeof (char) * MAX_INPUT_LEN);
 
-   tm = localtime(timep);
-   strftime(timeStr, MAX_TIME_LEN - 1, "%a %b %d %T %Y", tm);
+   if (line->history == NULL || (latest = historyLatest(line->history)) == NULL) {
+      return summary;
+   }
+
+   when = (time_t)(((line->pid == SYSTEM_THREAD_ID) ? latest->sys.timeUsec :
+            (line->pid == CGROUP_THREAD_ID) ? latest->cgroup.timeUsec : latest->proc.timeUsec) / 1000000);
+   tm = localtime(&when);
+   strftime(timeStr, MAX_TIME_LEN - 1, "%T", tm);
+
+   if (line->pid == SYSTEM_THREAD_ID) {
+      snprintf(summary, MAX_INPUT_LEN, "%s load %.3f", timeStr, latest->sys.load1);
+   } else if (line->pid == CGROUP_THREAD_ID) {
+      snprintf(summary, MAX_INPUT_LEN, "%s memory %llu cpu %llu", timeStr,
+            latest->cgroup.memoryCurrent, latest->cgroup.usageUsec);
+   } else {
+      snprintf(summary, MAX_INPUT_LEN, "%s rss %ld cpu %lu", timeStr, (long)latest->proc.rss,
+            (unsigned long)(latest->proc.userTime + latest->proc.kernelTime));
+   }
 
-   return timeStr;
+   return summary;
 }
@@ -2,15 +2,21 @@
 #ifndef __WEBMON_THREAD_H_
 #define __WEBMON_THREAD_H_
 
+#include "httpServer.h"
+
 #define WEBMON_THREAD_RUNNING 1
 #define WEBMON_THREAD_NOT_RUNNING 0
+#define CHARTS_PATH "/charts"
 
 typedef struct {
    int intervalSec;
    int refreshSec;
    char file[MAX_INPUT_LEN];
+   int port;
+   HttpServer *server;
 } WebmonParams;
 
 void *webmonThread(void *args);
+void webmonHandleRequest(HttpConn *conn, HttpRequest *req, void *ctx);
 
 #endif // __WEBMON_THREAD_H_